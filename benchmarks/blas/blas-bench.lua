@@ -0,0 +1,70 @@
+-- Benchmark of the BLAS backends that can be loaded. For each backend
+-- the GFLOP/s of dgemm, dsyrk and of the solution of a linear system
+-- with dgesv are reported. The solution of the system uses the LAPACK
+-- routine of the backend if available, otherwise the LU factorization
+-- of GSL. The size of the matrices and the number of threads can be
+-- given as arguments.
+
+local ffi = require 'ffi'
+local gsl = require 'gsl'
+local blas = require 'blas'
+local timing = require 'benchmarks.timing'
+
+local format = string.format
+
+ffi.cdef[[
+void dgesv_(const int *n, const int *nrhs, double *a, const int *lda,
+            int *ipiv, double *b, const int *ldb, int *info);
+]]
+
+local N = tonumber(arg and arg[1]) or 1000
+local THREADS = tonumber(arg and arg[2])
+
+local function rnd(i, j) return math.random() + (i == j and N or 0) end
+
+local A, B = matrix.new(N, N, rnd), matrix.new(N, N, rnd)
+local C = matrix.new(N, N)
+local NT, T = gsl.CblasNoTrans, gsl.CblasTrans
+
+-- Return the best time, in seconds, of a few runs of "f".
+local function best_time(f)
+   return math.max(timing.best(f), 1) / 1000
+end
+
+local function gflops(flops, t)
+   return flops / t / 1e9
+end
+
+local function lapack_dgesv()
+   local ok, f = pcall(function() return blas.lib.dgesv_ end)
+   return ok and f or nil
+end
+
+-- LAPACK reads the matrix in column-major order so it solves the
+-- transposed system, with the same cost.
+local function bench_gesv()
+   local dgesv = lapack_dgesv()
+   local ipiv = ffi.new('int[?]', N)
+   local n, one, info = ffi.new('int[1]', N), ffi.new('int[1]', 1), ffi.new('int[1]')
+   local t = best_time(function()
+      local lu, x = A:copy(), B:col(1):copy()
+      if dgesv then
+         dgesv(n, one, lu.data, n, ipiv, x.data, n, info)
+      else
+         matrix.factor_lu(lu):solve(x, x)
+      end
+   end)
+   return gflops(2/3 * N^3, t), dgesv and 'lapack' or 'gsl LU'
+end
+
+print(format("%dx%d matrices", N, N))
+print(format("%-10s %7s %9s %9s %9s", "backend", "threads", "dgemm", "dsyrk", "dgesv"))
+for _, name in ipairs(blas.available()) do
+   blas.select(name)
+   if THREADS then blas.set_threads(THREADS) end
+   local t_gemm = best_time(function() blas.dgemm(NT, NT, 1, A, B, 0, C) end)
+   local t_syrk = best_time(function() blas.dsyrk(gsl.CblasUpper, NT, 1, A, 0, C) end)
+   local gesv, gesv_impl = bench_gesv()
+   print(format("%-10s %7d %9.2f %9.2f %9.2f  GFLOP/s (dgesv by %s)", name, blas.get_threads(),
+                gflops(2 * N^3, t_gemm), gflops(N^3, t_syrk), gesv, gesv_impl))
+end
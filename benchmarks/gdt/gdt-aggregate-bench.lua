@@ -0,0 +1,26 @@
+-- Benchmark of the aggregation of a data table by groups.
+-- A table with many (wafer, site) combinations is reduced with
+-- gdt.aggregate. The number of rows can be given as the first argument.
+
+require 'gdt-aggregate'
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = tonumber(arg and arg[1]) or 500000
+
+local t = gdt.alloc(N, {"wafer", "site", "value"})
+for i = 1, N do
+   t:set(i, 1, format("W%02d", i % 50))
+   t:set(i, 2, i % 97)
+   t:set(i, 3, math.sin(i))
+end
+
+print(format("%d rows", N))
+for _, descr in ipairs {"mean(value) ~ wafer", "mean(value), stddev(value), count(value) ~ wafer, site", "median(value), min(value), max(value) ~ wafer, site"} do
+   collectgarbage()
+   local t0 = now()
+   local r = gdt.aggregate(t, descr)
+   print(format("%-56s %6d groups %8.0f ms", descr, #r, now() - t0))
+end
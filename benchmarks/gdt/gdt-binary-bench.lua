@@ -0,0 +1,43 @@
+-- Benchmark of the binary table format.
+-- A CSV file is generated and loaded, the table is saved in binary
+-- format and then loaded again from the binary file.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = tonumber(arg and arg[1]) or 1000000
+
+local function write_test_file(filename, n)
+   local f = assert(io.open(filename, "w"))
+   f:write("lot,wafer,site,x,y,value\n")
+   for i = 1, n do
+      local lot = format("LOT%04d", i % 1000)
+      f:write(format("%s,%d,%d,%g,%g,%.6e\n", lot, i % 25, i % 13, i * 0.5, -i * 0.25, math.sin(i)))
+   end
+   f:close()
+end
+
+local function timeit(name, f)
+   collectgarbage()
+   local t0 = now()
+   local result = f()
+   print(format("%-16s %8.0f ms", name, now() - t0))
+   return result
+end
+
+local csv_filename, bin_filename = os.tmpname(), os.tmpname()
+write_test_file(csv_filename, N)
+
+print(format("%d rows", N))
+local t = timeit("read_csv", function() return gdt.read_csv(csv_filename) end)
+timeit("save_binary", function() gdt.save_binary(t, bin_filename) end)
+local b = timeit("load_binary", function() return gdt.load_binary(bin_filename) end)
+timeit("sum of column", function()
+   local s = 0
+   for i = 1, #b do s = s + b:get(i, 4) end
+   return s
+end)
+
+os.remove(csv_filename)
+os.remove(bin_filename)
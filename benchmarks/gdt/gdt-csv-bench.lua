@@ -0,0 +1,50 @@
+-- Benchmark of CSV loading into data tables.
+-- A CSV file with numeric, text and quoted columns is generated and
+-- then loaded with the native C reader and with the Lua reader. The
+-- throughput is reported in MB/s.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = 200000
+
+local function write_test_file(filename, n)
+   local f = assert(io.open(filename, "w"))
+   f:write("lot,wafer,site,x,y,value,note\n")
+   for i = 1, n do
+      local lot = format("LOT%04d", i % 1000)
+      local note = (i % 7 == 0) and "\"re-measured, \"\"flag\"\"\"" or ""
+      f:write(format("%s,%d,%d,%g,%g,%.6e,%s\n", lot, i % 25, i % 13, i * 0.5, -i * 0.25, math.sin(i), note))
+   end
+   f:close()
+end
+
+local function file_size(filename)
+   local f = assert(io.open(filename, "r"))
+   local size = f:seek("end")
+   f:close()
+   return size
+end
+
+local filename = os.tmpname()
+write_test_file(filename, N)
+local mb = file_size(filename) / 2^20
+
+local readers = {
+   {"native", {}},
+   {"native, column layout", {layout = "column"}},
+   {"Lua", {native = false}},
+}
+
+print(format("%d rows, %.1f MB", N, mb))
+for _, reader in ipairs(readers) do
+   local name, options = reader[1], reader[2]
+   collectgarbage()
+   local t0 = now()
+   local t = gdt.read_csv(filename, options)
+   local elapsed = now() - t0
+   print(format("%-24s %8.0f ms %8.1f MB/s", name, elapsed, mb / (elapsed / 1000)))
+end
+
+os.remove(filename)
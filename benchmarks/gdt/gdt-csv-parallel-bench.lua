@@ -0,0 +1,47 @@
+-- Benchmark of the parallel CSV reader.
+-- A large CSV file is generated and then loaded by the native reader
+-- with an increasing number of threads. The number of rows can be
+-- given as the first argument, the default is 2 million. With the
+-- argument "large" the file has 50 million rows, about 2.5 GB, and the
+-- table takes about 5.6 GB.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = (arg and arg[1] == 'large') and 50000000 or tonumber(arg and arg[1]) or 2000000
+
+local function write_test_file(filename, n)
+   local f = assert(io.open(filename, "w"))
+   f:write("lot,wafer,site,x,y,value,note\n")
+   for i = 1, n do
+      local lot = format("LOT%04d", i % 1000)
+      local note = (i % 7 == 0) and "\"re-measured,\n\"\"flag\"\"\"" or ""
+      f:write(format("%s,%d,%d,%g,%g,%.6e,%s\n", lot, i % 25, i % 13, i * 0.5, -i * 0.25, math.sin(i), note))
+   end
+   f:close()
+end
+
+local function file_size(filename)
+   local f = assert(io.open(filename, "r"))
+   local size = f:seek("end")
+   f:close()
+   return size
+end
+
+local filename = os.tmpname()
+write_test_file(filename, N)
+local mb = file_size(filename) / 2^20
+
+print(format("%d rows, %.1f MB", N, mb))
+local t1
+for _, threads in ipairs {1, 2, 4, 8, 16} do
+   collectgarbage()
+   local t0 = now()
+   local t = gdt.read_csv(filename, {threads = threads})
+   local elapsed = now() - t0
+   t1 = t1 or elapsed
+   print(format("%2d threads %8.0f ms %8.1f MB/s  speedup %5.2f", threads, elapsed, mb / (elapsed / 1000), t1 / elapsed))
+end
+
+os.remove(filename)
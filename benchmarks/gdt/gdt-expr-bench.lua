@@ -0,0 +1,46 @@
+-- Benchmark of the evaluation of expressions over the rows of a data
+-- table. The expressions are evaluated for each row by walking the
+-- syntax tree and with the compiled functions. The number of rows can
+-- be given as the first argument.
+
+local expr_parse = require 'expr-parse'
+local expr_print = require 'expr-print'
+local gdt_expr = require 'gdt-expr'
+local AST = require 'expr-actions'
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = tonumber(arg and arg[1]) or 1000000
+
+local t = gdt.alloc(N, {"x", "y", "lot"})
+for i = 1, N do
+   t:set(i, 1, i * 0.001)
+   t:set(i, 2, math.sin(i))
+   t:set(i, 3, format("LOT%02d", i % 20))
+end
+
+local exprs = {"x * y + 2", "log(x) - y^2 / (1 + x)", "x > 100 and lot = 'LOT07'"}
+
+print(format("%d rows", N))
+for _, s in ipairs(exprs) do
+   local e = expr_parse.expr(s, AST)
+
+   local t0 = now()
+   local sum_eval = 0
+   for i = 1, N do
+      sum_eval = sum_eval + expr_print.eval(e, gdt_expr.table_scope, t, i)
+   end
+   local t_eval = now() - t0
+
+   t0 = now()
+   local f = gdt_expr.compile(t, e)
+   local sum_comp = 0
+   for i = 1, N do
+      sum_comp = sum_comp + f(i)
+   end
+   local t_comp = now() - t0
+
+   assert(sum_eval == sum_comp)
+   print(format("%-28s eval %7.0f ms  compiled %7.0f ms  speedup %5.1f", s, t_eval, t_comp, t_eval / t_comp))
+end
@@ -0,0 +1,27 @@
+-- Benchmark of string interning in data tables.
+-- A table with a single column is filled with N distinct strings and
+-- then filled again with the same strings, so that both the insertion
+-- and the lookup paths of the table's string index are measured.
+-- With a hashed index the time per string should stay about constant
+-- when N grows.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local function fill(t, n)
+   for i = 1, n do
+      t:set(i, 1, format("LOT%07d", i))
+   end
+end
+
+print(format("%10s %12s %12s %12s", "N", "insert (ms)", "lookup (ms)", "ns/string"))
+for _, n in ipairs {1e4, 3e4, 1e5, 3e5, 1e6} do
+   local t = gdt.alloc(n, {"id"})
+   local t0 = now()
+   fill(t, n)
+   local t1 = now()
+   fill(t, n)
+   local t2 = now()
+   print(format("%10d %12.1f %12.1f %12.1f", n, t1 - t0, t2 - t1, (t2 - t0) * 1e6 / (2 * n)))
+end
@@ -0,0 +1,72 @@
+-- Benchmark of the batch integrand interface. The integrand is a sum of
+-- Gaussians over tabulated centers. The integrals of its moments x^j
+-- on the intervals [0, b] are computed with a call of num.integ for
+-- each moment and interval and with a single call of num.integ_many
+-- that shares the evaluations of the sum. The number of moments and of
+-- intervals can be given as arguments.
+
+local now = require('benchmarks.timing').now
+
+local exp, format = math.exp, string.format
+
+local M = tonumber(arg and arg[1]) or 4
+local K = tonumber(arg and arg[2]) or 32
+
+local NC = 200
+local centers = matrix.new(NC, 1, |i| 10 * (i - 0.5) / NC)
+
+local function gsum(x)
+   local s = 0
+   for k = 0, NC - 1 do
+      local d = x - centers.data[k]
+      s = s + exp(-50 * d*d)
+   end
+   return s
+end
+
+local nf = 0
+
+local function report(name, start, sum)
+   print(format('%-12s %8.1f ms  %9d evals  checksum %.12g', name, now() - start, nf, sum))
+   nf = 0
+end
+
+local bs = matrix.new(K, 1, |k| 10 * k / K)
+local epsabs, epsrel = 1e-10, 1e-10
+
+local start, sum = now(), 0
+local q = num.quad_prepare {method= 'qag', limit= 1000}
+for j = 0, M - 1 do
+   local f = function(x) nf = nf + 1; return gsum(x) * x^j end
+   for k = 1, K do sum = sum + q(f, 0, bs:get(k, 1), epsabs, epsrel) end
+end
+report('qag', start, sum)
+
+start, sum = now(), 0
+local qv = num.quad_prepare {method= 'qag', limit= 1000, vector= true}
+for j = 0, M - 1 do
+   local f = function(xs, n, ys)
+      nf = nf + n
+      for i = 0, n - 1 do ys[i] = gsum(xs[i]) * xs[i]^j end
+   end
+   for k = 1, K do sum = sum + qv(f, 0, bs:get(k, 1), epsabs, epsrel) end
+end
+report('qag vector', start, sum)
+
+start, sum = now(), 0
+local function fmany(xs, n, ys)
+   nf = nf + n
+   for i = 0, n - 1 do
+      local x = xs[i]
+      local y = gsum(x)
+      for j = 0, M - 1 do
+         ys[j*n + i] = y
+         y = y * x
+      end
+   end
+end
+local r = num.integ_many(fmany, M, 0, bs, epsabs, epsrel)
+for j = 1, M do
+   for k = 1, K do sum = sum + r:get(j, k) end
+end
+report('integ_many', start, sum)
@@ -0,0 +1,58 @@
+-- Benchmark of the element-wise operations between real matrices for
+-- sizes from 10 to 10^7 elements. The operators are compared with a
+-- loop that reads each operand element through a closure, like the
+-- operators did before. The strided case uses a view that takes half
+-- the columns of a matrix. The largest size, as a power of 10, can be
+-- given as the first argument.
+
+local timing = require 'benchmarks.timing'
+
+local format = string.format
+
+local MAX_EXP = tonumber(arg and arg[1]) or 7
+
+local function mat_get(m, i, j) return m.data[i*m.tda+j] end
+local function scalar_get(x) return x end
+local function add(a, b) return a + b end
+local function mul(a, b) return a * b end
+
+local function closure_op(a, opa, b, opb, oper)
+   local n1, n2 = matrix.dim(a)
+   local c = matrix.alloc(n1, n2)
+   for i = 0, n1-1 do
+      for j = 0, n2-1 do
+         c.data[i*n2+j] = oper(opa(a,i,j), opb(b,i,j))
+      end
+   end
+   return c
+end
+
+-- Return the best time of three runs, in nanoseconds for each call.
+local function bench(f, repeat_count)
+   local best = timing.best(function()
+      for k = 1, repeat_count do f() end
+   end)
+   return best * 1e6 / repeat_count
+end
+
+local function rnd() return math.random() end
+
+print(format("%9s %10s %12s %12s %12s %12s", "elements", "layout", "a+b closure", "a+b", "2*a closure", "2*a"))
+for e = 1, MAX_EXP do
+   local n = 10^e
+   local repeat_count = math.max(1, 10^(7 - e))
+   for _, layout in ipairs {"contiguous", "strided"} do
+      local a, b
+      if layout == "contiguous" then
+         a, b = matrix.new(n, 1, rnd), matrix.new(n, 1, rnd)
+      else
+         a = matrix.new(n / 10, 20, rnd):slice(1, 1, n / 10, 10)
+         b = matrix.new(n / 10, 20, rnd):slice(1, 1, n / 10, 10)
+      end
+      local t_add_cl = bench(function() return closure_op(a, mat_get, b, mat_get, add) end, repeat_count)
+      local t_add = bench(function() return a + b end, repeat_count)
+      local t_mul_cl = bench(function() return closure_op(a, mat_get, 2, scalar_get, mul) end, repeat_count)
+      local t_mul = bench(function() return 2 * a end, repeat_count)
+      print(format("%9d %10s %10.3f ns %10.3f ns %10.3f ns %10.3f ns", n, layout, t_add_cl / n, t_add / n, t_mul_cl / n, t_mul / n))
+   end
+end
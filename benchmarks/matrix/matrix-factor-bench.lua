@@ -0,0 +1,42 @@
+-- Benchmark of the repeated solution of a linear system with many
+-- right-hand sides. The system is solved with matrix.solve, that
+-- factorizes the matrix at each call, and with a factorization object
+-- computed once. The size of the system can be given as the first
+-- argument.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = tonumber(arg and arg[1]) or 200
+local NRHS = 500
+
+local function rnd(i, j) return math.random() + (i == j and N or 0) end
+
+local A = matrix.new(N, N, rnd)
+local B = matrix.new(N, NRHS, rnd)
+
+local t0 = now()
+local X1 = matrix.new(N, NRHS)
+for k = 1, NRHS do
+   X1:col(k):set(matrix.solve(A, B:col(k)))
+end
+local t_solve = now() - t0
+
+t0 = now()
+local f = matrix.factor_lu(A)
+local X2 = matrix.new(N, NRHS)
+for k = 1, NRHS do
+   f:solve(B:col(k), X2:col(k))
+end
+local t_factor = now() - t0
+
+t0 = now()
+local X3 = f:solve_many(B)
+local t_many = now() - t0
+
+print(format("%dx%d system, %d right-hand sides", N, N, NRHS))
+print(format("matrix.solve   %7.0f ms", t_solve))
+print(format("factor:solve   %7.0f ms", t_factor))
+print(format("solve_many     %7.0f ms", t_many))
+print(format("difference %g %g", (X1 - X2):norm(), (X1 - X3):norm()))
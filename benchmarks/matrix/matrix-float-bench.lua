@@ -0,0 +1,37 @@
+-- Benchmark of the single precision matrices compared to the real ones:
+-- an element-wise expression evaluated with a lazy expression into an
+-- existing matrix and the matrix product. The size of the matrices can
+-- be given as the first argument.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = tonumber(arg and arg[1]) or 1000
+local REPEAT = 20
+
+local function bench(name, new)
+   local a = new(N, N, function(i, j) return math.sin(i + j) end)
+   local b = new(N, N, function(i, j) return math.cos(i - j) end)
+   local r = new(N, N)
+
+   local t0 = now()
+   for k = 1, REPEAT do
+      r:set(2 * matrix.lazy(a) - b * 0.5 + 1)
+   end
+   local t_elem = (now() - t0) / REPEAT
+
+   t0 = now()
+   matrix.gemm(1, a, b, 0, r)
+   local t_gemm = now() - t0
+
+   local mbytes = N * N * (new == matrix.fnew and 4 or 8) / 2^20
+   print(format("%-7s %6.1f MB/matrix, element-wise %7.2f ms, gemm %7.0f ms, %.2f GFLOP/s",
+                name, mbytes, t_elem, t_gemm, 2 * N^3 / (t_gemm * 1e6)))
+   return r
+end
+
+print(format("%dx%d matrices", N, N))
+local rd = bench("double", matrix.new)
+local rf = bench("float", matrix.fnew)
+print(format("relative difference %g", (rd - rf):norm() / rd:norm()))
@@ -0,0 +1,48 @@
+-- Benchmark of the in-place matrix operations. The same iteration,
+-- a relaxation step x <- x + 0.1 * (b - A*x), is computed with the
+-- arithmetic operators, that allocate a new matrix for each operation,
+-- and with matrix.gemm and matrix.axpy that update a work matrix in
+-- place. The size of the system can be given as the first argument.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = tonumber(arg and arg[1]) or 200
+local STEPS = 200
+
+local function rnd() return math.random() / N end
+
+local A = matrix.new(N, N, rnd)
+local b = matrix.new(N, 1, rnd)
+
+local function run_operators()
+   local x = matrix.new(N, 1)
+   for k = 1, STEPS do
+      x = x + 0.1 * (b - A * x)
+   end
+   return x
+end
+
+local function run_inplace()
+   local x, r = matrix.new(N, 1), matrix.new(N, 1)
+   for k = 1, STEPS do
+      r:set(b)
+      matrix.gemm(-1, A, x, 1, r)
+      matrix.axpy(0.1, r, x)
+   end
+   return x
+end
+
+local function run(name, f)
+   collectgarbage()
+   local t0 = now()
+   local x = f()
+   print(format("%-10s %7.0f ms", name, now() - t0))
+   return x
+end
+
+print(format("%dx%d matrix, %d steps", N, N, STEPS))
+local x1 = run("operators", run_operators)
+local x2 = run("in-place", run_inplace)
+print(format("difference %g", (x1 - x2):norm()))
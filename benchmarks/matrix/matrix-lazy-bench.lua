@@ -0,0 +1,43 @@
+-- Benchmark of the element-wise expression "a + 2*b - c/4" evaluated
+-- with the usual operators, that allocate a matrix for each operation,
+-- and with a lazy expression evaluated by a single loop. The size of
+-- the square matrices can be given as the first argument.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = tonumber(arg and arg[1]) or 2000
+local REPEAT = 10
+
+local function rnd(i, j) return math.random() end
+local a, b, c = matrix.new(N, N, rnd), matrix.new(N, N, rnd), matrix.new(N, N, rnd)
+
+local la, lb, lc = matrix.lazy(a), matrix.lazy(b), matrix.lazy(c)
+
+local t0 = now()
+local r_eager
+for k = 1, REPEAT do
+   r_eager = a + 2*b - c/4
+end
+local t_eager = now() - t0
+
+t0 = now()
+local r_lazy
+for k = 1, REPEAT do
+   r_lazy = matrix.eval(la + 2*lb - lc/4)
+end
+local t_lazy = now() - t0
+
+t0 = now()
+local r = matrix.alloc(N, N)
+for k = 1, REPEAT do
+   matrix.set(r, la + 2*lb - lc/4)
+end
+local t_assign = now() - t0
+
+assert((r_eager - r_lazy):norm() == 0 and (r_eager - r):norm() == 0)
+print(format("%dx%d, %d times", N, N, REPEAT))
+print(format("eager  %7.0f ms", t_eager))
+print(format("lazy   %7.0f ms  speedup %5.1f", t_lazy, t_eager / t_lazy))
+print(format("assign %7.0f ms  speedup %5.1f", t_assign, t_eager / t_assign))
@@ -0,0 +1,68 @@
+-- Benchmark of the memory mapped matrices. A matrix file is written and
+-- then its elements are summed after reading the file element by
+-- element into a new matrix and with a mapping of the file, with and
+-- without the hint for sequential access. The number of rows and the
+-- name of the file can be given as arguments.
+
+local ffi = require 'ffi'
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N1 = tonumber(arg and arg[1]) or 200000
+local N2 = 100
+local FILENAME = arg and arg[2] or os.tmpname()
+
+local function sum(m)
+   local n1, n2 = matrix.dim(m)
+   local data, tda, s = m.data, tonumber(m.tda), 0
+   for i = 0, n1 - 1 do
+      for j = 0, n2 - 1 do s = s + data[i * tda + j] end
+   end
+   return s
+end
+
+local t0 = now()
+local w = matrix.mmap(FILENAME, N1, N2, 'w+')
+for i = 0, N1 - 1 do
+   for j = 0, N2 - 1 do w.data[i * N2 + j] = (i % 17) + j / N2 end
+end
+matrix.release(w)
+local t_write = now() - t0
+
+-- Read the elements with the file API, skipping the header.
+t0 = now()
+local f = assert(io.open(FILENAME, 'rb'))
+f:seek('set', 64)
+local m = matrix.alloc(N1, N2)
+local row = N2 * 8
+for i = 0, N1 - 1 do
+   local s = f:read(row)
+   ffi.copy(m.data + i * N2, s, row)
+end
+f:close()
+local s_read = sum(m)
+local t_read = now() - t0
+matrix.release(m)
+
+t0 = now()
+m = matrix.mmap(FILENAME)
+local s_map = sum(m)
+local t_map = now() - t0
+matrix.release(m)
+
+t0 = now()
+m = matrix.mmap(FILENAME)
+matrix.madvise(m, 'sequential')
+local s_seq = sum(m)
+local t_seq = now() - t0
+matrix.release(m)
+
+print(format("%dx%d matrix, %.0f MB", N1, N2, N1 * N2 * 8 / 2^20))
+print(format("write mmap      %7.0f ms", t_write))
+print(format("read + sum      %7.0f ms", t_read))
+print(format("mmap + sum      %7.0f ms", t_map))
+print(format("sequential      %7.0f ms", t_seq))
+print(format("sums %g %g %g", s_read, s_map, s_seq))
+
+os.remove(FILENAME)
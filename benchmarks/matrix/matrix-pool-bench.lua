@@ -0,0 +1,47 @@
+-- Benchmark of the matrix pool in an iterative loop that creates a few
+-- temporary matrices at each step. The loop is run letting the garbage
+-- collector free the temporaries and with a scope for each step that
+-- gives the registered ones back to the pool right away. The size of
+-- the vectors can be given as the first argument.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = tonumber(arg and arg[1]) or 20000
+local STEPS = 500
+
+local function rnd() return math.random() end
+
+local function step(tmp, x, y)
+   local r = tmp(y - x * 0.5)
+   return x + r * 0.1
+end
+
+local function no_scope(m) return m end
+
+local function run(use_scope)
+   collectgarbage()
+   matrix.pool_trim()
+   matrix.pool_reset_peak()
+   local s0 = matrix.pool_stats()
+   local x, y = matrix.new(N, 1, rnd), matrix.new(N, 1, rnd)
+   local t0 = now()
+   for k = 1, STEPS do
+      if use_scope then
+         local x_new = matrix.scope(step, x, y)
+         matrix.release(x)
+         x = x_new
+      else
+         x = step(no_scope, x, y)
+      end
+   end
+   local t = now() - t0
+   local s = matrix.pool_stats()
+   local hit_rate = (s.hits - s0.hits) / (s.requests - s0.requests)
+   print(format("%-8s %7.0f ms  hit rate %5.1f%%  peak %8.1f MB", use_scope and "scope" or "gc", t, hit_rate * 100, s.peak_bytes / 2^20))
+end
+
+print(format("%d elements, %d steps", N, STEPS))
+run(false)
+run(true)
@@ -0,0 +1,32 @@
+-- Benchmark of the sort of a column matrix of random numbers with the
+-- Lua quicksort, that compares the elements with a function call, and
+-- with the native sort. The median is also computed by sorting a copy
+-- and by selection. The number of elements can be given as the first
+-- argument.
+
+local algo = require 'algorithm'
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local N = tonumber(arg and arg[1]) or 1000000
+
+local v = matrix.new(N, 1, function() return math.random() end)
+
+local function bench(name, f)
+   local x = v:copy()
+   local t0 = now()
+   local r = f(x)
+   print(format("%-16s %7.0f ms", name, now() - t0))
+   return r
+end
+
+print(format("%d elements", N))
+bench("lua quicksort", function(x) algo.quicksort(x.data, 0, N - 1) end)
+bench("native sort", function(x) x:sort() end)
+local m1 = bench("sorted median", function(x)
+   x:sort()
+   return (x.data[math.floor((N - 1) / 2)] + x.data[math.ceil((N - 1) / 2)]) / 2
+end)
+local m2 = bench("selection median", function(x) return matrix.median(x) end)
+print(format("median %g %g", m1, m2))
@@ -0,0 +1,52 @@
+-- Benchmark of the sparse matrices with the discrete Laplacian on a
+-- m x m grid, 5 nonzeros per row. It measures the assembly, the
+-- product by a vector with one and with all threads and the iterative
+-- solvers with each preconditioner. The size of the grid can be given
+-- as the first argument.
+
+local now = require('benchmarks.timing').now
+local sparse = matrix.sparse or require 'sparse'
+
+local format = string.format
+
+local M = tonumber(arg and arg[1]) or 300
+local N = M * M
+local NMUL = 100
+
+local t0 = now()
+local c = sparse.coo(N, N)
+for i = 1, M do
+   for j = 1, M do
+      local k = (i - 1) * M + j
+      c:add(k, k, 4)
+      if i > 1 then c:add(k, k - M, -1) end
+      if i < M then c:add(k, k + M, -1) end
+      if j > 1 then c:add(k, k - 1, -1) end
+      if j < M then c:add(k, k + 1, -1) end
+   end
+end
+local A = c:tocsr()
+local t_assembly = now() - t0
+
+print(format("%dx%d system, %d nonzeros", N, N, A:nnz()))
+print(format("assembly       %7.0f ms", t_assembly))
+
+local x = matrix.new(N, 1, function(i) return math.sin(i) end)
+local y = matrix.alloc(N, 1)
+for _, nt in ipairs {1, 0} do
+   sparse.threads(nt)
+   t0 = now()
+   for k = 1, NMUL do A:mul(x, y) end
+   local t = now() - t0
+   print(format("matvec %-7s %7.2f ms, %.2f GFLOP/s", nt == 1 and '1 thr' or 'all thr',
+                t / NMUL, 2 * A:nnz() * NMUL / (t * 1e6)))
+end
+
+for _, solver in ipairs {'cg', 'bicgstab', 'gmres'} do
+   for _, pc in ipairs {'none', 'jacobi', 'ilu0'} do
+      t0 = now()
+      local _, info = sparse[solver](A, x, {precond = pc, tol = 1e-8, restart = 50})
+      local t = now() - t0
+      print(format("%-9s %-7s %7.0f ms, %5d iterations, residual %.1e", solver, pc, t, info.iterations, info.residual))
+   end
+end
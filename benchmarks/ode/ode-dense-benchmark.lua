@@ -0,0 +1,46 @@
+-- Benchmark of the dense output of the ODE integrators. The Van der Pol
+-- equation is sampled on a fine grid with the evolve iterator, that
+-- shortens the steps to reach each sample time, and with the sample
+-- method, that interpolates the solution between the natural steps of
+-- the integrator. The number of samples and the method can be given as
+-- arguments.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local NS = tonumber(arg and arg[1]) or 100000
+local METHOD = arg and arg[2] or 'rkf45'
+
+local nf = 0
+local function f(t, x, y)
+   nf = nf + 1
+   return y, -x + 10 * y * (1-x^2)
+end
+
+local t0, t1, h0 = 0, 200, 0.01
+local dt = (t1 - t0) / (NS - 1)
+local ts = matrix.new(NS, 1, |i| t0 + (i-1) * dt)
+
+local function report(name, start, sum)
+   print(format('%-10s %8.1f ms  %9d f evals  checksum %.10g', name, now() - start, nf, sum))
+   nf = 0
+end
+
+local s = num.ode {N= 2, eps_abs= 1e-8, eps_rel= 1e-8, method= METHOD}
+
+local start, sum = now(), 0
+s:init(t0, h0, f, 2, 0)
+for t, x, y in s:evolve(t1, dt) do sum = sum + x end
+report('evolve', start, sum)
+
+start, sum = now(), 0
+s:init(t0, h0, f, 2, 0)
+local r = s:sample(ts)
+for i = 0, NS - 1 do sum = sum + r.data[2*i] end
+report('sample', start, sum)
+
+start, sum = now(), 0
+s:init(t0, h0, f, 2, 0)
+s:sample(ts, function(t, x, y) sum = sum + x end)
+report('callback', start, sum)
@@ -0,0 +1,48 @@
+-- Benchmark of the ensemble ODE integration. The Van der Pol equation
+-- is integrated for many initial conditions looping over a single
+-- solver, with an ensemble and with an ensemble divided among a pool of
+-- worker states. The number of trajectories, the number of workers and
+-- the method can be given as arguments.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local K = tonumber(arg and arg[1]) or 10000
+local WORKERS = tonumber(arg and arg[2]) or 4
+local METHOD = arg and arg[3] or 'rkf45'
+
+local f_src = 'return function(t, x, y) return y, -x + 2 * y * (1-x^2) end'
+local f = loadstring(f_src)()
+local t0, t1, h0 = 0, 20, 0.01
+
+local y0 = matrix.new(K, 2, function(k, i) return i == 1 and 4 * (k - 1) / K - 2 or 0 end)
+
+local function checksum(m)
+   local s = 0
+   for k = 1, K do s = s + m:get(k, 1) end
+   return s
+end
+
+local start = now()
+local s = num.ode {N= 2, eps_abs= 1e-8, method= METHOD}
+local step = s.step
+local single = matrix.alloc(K, 2)
+for k = 1, K do
+   s:init(t0, h0, f, y0:get(k, 1), y0:get(k, 2))
+   while s.t < t1 do
+      step(s, t1)
+   end
+   single:set(k, 1, s.y[1])
+   single:set(k, 2, s.y[2])
+end
+print(format('%-12s %8.1f ms  checksum %.10g', 'single', now() - start, checksum(single)))
+
+for _, w in ipairs {1, WORKERS} do
+   start = now()
+   local e = num.ode_ensemble {N= 2, K= K, eps_abs= 1e-8, method= METHOD, workers= w}
+   e:init(t0, h0, w > 1 and f_src or f, y0)
+   e:evolve(t1)
+   local name = format('ensemble/%d', w)
+   print(format('%-12s %8.1f ms  checksum %.10g', name, now() - start, checksum(e:solution())))
+end
@@ -0,0 +1,72 @@
+-- Benchmark of the ODE integrators on stiff problems: the Robertson
+-- chemical kinetics and the Van der Pol oscillator with mu = 1000. For
+-- each method the number of steps, of function evaluations, of
+-- Jacobian evaluations and of LU factorizations is given. The explicit
+-- methods are stopped after a maximum number of steps, that can be
+-- given as an argument.
+
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local MAX_STEPS = tonumber(arg and arg[1]) or 200000
+
+local function robertson(t, a, b, c)
+   return -0.04*a + 1e4*b*c, 0.04*a - 1e4*b*c - 3e7*b*b, 3e7*b*b
+end
+
+local function robertson_jac(t, J, a, b, c)
+   J:set(1, 1, -0.04);  J:set(1, 2, 1e4*c);          J:set(1, 3, 1e4*b)
+   J:set(2, 1, 0.04);   J:set(2, 2, -1e4*c - 6e7*b); J:set(2, 3, -1e4*b)
+   J:set(3, 2, 6e7*b)
+end
+
+local mu = 1000
+
+local function vanderpol(t, x, y)
+   return y, mu * (1 - x^2) * y - x
+end
+
+local function vanderpol_jac(t, J, x, y)
+   J:set(1, 2, 1)
+   J:set(2, 1, -2 * mu * x * y - 1)
+   J:set(2, 2, mu * (1 - x^2))
+end
+
+local problems = {
+   {name= 'robertson', N= 3, f= robertson, jac= robertson_jac, y0= {1, 0, 0}, t1= 40, tol= 1e-8},
+   {name= 'vanderpol', N= 2, f= vanderpol, jac= vanderpol_jac, y0= {2, 0}, t1= 3000, tol= 1e-6},
+}
+
+local methods = {'rkf45', 'rosenbrock', 'bdf'}
+
+print(format('%-10s %-16s %8s %8s %9s %6s %6s  %s', 'problem', 'method', 'time', 'steps', 'f evals', 'jac', 'lu', 'y(t1)'))
+for _, p in ipairs(problems) do
+   for _, method in ipairs(methods) do
+      for _, use_jac in ipairs {false, true} do
+         local implicit = (method ~= 'rkf45')
+         if implicit or not use_jac then
+            local nf = 0
+            local f = p.f
+            local fc = function(...) nf = nf + 1; return f(...) end
+            local s = num.ode {N= p.N, eps_abs= p.tol, eps_rel= p.tol, method= method}
+            if use_jac then s:set_jacobian(p.jac) end
+            local start = now()
+            s:init(0, 1e-6, fc, unpack(p.y0))
+            local steps = 0
+            while s.t < p.t1 and steps < MAX_STEPS do
+               s:step(p.t1)
+               steps = steps + 1
+            end
+            local t = now() - start
+            local ys = {}
+            for i = 1, p.N do ys[i] = format('%.6g', s.y[i]) end
+            local name = method .. (implicit and (use_jac and '/jac' or '/fd') or '')
+            local status = s.t < p.t1 and format(' (stopped at t = %g)', s.t) or ''
+            print(format('%-10s %-16s %6.0f ms %8d %9d %6s %6s  %s%s', p.name, name, t, steps, nf,
+                         implicit and s.njev or '-', implicit and s.nlu or '-',
+                         table.concat(ys, ' '), status))
+         end
+      end
+   end
+end
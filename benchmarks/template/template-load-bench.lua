@@ -0,0 +1,51 @@
+-- Benchmark of the preparation of the specialized code. The ODE, the
+-- nonlinear fit and the QAG integrator are created many times, first
+-- compiling the templates each time, then using the in-memory cache and
+-- finally reading the disk cache, as it happens at the startup of a
+-- program run a second time. The number of repetitions and the cache
+-- directory can be given as arguments.
+
+local template = require 'template'
+local now = require('benchmarks.timing').now
+
+local format = string.format
+
+local REPEAT = tonumber(arg and arg[1]) or 200
+local DIR = arg and arg[2] or os.getenv('TMPDIR') or '/tmp'
+
+local function prepare()
+   num.ode {N= 2, eps_abs= 1e-8}
+   num.ode {N= 2, eps_abs= 1e-8, method= 'rk8pd'}
+   num.nlinfit {n= 100, p= 3}
+   num.quad_prepare {method= 'qag', limit= 64}
+end
+
+local function run(name, setup)
+   local st0 = template.cache_stats()
+   local t0 = now()
+   for k = 1, REPEAT do
+      setup()
+      prepare()
+   end
+   local t = now() - t0
+   local st = template.cache_stats()
+   print(format('%-10s %8.1f ms  %8.3f ms/run  hits %d, disk hits %d, misses %d',
+                name, t, t / REPEAT, st.hits - st0.hits,
+                st.disk_hits - st0.disk_hits, st.misses - st0.misses))
+end
+
+local old_dir = template.cache_dir(false)
+
+template.cache_clear()
+run('compile', template.cache_clear)
+
+template.cache_clear()
+run('memory', function() end)
+
+template.cache_dir(DIR)
+template.cache_clear()
+prepare()
+template.cache_clear()
+run('disk', template.cache_clear)
+
+template.cache_dir(old_dir)
@@ -0,0 +1,28 @@
+-- Timing functions shared by the benchmarks. The benchmarks are run
+-- from the top directory of the sources and load this module with
+-- require 'benchmarks.timing'.
+
+local time = require 'time'
+
+local min = math.min
+
+-- Return the time elapsed from an arbitrary origin in milliseconds.
+local function now()
+   return tonumber(time.ms())
+end
+
+-- Return the best time, in milliseconds, of "runs" calls of "f", three
+-- by default. The garbage is collected before each call so that it is
+-- not timed.
+local function best(f, runs)
+   local t = math.huge
+   for run = 1, runs or 3 do
+      collectgarbage()
+      local t0 = now()
+      f()
+      t = min(t, now() - t0)
+   end
+   return t
+end
+
+return {now = now, best = best}
@@ -0,0 +1,242 @@
+local ffi = require 'ffi'
+local gsl = require 'gsl'
+
+-- Backend for the BLAS routines used directly by GSL Shell. The CBLAS
+-- library is loaded at runtime so that an optimized implementation can
+-- be used for the matrix products. The backend is given by the
+-- environment variable GSL_SHELL_BLAS, either the name of a backend or
+-- the name of a library, and the number of threads by the variable
+-- GSL_SHELL_BLAS_THREADS. The routines called by GSL itself, used for
+-- example by the eigensystems and the linear fits, are the ones linked
+-- with the GSL library.
+
+ffi.cdef[[
+void cblas_sgemm (const enum CBLAS_ORDER Order,
+                  const enum CBLAS_TRANSPOSE TransA,
+                  const enum CBLAS_TRANSPOSE TransB, const int M,
+                  const int N, const int K, const float alpha,
+                  const float *A, const int lda, const float *B,
+                  const int ldb, const float beta, float *C,
+                  const int ldc);
+
+void cblas_dgemm (const enum CBLAS_ORDER Order,
+                  const enum CBLAS_TRANSPOSE TransA,
+                  const enum CBLAS_TRANSPOSE TransB, const int M,
+                  const int N, const int K, const double alpha,
+                  const double *A, const int lda, const double *B,
+                  const int ldb, const double beta, double *C,
+                  const int ldc);
+
+void cblas_zgemm (const enum CBLAS_ORDER Order,
+                  const enum CBLAS_TRANSPOSE TransA,
+                  const enum CBLAS_TRANSPOSE TransB, const int M,
+                  const int N, const int K, const void *alpha,
+                  const void *A, const int lda, const void *B,
+                  const int ldb, const void *beta, void *C,
+                  const int ldc);
+
+void cblas_dsyrk (const enum CBLAS_ORDER Order,
+                  const enum CBLAS_UPLO Uplo,
+                  const enum CBLAS_TRANSPOSE Trans, const int N,
+                  const int K, const double alpha, const double *A,
+                  const int lda, const double beta, double *C,
+                  const int ldc);
+
+void cblas_daxpy (const int N, const double ALPHA,
+                  const double * X, const int INCX,
+                  double * Y, const int INCY);
+
+void openblas_set_num_threads(int num_threads);
+int openblas_get_num_threads(void);
+
+void bli_thread_set_num_threads(int64_t n_threads);
+int64_t bli_thread_get_num_threads(void);
+
+void MKL_Set_Num_Threads(int nth);
+int MKL_Get_Max_Threads(void);
+]]
+
+local RowMajor = gsl.CblasRowMajor
+local NoTrans = gsl.CblasNoTrans
+
+-- For each backend, the libraries to look for, in order.
+local backend_libs = {
+    openblas  = {'openblas'},
+    blis      = {'blis'},
+    mkl       = {'mkl_rt'},
+    reference = ffi.os == 'Windows' and {'libgslcblas-0'} or {'cblas', 'blas', 'gslcblas'},
+}
+
+local backend_order = {'openblas', 'blis', 'mkl', 'reference', 'builtin'}
+
+local threads_fn = {
+    openblas = {'openblas_set_num_threads', 'openblas_get_num_threads'},
+    blis     = {'bli_thread_set_num_threads', 'bli_thread_get_num_threads'},
+    mkl      = {'MKL_Set_Num_Threads', 'MKL_Get_Max_Threads'},
+}
+
+local function lib_symbol(lib, name)
+    local ok, f = pcall(function() return lib[name] end)
+    return ok and f or nil
+end
+
+-- Return the library loaded with the given name if it provides the
+-- CBLAS routines.
+local function load_cblas(name)
+    local ok, lib = pcall(ffi.load, name)
+    if ok and lib_symbol(lib, 'cblas_dgemm') then return lib end
+end
+
+-- The backend "builtin" is the CBLAS library linked with GSL Shell.
+local function load_backend(name)
+    if name == 'builtin' then
+        if lib_symbol(ffi.C, 'cblas_dgemm') then return ffi.C, name end
+        return
+    end
+    local libs = backend_libs[name]
+    if not libs then
+        local lib = load_cblas(name)
+        return lib, name
+    end
+    for _, libname in ipairs(libs) do
+        local lib = load_cblas(libname)
+        if lib then return lib, name end
+    end
+end
+
+-- The following functions have the same arguments and return value of
+-- the GSL functions gsl_blas_* and call the backend "lib".
+
+local function op_dim(m, trans)
+    if trans == NoTrans then
+        return tonumber(m.size1), tonumber(m.size2)
+    else
+        return tonumber(m.size2), tonumber(m.size1)
+    end
+end
+
+local zscalars = ffi.new('gsl_complex[2]')
+
+local function cblas_routines(lib)
+    local cblas_dgemm, cblas_zgemm, cblas_dsyrk = lib.cblas_dgemm, lib.cblas_zgemm, lib.cblas_dsyrk
+    local cblas_sgemm = lib.cblas_sgemm
+
+    local function sgemm(transa, transb, alpha, a, b, beta, c)
+        local m, k = op_dim(a, transa)
+        local kb, n = op_dim(b, transb)
+        if k ~= kb or m ~= tonumber(c.size1) or n ~= tonumber(c.size2) then
+            return gsl.GSL_EBADLEN
+        end
+        cblas_sgemm(RowMajor, transa, transb, m, n, k, alpha, a.data, a.tda, b.data, b.tda, beta, c.data, c.tda)
+        return 0
+    end
+
+    local function dgemm(transa, transb, alpha, a, b, beta, c)
+        local m, k = op_dim(a, transa)
+        local kb, n = op_dim(b, transb)
+        if k ~= kb or m ~= tonumber(c.size1) or n ~= tonumber(c.size2) then
+            return gsl.GSL_EBADLEN
+        end
+        cblas_dgemm(RowMajor, transa, transb, m, n, k, alpha, a.data, a.tda, b.data, b.tda, beta, c.data, c.tda)
+        return 0
+    end
+
+    local function zgemm(transa, transb, alpha, a, b, beta, c)
+        local m, k = op_dim(a, transa)
+        local kb, n = op_dim(b, transb)
+        if k ~= kb or m ~= tonumber(c.size1) or n ~= tonumber(c.size2) then
+            return gsl.GSL_EBADLEN
+        end
+        zscalars[0], zscalars[1] = alpha, beta
+        cblas_zgemm(RowMajor, transa, transb, m, n, k, zscalars, a.data, a.tda, b.data, b.tda, zscalars + 1, c.data, c.tda)
+        return 0
+    end
+
+    local function dsyrk(uplo, trans, alpha, a, beta, c)
+        local n, k = op_dim(a, trans)
+        if n ~= tonumber(c.size1) or n ~= tonumber(c.size2) then
+            return gsl.GSL_EBADLEN
+        end
+        cblas_dsyrk(RowMajor, uplo, trans, n, k, alpha, a.data, a.tda, beta, c.data, c.tda)
+        return 0
+    end
+
+    return {sgemm = sgemm, dgemm = dgemm, zgemm = zgemm, dsyrk = dsyrk, daxpy = lib.cblas_daxpy}
+end
+
+-- The routines of GSL are used when no CBLAS library can be loaded.
+local function gsl_daxpy(n, alpha, x, incx, y, incy)
+    for i = 0, n - 1 do
+        y[i * incy] = y[i * incy] + alpha * x[i * incx]
+    end
+end
+
+local gsl_routines = {
+    sgemm = gsl.gsl_blas_sgemm,
+    dgemm = gsl.gsl_blas_dgemm,
+    zgemm = gsl.gsl_blas_zgemm,
+    dsyrk = gsl.gsl_blas_dsyrk,
+    daxpy = gsl_daxpy,
+}
+
+local blas = {}
+
+local current_name
+
+-- Select the backend given by its name, by the name of a CBLAS library
+-- or, with "auto", the first optimized backend found. The backend "gsl"
+-- uses the BLAS routines of GSL.
+function blas.select(name)
+    local lib
+    if name == 'auto' then
+        for _, backend in ipairs(backend_order) do
+            lib = load_backend(backend)
+            if lib then name = backend; break end
+        end
+        name = name == 'auto' and 'gsl' or name
+    elseif name ~= 'gsl' then
+        lib = load_backend(name)
+        if not lib then
+            error('cannot find the BLAS library: ' .. name, 2)
+        end
+    end
+    local routines = lib and cblas_routines(lib) or gsl_routines
+    for fname, f in pairs(routines) do blas[fname] = f end
+    blas.lib, current_name = lib, name
+    return name
+end
+
+function blas.backend()
+    return current_name
+end
+
+-- Return the list of the backends that can be loaded.
+function blas.available()
+    local ls = {}
+    for _, name in ipairs(backend_order) do
+        if load_backend(name) then ls[#ls + 1] = name end
+    end
+    ls[#ls + 1] = 'gsl'
+    return ls
+end
+
+function blas.set_threads(n)
+    local fn = threads_fn[current_name]
+    local set = fn and lib_symbol(blas.lib, fn[1])
+    if set then set(n) end
+end
+
+-- Return the number of threads used by the backend, 1 if it cannot be
+-- selected.
+function blas.get_threads()
+    local fn = threads_fn[current_name]
+    local get = fn and lib_symbol(blas.lib, fn[2])
+    return get and tonumber(get()) or 1
+end
+
+blas.select(os.getenv('GSL_SHELL_BLAS') or 'auto')
+
+local nthreads = tonumber(os.getenv('GSL_SHELL_BLAS_THREADS'))
+if nthreads then blas.set_threads(nthreads) end
+
+return blas
@@ -8,6 +8,11 @@ typedef enum {
     GDT_VAL_ERROR = -1,
 } gdt_value_enum;
 
+typedef enum {
+    GDT_LAYOUT_ROW_MAJOR = 0,
+    GDT_LAYOUT_COLUMN_MAJOR,
+} gdt_layout_enum;
+
 typedef union {
     double number;
     const char *string;
@@ -19,10 +24,11 @@ struct __gdt_table_cursor;
 typedef struct __gdt_table gdt_table;
 typedef struct __gdt_table_cursor gdt_table_cursor;
 
-extern gdt_table *         gdt_table_new                (int nb_rows, int nb_columns, int nb_rows_alloc);
+extern gdt_table *         gdt_table_new                (int nb_rows, int nb_columns, int nb_rows_alloc, gdt_layout_enum layout);
 extern void                gdt_table_free               (gdt_table *t);
 extern int                 gdt_table_size1              (const gdt_table *t);
 extern int                 gdt_table_size2              (const gdt_table *t);
+extern gdt_layout_enum     gdt_table_layout             (const gdt_table *t);
 extern gdt_value_enum      gdt_table_get                (const gdt_table *t, int i, int j, gdt_value *value);
 extern gdt_value_enum      gdt_table_get_by_name        (const gdt_table *t, int i, const char* col_name, gdt_value *value);
 extern void                gdt_table_set_number         (gdt_table *t, int i, int j, double num);
@@ -33,12 +39,36 @@ extern void                gdt_table_set_header         (gdt_table *t, int j, co
 extern int                 gdt_table_header_index       (const gdt_table *t, const char* col_name);
 extern int                 gdt_table_insert_columns     (gdt_table *t, int j_in, int n);
 extern int                 gdt_table_insert_rows        (gdt_table *t, int i_in, int n);
+extern int                 gdt_table_remove_rows        (gdt_table *t, int i_in, int n);
+extern gdt_table *         gdt_table_take_rows          (const gdt_table *t, const int *rows, int n);
+extern int                 gdt_table_column_levels      (const gdt_table *t, int j, int *codes, int *level_rows);
 extern gdt_value_enum      gdt_table_cursor_get         (const gdt_table_cursor *c, const char *key, gdt_value *value);
 extern gdt_table_cursor *  gdt_table_get_cursor         (gdt_table *t);
 extern int                 gdt_table_cursor_set_number  (gdt_table_cursor *c, const char *key, double x);
 extern int                 gdt_table_cursor_set_string  (gdt_table_cursor *c, const char *key, const char *x);
 extern int                 gdt_table_cursor_set_undef   (gdt_table_cursor *c, const char *key);
 extern int                 gdt_table_cursor_set_index   (gdt_table_cursor *c, int index);
+extern gdt_value_enum      gdt_table_cursor_get_column  (const gdt_table_cursor *c, int j, gdt_value *value);
+extern int                 gdt_table_cursor_set_column_number (gdt_table_cursor *c, int j, double x);
+extern int                 gdt_table_cursor_set_column_string (gdt_table_cursor *c, int j, const char *x);
+extern int                 gdt_table_cursor_set_column_undef  (gdt_table_cursor *c, int j);
+
+typedef struct {
+    int strip_spaces;
+    gdt_layout_enum layout;
+    int threads;
+} gdt_csv_options;
+
+enum {
+    GDT_CSV_ERROR_OPEN = 1,
+    GDT_CSV_ERROR_TOO_MANY_ROWS,
+    GDT_CSV_ERROR_MEMORY,
+};
+
+extern gdt_table *  gdt_table_read_csv  (const char *filename, const gdt_csv_options *opt, int *error);
+
+extern int          gdt_table_save_binary  (const gdt_table *t, const char *filename);
+extern gdt_table *  gdt_table_load_binary  (const char *filename);
 ]]
 
 return ffi.C
@@ -87,6 +87,7 @@ ffi.cdef [[
 local fft_hc        = ffi.typeof('fft_hc')
 local fft_radix2_hc = ffi.typeof('fft_radix2_hc')
 local gsl_matrix    = ffi.typeof('gsl_matrix')
+local gsl_matrix_float = ffi.typeof('gsl_matrix_float')
 
 local function is_two_power(n)
    if n > 0 then
@@ -153,8 +154,13 @@ local function get_hc_block(ft, ip)
    return b, data, stride
 end
 
+-- The single precision matrices are converted to a new real block so
+-- they cannot be transformed in place.
 function num.fft(x, ip)
    local n = tonumber(x.size1)
+   if ip and ffi.istype(gsl_matrix_float, x) then
+      error('cannot transform in place a float matrix', 2)
+   end
    local b, data, stride = get_matrix_block(x, ip)
    if is_two_power(n) then
       gsl_check(gsl.gsl_fft_real_radix2_transform(data, stride, n))
@@ -274,12 +280,7 @@ local function hc_newindex(ft, k, z)
 end
 
 local function hc_free(hc)
-   local b = hc.block
-   b.ref_count = b.ref_count - 1
-   if b.ref_count == 0 then
-      ffi.C.free(b.data)
-      ffi.C.free(b)
-   end
+   matrix.block_unref(hc.block)
 end
 
 ffi.metatype(fft_hc, {
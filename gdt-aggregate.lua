@@ -0,0 +1,234 @@
+use 'strict'
+
+local expr_parse = require 'expr-parse'
+local expr_print = require 'expr-print'
+local gdt_expr = require 'gdt-expr'
+local AST = require 'expr-actions'
+
+local sqrt, floor, huge = math.sqrt, math.floor, math.huge
+local sort = table.sort
+local type, ipairs = type, ipairs
+
+local gdt_aggregate = {}
+
+-- Index of the distinct combinations of values of a list of columns.
+-- Each combination, or key, identifies a group and the groups are
+-- numbered in order of first appearance. The groups are found with a
+-- tree of hash tables, one level for each column, so that a key is
+-- allocated only when a new group is found.
+function gdt_aggregate.group_index(t, js)
+    return {table = t, columns = js, root = {}, keys = {}}
+end
+
+-- Return the group of the row "i" of the table, adding a new group if
+-- needed, or nil if one of the values is undefined or NaN.
+function gdt_aggregate.group_lookup(index, i)
+    local t, js = index.table, index.columns
+    local n, get = #js, gdt.get_unsafe
+    if n == 0 then
+        index.keys[1] = index.keys[1] or {}
+        return 1
+    end
+    local node = index.root
+    for k = 1, n do
+        local v = get(t, i, js[k])
+        if v == nil or v ~= v then return nil end
+        local child = node[v]
+        if child == nil then
+            if k < n then
+                child = {}
+            else
+                child = #index.keys + 1
+                local key = {}
+                for q = 1, n do key[q] = get(t, i, js[q]) end
+                index.keys[child] = key
+            end
+            node[v] = child
+        end
+        node = child
+    end
+    return node
+end
+
+-- Return the group of the row "i" of the table or nil if the row does
+-- not belong to any existing group.
+function gdt_aggregate.group_find(index, i)
+    local t, js = index.table, index.columns
+    local n, get = #js, gdt.get_unsafe
+    if n == 0 then
+        return (index.keys[1] and 1 or nil)
+    end
+    local node = index.root
+    for k = 1, n do
+        local v = get(t, i, js[k])
+        if v == nil or v ~= v then return nil end
+        node = node[v]
+        if node == nil then return nil end
+    end
+    return node
+end
+
+-- Order numbers before strings so that keys with mixed types can be
+-- sorted.
+local function value_less(a, b)
+    local ta, tb = type(a), type(b)
+    if ta ~= tb then return ta == 'number' end
+    return a < b
+end
+
+function gdt_aggregate.key_less(a, b)
+    for k = 1, #a do
+        local x, y = a[k], b[k]
+        if x ~= y then return value_less(x, y) end
+    end
+    return false
+end
+
+-- Accumulator of the values of a group. The mean and the sum of the
+-- squared deviations are updated with Welford's method. The values
+-- themselves are stored only if they are needed to compute the
+-- median.
+function gdt_aggregate.accu_new(keep_values)
+    return {n = 0, mean = 0, m2 = 0, sum = 0, min = huge, max = -huge, values = keep_values and {} or nil}
+end
+
+function gdt_aggregate.accu_add(a, x)
+    local n = a.n + 1
+    local d = x - a.mean
+    a.n = n
+    a.mean = a.mean + d / n
+    a.m2 = a.m2 + d * (x - a.mean)
+    a.sum = a.sum + x
+    if x < a.min then a.min = x end
+    if x > a.max then a.max = x end
+    if a.values then a.values[n] = x end
+end
+
+local function accu_median(a)
+    local n, vs = a.n, a.values
+    if n == 0 then return end
+    sort(vs)
+    local h = floor(n / 2)
+    if n % 2 == 1 then return vs[h + 1] end
+    return (vs[h] + vs[h + 1]) / 2
+end
+
+-- Each statistic gives its value from an accumulator or nil if there
+-- are not enough values.
+local stats = {
+    mean    = function(a) if a.n > 0 then return a.mean end end,
+    stddev  = function(a) if a.n > 1 then return sqrt(a.m2 / (a.n - 1)) end end,
+    stddevp = function(a) if a.n > 0 then return sqrt(a.m2 / a.n) end end,
+    var     = function(a) if a.n > 0 then return a.m2 / a.n end end,
+    sum     = function(a) return a.sum end,
+    count   = function(a) return a.n end,
+    min     = function(a) if a.n > 0 then return a.min end end,
+    max     = function(a) if a.n > 0 then return a.max end end,
+    median  = accu_median,
+}
+
+gdt_aggregate.stats = stats
+
+-- Return a list with, for each expression, its name, the statistic to
+-- compute and the expression of the values. An expression that is not
+-- in the form "stat(expr)" gives the mean of its values.
+function gdt_aggregate.stat_exprs(exprs)
+    local ys = {}
+    for i, expr in ipairs(exprs) do
+        local stat_name, yexpr = 'mean', expr
+        if expr.func and stats[expr.func] then
+            stat_name, yexpr = expr.func, expr.arg
+        end
+        ys[i] = {
+            name   = expr_print.expr(expr),
+            stat   = stats[stat_name],
+            median = (stat_name == 'median'),
+            expr   = yexpr,
+        }
+    end
+    return ys
+end
+
+function gdt_aggregate.column_indexes(t, exprs)
+    local js = {}
+    for i, expr in ipairs(exprs) do
+        local is_var, var_name = AST.is_variable(expr)
+        if not is_var then
+            local repr = expr_print.expr(expr)
+            error('invalid enumeration factor: ' .. repr)
+        end
+        js[i] = t:col_index(var_name)
+        if not js[i] then error('invalid column name: ' .. var_name) end
+    end
+    return js
+end
+
+-- Return a table with a row for each group of rows of "t" with the same
+-- values in the columns "js" and a column with the statistic of each
+-- expression in "ys". The rows are sorted by the values of the group.
+local function aggregate(t, js, ys, conds)
+    local index = gdt_aggregate.group_index(t, js)
+    local conditions_pass = gdt_expr.compile_conditions(t, conds)
+    local NY = #ys
+    local fs, accus = {}, {}
+    for p = 1, NY do
+        fs[p] = gdt_expr.compile(t, ys[p].expr)
+        accus[p] = {}
+    end
+
+    local group_lookup, accu_add = gdt_aggregate.group_lookup, gdt_aggregate.accu_add
+    for i = 1, #t do
+        if conditions_pass(i) then
+            local g = group_lookup(index, i)
+            if g then
+                for p = 1, NY do
+                    local v = fs[p](i)
+                    if v then
+                        local a = accus[p][g]
+                        if not a then
+                            a = gdt_aggregate.accu_new(ys[p].median)
+                            accus[p][g] = a
+                        end
+                        accu_add(a, v)
+                    end
+                end
+            end
+        end
+    end
+
+    local keys = index.keys
+    local order = {}
+    for g = 1, #keys do order[g] = g end
+    local key_less = gdt_aggregate.key_less
+    sort(order, function(a, b) return key_less(keys[a], keys[b]) end)
+
+    local NJ = #js
+    local headers = {}
+    for k = 1, NJ do headers[k] = t:header(js[k]) end
+    for p = 1, NY do headers[NJ + p] = ys[p].name end
+
+    local r = gdt.alloc(#order, headers)
+    for i, g in ipairs(order) do
+        local key = keys[g]
+        for k = 1, NJ do
+            r:set(i, k, key[k])
+        end
+        for p = 1, NY do
+            local a = accus[p][g]
+            r:set(i, NJ + p, a and ys[p].stat(a) or nil)
+        end
+    end
+    return r
+end
+
+function gdt.aggregate(t, descr)
+    local schema = expr_parse.schema_multivar(descr, AST)
+    local js = gdt_aggregate.column_indexes(t, schema.x)
+    for _, j in ipairs(gdt_aggregate.column_indexes(t, schema.enums)) do
+        js[#js + 1] = j
+    end
+    local ys = gdt_aggregate.stat_exprs(schema.y)
+    return aggregate(t, js, ys, schema.conds)
+end
+
+return gdt_aggregate
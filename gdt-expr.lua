@@ -1,17 +1,14 @@
+local ffi = require 'ffi'
 local expr_print = require 'expr-print'
+local AST = require 'expr-actions'
 
 local pairs, ipairs = pairs, ipairs
+local format, concat = string.format, table.concat
+local huge = math.huge
+local gdt_value = ffi.typeof('gdt_value')
 
 local gdt_expr = {}
 
-local function list_add_unique(ls, x)
-    local n = #ls
-    for i = 1, n do
-        if ls[i] == x then return end
-    end
-    ls[n+1] = x
-end
-
 local function level_number(factors, levels)
     if not factors then return 0 end
     local nb = 1
@@ -50,6 +47,145 @@ local table_scope = {
 
 gdt_expr.table_scope = table_scope
 
+-- Expressions are compiled into a Lua function of the row index that
+-- gives the same result of expr_print.eval with the table scope. The
+-- column indexes and the constants are resolved once at compile time
+-- and the function returns nil as soon as an undefined value is read.
+-- The numbers are written as literals and the other constants are
+-- taken from the table "k". The subexpressions are inlined so that only
+-- the columns are stored in local variables, each read in its own
+-- gdt_value. The arithmetic operators are given with the Lua precedence
+-- of the result so that the parentheses are added only when needed and
+-- a long sum does not nest beyond the limits of the parser.
+local compile_operators = {
+    ['+']   = {'%s + %s', 6},
+    ['-']   = {'%s - %s', 6},
+    ['*']   = {'%s * %s', 7},
+    ['/']   = {'%s / %s', 7},
+    ['^']   = {'%s ^ %s', 10},
+    ['=']   = {'(%s == %s and 1 or 0)'},
+    ['!=']  = {'(%s ~= %s and 1 or 0)'},
+    ['>']   = {'(%s > %s and 1 or 0)'},
+    ['<']   = {'(%s < %s and 1 or 0)'},
+    ['>=']  = {'(%s >= %s and 1 or 0)'},
+    ['<=']  = {'(%s <= %s and 1 or 0)'},
+    ['and'] = {'((%s ~= 0 and %s ~= 0) and 1 or 0)'},
+    ['or']  = {'((%s ~= 0 or %s ~= 0) and 1 or 0)'},
+}
+
+-- precedence of the constants, the variables, the function calls and
+-- the parenthesized expressions
+local ATOM_PREC = 11
+local UNARY_PREC = 8
+local POWER_PREC = 10
+
+local function paren(code, prec, min_prec)
+    return prec < min_prec and '(' .. code .. ')' or code
+end
+
+local function compile_const(st, value)
+    local n = #st.consts + 1
+    st.consts[n] = value
+    return format('k[%d]', n)
+end
+
+-- the JIT compiler specializes the operations with a literal, for
+-- example the square x^2. The negative numbers have the precedence of
+-- the unary minus. The zero, whose sign a literal can lose, and the
+-- infinities are kept in "k".
+local function compile_number(st, x)
+    if x ~= 0 and x > -huge and x < huge then
+        return format('%.17g', x), (x < 0 and UNARY_PREC or ATOM_PREC)
+    end
+    return compile_const(st, x), ATOM_PREC
+end
+
+-- return the code of the expression and its precedence
+local function compile_rec(st, expr)
+    if type(expr) == 'number' then
+        return compile_number(st, expr)
+    elseif expr.literal then
+        return compile_const(st, expr.literal), ATOM_PREC
+    elseif type(expr) == 'string' then
+        local _, var_name = AST.is_variable(expr)
+        local name = st.columns[var_name]
+        if not name then
+            local j = st.table:col_index(var_name)
+            if not j then error(format('invalid column name "%s"', var_name)) end
+            st.ncol = st.ncol + 1
+            name = 'c' .. st.ncol
+            st.code[#st.code + 1] = format('local %s = get(t, i, %d, vals[%d])', name, j, st.ncol)
+            st.code[#st.code + 1] = format('if %s == nil then return nil end', name)
+            st.columns[var_name] = name
+        end
+        return name, ATOM_PREC
+    elseif expr.func then
+        local f = math[expr.func]
+        if not f then error('unknown function: ' .. expr.func) end
+        local a = compile_rec(st, expr.arg)
+        return format('%s(%s)', compile_const(st, f), a), ATOM_PREC
+    elseif #expr == 1 then
+        -- the operand of the unary minus never starts with a minus, that
+        -- would begin a comment
+        local a, a_prec = compile_rec(st, expr[1])
+        return '-' .. paren(a, a_prec, UNARY_PREC + 1), UNARY_PREC
+    else
+        local op = compile_operators[expr.operator]
+        if not op then error('unknown operation: ' .. expr.operator) end
+        local a, a_prec = compile_rec(st, expr[1])
+        local b, b_prec = compile_rec(st, expr[2])
+        local prec = op[2]
+        if not prec then
+            return format(op[1], a, b), ATOM_PREC
+        elseif prec == POWER_PREC then
+            -- the power is right associative and binds tighter than the
+            -- unary minus on its left
+            return format(op[1], paren(a, a_prec, ATOM_PREC), paren(b, b_prec, prec)), prec
+        else
+            return format(op[1], paren(a, a_prec, prec), paren(b, b_prec, prec + 1)), prec
+        end
+    end
+end
+
+-- return a function f(i) that evaluates the expression for the row "i"
+-- of the table "t". If the generated code exceeds the limits of the Lua
+-- compiler, for example because the expression is too deeply nested,
+-- the function evaluates the expression with expr_print.eval.
+function gdt_expr.compile(t, expr)
+    local st = {table = t, consts = {}, columns = {}, code = {}, ncol = 0}
+    local result = compile_rec(st, expr)
+    local src = {'local get, t, k, vals = ...', 'return function(i)'}
+    for _, line in ipairs(st.code) do
+        src[#src + 1] = line
+    end
+    src[#src + 1] = format('return %s', result)
+    src[#src + 1] = 'end'
+    local chunk = loadstring(concat(src, '\n'), '=(gdt expr)')
+    if not chunk then
+        return function(i) return expr_print.eval(expr, table_scope, t, i) end
+    end
+    local vals = {}
+    for n = 1, st.ncol do vals[n] = gdt_value() end
+    return chunk(gdt.get_unsafe, t, st.consts, vals)
+end
+
+-- return a function f(i) that is true if the row "i" of the table
+-- satisfies all the conditions. An undefined condition is satisfied.
+function gdt_expr.compile_conditions(t, conds)
+    local n = #conds
+    if n == 0 then return function() return true end end
+    local fs = {}
+    for k = 1, n do
+        fs[k] = gdt_expr.compile(t, conds[k])
+    end
+    return function(i)
+        for k = 1, n do
+            if fs[k](i) == 0 then return false end
+        end
+        return true
+    end
+end
+
 local function map_missing_rows(t, expr_list, y_expr_scalar, conditions)
     local refs, factor_refs, levels = {}, {}, {}
     for k, expr in ipairs(expr_list) do
@@ -59,28 +195,45 @@ local function map_missing_rows(t, expr_list, y_expr_scalar, conditions)
         expr_print.references(y_expr_scalar, refs)
     end
 
+    -- the levels of each factor are given by the levels of the column
+    -- restricted to the valid rows, in order of first appearance
+    local factors = {}
     for factor_name in pairs(factor_refs) do
+        local values, codes = gdt.level_codes(t, factor_name)
+        factors[#factors + 1] = {name = factor_name, values = values, codes = codes, seen = {}}
         levels[factor_name] = {}
     end
 
+    local ref_columns = {}
+    for col_name in pairs(refs) do
+        local j = t:col_index(col_name)
+        if not j then error(format('invalid column name "%s"', col_name)) end
+        ref_columns[#ref_columns + 1] = j
+    end
+    local conditions_pass = gdt_expr.compile_conditions(t, conditions)
+    local get = gdt.get_unsafe
+
     local N = #t
     local index_map = {}
     local map_i, map_len = 1, 0
     for i = 1, N do
         local row_undef = false
-        for col_name in pairs(refs) do
-            row_undef = row_undef or (not t:get(i, col_name))
+        for k = 1, #ref_columns do
+            row_undef = row_undef or (get(t, i, ref_columns[k]) == nil)
         end
 
         if not row_undef then
-            for _, cond in ipairs(conditions) do
-                local cx = expr_print.eval(cond, table_scope, t, i)
-                row_undef = row_undef or (cx == 0)
-            end
+            row_undef = not conditions_pass(i)
         end
         if not row_undef then
-            for col_name in pairs(factor_refs) do
-                list_add_unique(levels[col_name], t:get(i, col_name))
+            for k = 1, #factors do
+                local f = factors[k]
+                local c = f.codes[i - 1]
+                if not f.seen[c] then
+                    f.seen[c] = true
+                    local ls = levels[f.name]
+                    ls[#ls + 1] = f.values[c + 1]
+                end
             end
         end
         if row_undef then
@@ -195,12 +348,42 @@ local function predlist_add_coeff_names(names, pred_list, expr)
     end
 end
 
-local function eval_pred_list(t, pred, i)
-    local match = true
+-- return a function f(i) that gives 1 if the row "i" matches all the
+-- levels of the predicate or 0 otherwise. The rows are matched by
+-- comparing the level codes of the factor columns.
+local function compile_pred_list(t, pred, factor_codes)
+    local codes_list, level_codes = {}, {}
     for k, name, level in iter_by_two, pred, -1 do
-        match = match and (t:get(i, name) == level)
+        local fc = factor_codes(name)
+        codes_list[#codes_list + 1] = fc.codes
+        level_codes[#level_codes + 1] = fc.code_of[level] or -2
+    end
+    local n = #codes_list
+    return function(i)
+        for k = 1, n do
+            if codes_list[k][i - 1] ~= level_codes[k] then return 0 end
+        end
+        return 1
+    end
+end
+
+-- return a function that gives, for the name of a factor column, its
+-- level codes and a table that maps each level to its code.
+local function factor_codes_cache(t)
+    local cache = {}
+    return function(name)
+        local fc = cache[name]
+        if not fc then
+            local values, codes = gdt.level_codes(t, name)
+            local code_of = {}
+            for c, v in ipairs(values) do
+                if v == v then code_of[v] = c - 1 end
+            end
+            fc = {codes = codes, code_of = code_of}
+            cache[name] = fc
+        end
+        return fc
     end
-    return (match and 1 or 0)
 end
 
 local function eval_coeff_names(expr_list, levels)
@@ -241,10 +424,12 @@ function gdt_expr.eval_matrix(t, info, expr_list, y_expr, index_map)
     end
 
     local NE, XM = #expr_list, info.dim
+    local factor_codes = factor_codes_cache(t)
 
     local function set_scalar_column(X, expr_scalar, j)
+        local f = gdt_expr.compile(t, expr_scalar)
         for _, i, x_i in index_map_iter, index_map, {-1, 0, 0} do
-            local xs = expr_print.eval(expr_scalar, table_scope, t, i)
+            local xs = f(i)
             assert(xs, string.format('missing value in data table at row: %d', i))
             X:set(x_i, j, xs)
         end
@@ -252,12 +437,16 @@ function gdt_expr.eval_matrix(t, info, expr_list, y_expr, index_map)
 
     local function set_contrasts_matrix(X, expr, j)
         local pred_list = eval_predicates(expr.factor, info.levels)
+        local f = gdt_expr.compile(t, expr.scalar)
+        local pred_fs = {}
+        for k, pred in ipairs(pred_list) do
+            pred_fs[k] = compile_pred_list(t, pred, factor_codes)
+        end
         for _, i, x_i in index_map_iter, index_map, {-1, 0, 0} do
-            local xs = expr_print.eval(expr.scalar, table_scope, t, i)
+            local xs = f(i)
             assert(xs, string.format('missing value in data table at row: %d', i))
-            for k, pred in ipairs(pred_list) do
-                local fs = eval_pred_list(t, pred, i)
-                X:set(x_i, j + (k - 1), xs * fs)
+            for k, pred_f in ipairs(pred_fs) do
+                X:set(x_i, j + (k - 1), xs * pred_f(i))
             end
         end
     end
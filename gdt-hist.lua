@@ -17,17 +17,15 @@ local function gdt_table_hist(t, expr_formula, opt)
     local dv = gdt_expr.eval_matrix(t, info, x_exprs, nil, index_map)
     local n = #dv
 
-    dv:sort()
-
-    local Q1 = gsl.gsl_stats_quantile_from_sorted_data(dv.data, dv.tda, n, 0.25)
-    local Q3 = gsl.gsl_stats_quantile_from_sorted_data(dv.data, dv.tda, n, 0.75)
+    local Q1 = matrix.quantile(dv, 0.25)
+    local Q3 = matrix.quantile(dv, 0.75)
 
     local a, b
     if opt and opt.a and opt.b then
         a, b = opt.a, opt.b
         assert(a < b, "invalid histogram limits")
     else
-        a, b = dv.data[0], dv.data[n - 1]
+        a, b = matrix.quantile(dv, 0), matrix.quantile(dv, 1)
     end
 
     local IQR = Q3 - Q1
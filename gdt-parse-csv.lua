@@ -1,6 +1,7 @@
 local ffi = require 'ffi'
 local gdt = require 'gdt'
 local csv = require 'csv'
+local cgdt = require 'cgdt'
 
 local max = math.max
 local match, gsub = string.match, string.gsub
@@ -161,5 +162,57 @@ function gdt.write_csv(t, filename)
 	f:close()
 end
 
-gdt.read_csv = function(filename, options) return gdt_parse(source_csv(filename, options)) end
+local csv_options = ffi.typeof('gdt_csv_options')
+
+local csv_errors = {
+	[cgdt.GDT_CSV_ERROR_OPEN] = 'cannot open file: %s',
+	[cgdt.GDT_CSV_ERROR_TOO_MANY_ROWS] = 'cannot read file: %s, more than 2147483647 rows',
+	[cgdt.GDT_CSV_ERROR_MEMORY] = 'cannot read file: %s, not enough memory',
+}
+
+local csv_error = ffi.new('int[1]')
+
+local layout_lookup = {
+	row    = cgdt.GDT_LAYOUT_ROW_MAJOR,
+	column = cgdt.GDT_LAYOUT_COLUMN_MAJOR,
+}
+
+-- read the CSV file in a single pass using the C reader.
+-- The table is created directly in C without creating Lua strings
+-- for each field.
+-- Unlike gdt_parse the C reader skips the empty lines, instead of
+-- storing a row of undefined values, and accepts newlines in quoted
+-- fields. A quote without the closing quote is not an error, the
+-- field extends up to the end of the file. The carriage returns of
+-- CRLF line endings are removed even if the spaces are not stripped.
+local function read_csv_native(filename, options)
+	local opt = csv_options()
+	opt.strip_spaces = 1
+	opt.layout = cgdt.GDT_LAYOUT_ROW_MAJOR
+	if options then
+		if options.strip_spaces ~= nil then
+			opt.strip_spaces = options.strip_spaces and 1 or 0
+		end
+		if options.layout then
+			local layout = layout_lookup[options.layout]
+			if not layout then error('invalid table layout: ' .. tostring(options.layout)) end
+			opt.layout = layout
+		end
+		if options.threads then
+			opt.threads = options.threads
+		end
+	end
+	local t = cgdt.gdt_table_read_csv(filename, opt, csv_error)
+	if t == nil then
+		error(string.format(csv_errors[csv_error[0]] or 'cannot read file: %s', filename))
+	end
+	return ffi.gc(t, cgdt.gdt_table_free)
+end
+
+gdt.read_csv = function(filename, options)
+	if options and options.native == false then
+		return gdt_parse(source_csv(filename, options))
+	end
+	return read_csv_native(filename, options)
+end
 gdt.def = function(def) return gdt_parse(source_def(def)) end
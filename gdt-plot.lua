@@ -4,173 +4,89 @@ local expr_parse = require 'expr-parse'
 local expr_print = require 'expr-print'
 local gdt_expr = require 'gdt-expr'
 local gdt_factors = require 'gdt-factors'
+local gdt_aggregate = require 'gdt-aggregate'
 local check = require 'check'
 local mon = require 'monomial'
 local AST = require 'expr-actions'
 local algo = require 'algorithm'
 
 local concat = table.concat
-local unpack, ipairs = unpack, ipairs
-local sqrt = math.sqrt
+local unpack, ipairs, pairs = unpack, ipairs, pairs
 
 local line_width = 2.5
 
-local table_scope = gdt_expr.table_scope
-
 local function collate(ls, sep)
     return concat(ls, sep or ' ')
 end
 
--- recursive algorithm to computer the standard deviation from
--- wikipedia: http://en.wikipedia.org/wiki/Standard_deviation.
--- Welford, BP. "Note on a Method for Calculating Corrected Sums of
--- Squares and Products". Technometrics 4 (3): 419–420
-local function f_stddev(accu, x, n)
-    local A, Q, km = unpack(accu)
-    accu[1] = A + (x - A) / (km + 1)
-    accu[2] = Q + km / (km + 1) * (x - A)^2
-    accu[3] = km + 1
-    return accu
-end
-
-local function f_stddevp_fini(accu)
-    local A, Q, n = unpack(accu)
-    if n > 0 then return sqrt(Q / n) end
-end
-
-local function f_stddev_fini(accu)
-    local A, Q, n = unpack(accu)
-    if n > 1 then return sqrt(Q / (n - 1)) end
-end
-
-local function f_var_fini(accu)
-    local A, Q, n = unpack(accu)
-    if n > 0 then return Q / n end
-end
-
-local stat_lookup = {
-    mean    = {f = function(accu, x, n) return (accu * (n-1) + x) / n end},
-    stddev  = {f = f_stddev, f0 = || {0, 0, 0}, fini = f_stddev_fini},
-    stddevp = {f = f_stddev, f0 = || {0, 0, 0}, fini = f_stddevp_fini},
-    var     = {f = f_stddev, f0 = || {0, 0, 0}, fini = f_var_fini},
-    sum     = {f = function(accu, x, n) return accu + x end},
-    count   = {f = function(accu, x, n) return n end},
-}
-
-local function sort_labels_func(lab_a, lab_b)
-    local n = #lab_a
-    for k = 1, n do
-        local a, b = lab_a[k], lab_b[k]
-        if a ~= b then return a < b end
-    end
-    return false
-end
-
-local function compare_list(a, b)
-    local n = #a
-    for k = 1, n do
-        if a[k] ~= b[k] then return false end
-    end
-    return true
-end
-
-local function has_undef_values(ls)
-    local n = #ls
-    for k = 1, n do
-        if not ls[k] then return true end
-    end
-    return false
-end
-
-local function add_unique(ls, e)
-    if has_undef_values(e) then return 0 end
-
-    local n = #ls
-    for i = 1, n do
-        if compare_list(ls[i], e) then return i end
-    end
-    ls[n + 1] = e
-    return n + 1
-end
-
-local function collate_factors(t, i, js)
-    local c = {}
-    local n = #js
-    for k = 1, n do
-        c[k] = t:get(i, js[k]) -- tostring(t:get(i, js[k]))
-    end
-    return c
-end
-
-local function vec2d_get(r, i, j)
-    if r[i] and r[i][j] then
-        return r[i][j]
-    end
-end
-
-local function vec2d_set(r, i, j, v)
-    if not r[i] then r[i] = {} end
-    r[i][j] = v
-end
-
-local function vec2d_incr(r, i, j)
-    if not r[i] then r[i] = {} end
-    local v = r[i][j] or 0
-    r[i][j] = v + 1
-    return v + 1
-end
-
-local function eval_conditions(conds, t, i)
-    local pass = true
-    for _, cond in ipairs(conds) do
-        local cx = expr_print.eval(cond, table_scope, t, i)
-        pass = pass and (cx ~= 0)
-    end
-    return pass
-end
-
+-- Compute the statistics of the expressions "jys" for each label,
+-- given by the values of the columns "jxs", and for each enumeration,
+-- given by the values of the columns "jes" and the expression's name.
+-- Return the list of labels, sorted, the list of enumerations and the
+-- table of values indexed by label and enumeration.
 local function rect_funcbin(t, jxs, jys, jes, conds)
     local n = #t
-    local val, count = {}, {}
-    local enums, labels = {}, {}
-    local fini_table = {}
+    local label_index = gdt_aggregate.group_index(t, jxs)
+    local enum_index = gdt_aggregate.group_index(t, jes)
+    local group_lookup = gdt_aggregate.group_lookup
+    local accu_new, accu_add = gdt_aggregate.accu_new, gdt_aggregate.accu_add
+    local conditions_pass = gdt_expr.compile_conditions(t, conds)
+    local y_fs = {}
+    for p = 1, #jys do
+        y_fs[p] = gdt_expr.compile(t, jys[p].expr)
+    end
+
+    local enums, enum_ids, enum_stat = {}, {}, {}
+    local accus = {}
     for i = 1, n do
-        local c = collate_factors(t, i, jxs)
-        for p = 1, #jys do
-            local jp = jys[p]
-            local fy, fini = jp.f, jp.fini
-            local f0 = jp.f0 and jp.f0() or 0
-            local e = collate_factors(t, i, jes)
-            e[#e+1] = jp.name
-
-            local v = expr_print.eval(jp.expr, table_scope, t, i)
-            local pass = eval_conditions(conds, t, i)
-
-            if pass and v then
-                local ie = add_unique(enums, e)
-                local ix = ie > 0 and add_unique(labels, c) or 0
-                if ix > 0 then
-                    local cc = vec2d_incr(count, ix, ie)
-                    local v_accu = vec2d_get(val, ix, ie) or f0
-                    vec2d_set(val, ix, ie, fy(v_accu, v, cc))
-                    fini_table[ie] = fini
+        local ge = conditions_pass(i) and group_lookup(enum_index, i)
+        if ge then
+            local ids = enum_ids[ge]
+            if not ids then
+                ids = {}
+                enum_ids[ge] = ids
+            end
+            local ix
+            for p = 1, #jys do
+                local v = y_fs[p](i)
+                if v then
+                    local ie = ids[p]
+                    if not ie then
+                        local e = {unpack(enum_index.keys[ge])}
+                        e[#e+1] = jys[p].name
+                        ie = #enums + 1
+                        enums[ie], enum_stat[ie], ids[p] = e, jys[p], ie
+                    end
+                    ix = ix or group_lookup(label_index, i)
+                    if ix then
+                        local row = accus[ix]
+                        if not row then
+                            row = {}
+                            accus[ix] = row
+                        end
+                        local a = row[ie]
+                        if not a then
+                            a = accu_new(jys[p].median)
+                            row[ie] = a
+                        end
+                        accu_add(a, v)
+                    end
                 end
             end
         end
     end
 
-    for ie, enum in ipairs(enums) do
-        local fini = fini_table[ie]
-        if fini then
-            for ix = 1, #labels do
-                local v = vec2d_get(val, ix, ie)
-                local v_fin = fini(v)
-                vec2d_set(val, ix, ie, v_fin)
-            end
+    local labels = label_index.keys
+    local val = {}
+    for ix = 1, #labels do
+        local row, accu_row = {}, accus[ix]
+        for ie, a in pairs(accu_row) do
+            row[ie] = enum_stat[ie].stat(a)
         end
+        val[ix] = row
     end
 
-    algo.quicksort_mirror(labels, val, 1, #labels, sort_labels_func)
+    algo.quicksort_mirror(labels, val, 1, #labels, gdt_aggregate.key_less)
 
     return labels, enums, val
 end
@@ -195,14 +111,6 @@ local function extract_parameter_title(enums)
     end
 end
 
-local function get_stat(expr)
-    if expr.func and stat_lookup[expr.func]then
-        return expr.func, expr.arg
-    else
-        return 'mean', expr
-    end
-end
-
 local rect, webcolor, path = graph.rect, graph.webcolor, graph.path
 
 function gen_xlabels(plt, labels)
@@ -326,34 +234,8 @@ function lineplot.legend(plt, labels, enums, legend_title)
     add_category_legend(plt, "line", labels, enums, legend_title)
 end
 
-local function idents_get_column_indexes(t, exprs)
-    local jxs = {}
-    for i, expr in ipairs(exprs) do
-        local is_var, var_name = AST.is_variable(expr)
-        if not is_var then
-            local repr = expr_print.expr(expr)
-            error('invalid enumeration factor: ' .. repr)
-        end
-        jxs[i] = t:col_index(var_name)
-    end
-    return jxs
-end
-
-local function stat_expr_get_functions(exprs)
-    local jys = {}
-    for i, expr in ipairs(exprs) do
-        local stat_name, yexpr = get_stat(expr)
-        local s = stat_lookup[stat_name]
-        jys[i] = {
-            f     = s.f,
-            f0    = s.f0,
-            fini  = s.fini,
-            name  = expr_print.expr(expr),
-            expr  = yexpr,
-        }
-    end
-    return jys
-end
+local idents_get_column_indexes = gdt_aggregate.column_indexes
+local stat_expr_get_functions = gdt_aggregate.stat_exprs
 
 local function expr_get_functions(exprs)
     local jys = {}
@@ -420,13 +302,17 @@ function gdt.xyline(t, plot_descr)
     local jx, jy = jxs[1], jys[1]
     local n = #t
 
+    local x_f = gdt_expr.compile(t, jx.expr)
+    local y_f = gdt_expr.compile(t, jy.expr)
+    local conditions_pass = gdt_expr.compile_conditions(t, schema.conds)
+
     local ln = path()
     local path_method = ln.move_to
     for i = 1, n do
-        local x = expr_print.eval(jx.expr, table_scope, t, i)
-        local y = expr_print.eval(jy.expr, table_scope, t, i)
+        local x = x_f(i)
+        local y = y_f(i)
         -- eval the conditions of the current row
-        local pass = eval_conditions(schema.conds, t, i)
+        local pass = conditions_pass(i)
         if pass and x and y then
             path_method(ln, x, y)
             path_method = ln.line_to
@@ -452,15 +338,21 @@ local function gdt_table_xyplot(t, plot_descr, opt)
     local jes = idents_get_column_indexes(t, schema.enums)
     local jx = jxs[1]
 
-    local enums = {}
+    local x_f = gdt_expr.compile(t, jx.expr)
+    local conditions_pass = gdt_expr.compile_conditions(t, schema.conds)
+
+    local enum_index = gdt_aggregate.group_index(t, jes)
     local n = #t
     for i = 1, n do
-        local pass = eval_conditions(schema.conds, t, i)
-        if pass then
-            local e = collate_factors(t, i, jes)
-            add_unique(enums, e)
+        if conditions_pass(i) then
+            gdt_aggregate.group_lookup(enum_index, i)
         end
     end
+    local enums = enum_index.keys
+    local row_enum = {}
+    for i = 1, n do
+        row_enum[i] = gdt_aggregate.group_find(enum_index, i) or 0
+    end
 
     local plt, lg = graph.plot(), graph.plot()
     plt.pad, plt.clip = true, false
@@ -468,15 +360,15 @@ local function gdt_table_xyplot(t, plot_descr, opt)
     local mult = #enums * #jys
     for p = 1, #jys do
         local name = jys[p].name
+        local y_f = gdt_expr.compile(t, jys[p].expr)
         for q, enum in ipairs(enums) do
             local ln = path()
             local path_method = ln.move_to
             for i = 1, n do
-                local e = collate_factors(t, i, jes)
-                if compare_list(enum, e) then
-                    local x = expr_print.eval(jx.expr, table_scope, t, i)
-                    local y = expr_print.eval(jys[p].expr, table_scope, t, i)
-                    local pass = eval_conditions(schema.conds, t, i)
+                if row_enum[i] == q then
+                    local x = x_f(i)
+                    local y = y_f(i)
+                    local pass = conditions_pass(i)
                     if pass and x and y then
                         path_method(ln, x, y)
                         path_method = ln.line_to
@@ -44,6 +44,17 @@ local function gdt_table_get(t, i, j)
     return extract_value(e, val)
 end
 
+-- return the value of the element at row "i" and column "j" without
+-- checking the indexes. The element is read in the gdt_value "val", if
+-- given. A hot loop that reads several columns gives a different value
+-- for each of them: the JIT compiler mixes up the reads of different
+-- elements in the same value.
+local function gdt_table_get_unsafe(t, i, j, val)
+    val = val or gdt_value()
+    local e = cgdt.gdt_table_get(t, i - 1, j - 1, val)
+    return extract_value(e, val)
+end
+
 local function gdt_table_get_number_unsafe(t, i, j)
     local val = gdt_value()
     local e = cgdt.gdt_table_get(t, i - 1, j - 1, val)
@@ -77,14 +88,23 @@ local function gdt_table_set(t, i, j_name, val)
     gdt_table_set_unsafe(t, i, j, val)
 end
 
-local function gdt_table_alloc(nrows, ncols, nalloc_rows)
+local layout_lookup = {
+    row    = cgdt.GDT_LAYOUT_ROW_MAJOR,
+    column = cgdt.GDT_LAYOUT_COLUMN_MAJOR,
+}
+
+-- the optional "layout" argument can be either "row" (default) or
+-- "column" to store the elements of each column contiguously.
+local function gdt_table_alloc(nrows, ncols, nalloc_rows, layout)
     nalloc_rows = nalloc_rows or max(nrows, 8)
     local headers
     if type(ncols) == 'table' then
         headers = ncols
         ncols = #headers
     end
-    local t = cgdt.gdt_table_new(nrows, ncols, nalloc_rows)
+    local layout_id = layout_lookup[layout or 'row']
+    if not layout_id then error('invalid table layout: ' .. tostring(layout)) end
+    local t = cgdt.gdt_table_new(nrows, ncols, nalloc_rows, layout_id)
     if t == nil then error('cannot allocate table: not enough memory') end
     if headers then
         for k, str in ipairs(headers) do
@@ -94,8 +114,8 @@ local function gdt_table_alloc(nrows, ncols, nalloc_rows)
     return ffi.gc(t, cgdt.gdt_table_free)
 end
 
-local function gdt_table_new(nrows, cols_spec)
-    local t = gdt_table_alloc(nrows, cols_spec)
+local function gdt_table_new(nrows, cols_spec, layout)
+    local t = gdt_table_alloc(nrows, cols_spec, nil, layout)
     local ncols = size2(t)
     for i = 1, nrows do
         for j = 1, ncols do
@@ -107,6 +127,11 @@ end
 
 local function gdt_table_dim(t) return size1(t), size2(t) end
 
+local function gdt_table_layout(t)
+    local id = cgdt.gdt_table_layout(t)
+    return (id == cgdt.GDT_LAYOUT_COLUMN_MAJOR and 'column' or 'row')
+end
+
 local function gdt_table_get_header(t, k)
     assert(k > 0 and k <= size2(t), 'invalid column index')
     return ffi.string(cgdt.gdt_table_get_header(t, k - 1));
@@ -247,25 +272,34 @@ local function gdt_table_rows(t)
     return cursor_iter, cursor, 0
 end
 
+-- "rows" is an array of "n" zero-based row indexes.
+local function take_rows(t, rows, n)
+    local new = cgdt.gdt_table_take_rows(t, rows, n)
+    if new == nil then error('cannot allocate table: not enough memory') end
+    return ffi.gc(new, cgdt.gdt_table_free)
+end
+
 local function gdt_table_filter(t, f)
-    local n, m = t:dim()
-    local n_curr = 0
-    local new = gdt.alloc(n_curr, m, 16)
+    local rows = ffi.new('int[?]', size1(t))
+    local n = 0
     for i, row in t:rows() do
         if f(row, i) then
-            n_curr = n_curr + 1
-            cgdt.gdt_table_insert_rows(new, n_curr - 1, 1)
-            for j = 1, m do
-                local v = gdt_value()
-                local e = cgdt.gdt_table_get(t, i - 1, j - 1, v)
-                gdt.set(new, n_curr, j, extract_value(e, v))
-            end
+            rows[n] = i - 1
+            n = n + 1
         end
     end
-    for j = 1, m do
-        new:set_header(j, t:header(j))
+    return take_rows(t, rows, n)
+end
+
+local function gdt_table_take(t, indices)
+    local n, n1 = #indices, size1(t)
+    local rows = ffi.new('int[?]', n)
+    for k = 1, n do
+        local i = indices[k]
+        assert(type(i) == 'number' and i > 0 and i <= n1, 'invalid row index')
+        rows[k - 1] = i - 1
     end
-    return new
+    return take_rows(t, rows, n)
 end
 
 local function find_column_type(t, j)
@@ -283,17 +317,30 @@ local function gdt_table_column_type(t, col)
     return find_column_type(t, j)
 end
 
-local function gdt_table_levels(t, j)
-    local n = #t
+-- Return the list of the distinct values of the column "j" in order of
+-- first appearance and an array with the zero-based index of the level
+-- of each row, or -1 for undefined values. The array is indexed by the
+-- zero-based row index.
+local function gdt_table_level_codes(t, j)
+    if type(j) == 'string' then
+        local index = cgdt.gdt_table_header_index(t, j)
+        if index < 0 then error(format("invalid column name \"%s\"", j), 2) end
+        j = index + 1
+    end
+    local n = size1(t)
+    local codes = ffi.new('int[?]', n)
+    local level_rows = ffi.new('int[?]', n)
+    local nlevels = cgdt.gdt_table_column_levels(t, j - 1, codes, level_rows)
+    if nlevels < 0 then error('invalid column index', 2) end
     local ls = {}
-    for i = 1, n do
-        local x = gdt_table_get(t, i, j)
-        local found = false
-        for k, y in ipairs(ls) do
-            if x == y then found = true; break end
-        end
-        if not found then ls[#ls+1] = x end
+    for k = 0, nlevels - 1 do
+        ls[k + 1] = gdt_table_get_unsafe(t, level_rows[k] + 1, j)
     end
+    return ls, codes
+end
+
+local function gdt_table_levels(t, j)
+    local ls = gdt_table_level_codes(t, j)
     return ls
 end
 
@@ -306,6 +353,18 @@ local function list_add_unique(ls, x)
     return i
 end
 
+local function gdt_table_save_binary(t, filename)
+    if cgdt.gdt_table_save_binary(t, filename) ~= 0 then
+        error('cannot write file: ' .. filename)
+    end
+end
+
+local function gdt_table_load_binary(filename)
+    local t = cgdt.gdt_table_load_binary(filename)
+    if t == nil then error('cannot load binary table from file: ' .. filename) end
+    return ffi.gc(t, cgdt.gdt_table_free)
+end
+
 local function gdt_table_create(f_init, a, b)
     if not b then a, b = 1, a end
     local n = b - a + 1
@@ -330,6 +389,7 @@ end
 
 local gdt_methods = {
     dim        = gdt_table_dim,
+    layout     = gdt_table_layout,
     get        = gdt_table_get,
     set        = gdt_table_set,
     header     = gdt_table_get_header,
@@ -345,6 +405,7 @@ local gdt_methods = {
     insert     = gdt_table_insert_row,
     append     = gdt_table_append_row,
     rows       = gdt_table_rows,
+    take       = gdt_table_take,
     levels     = gdt_table_levels,
 }
 
@@ -355,9 +416,17 @@ local gdt_mt = {
 
 ffi.metatype(gdt_table, gdt_mt)
 
+-- The cursor can be indexed with a column name or with a column index.
+-- Using the index obtained with the method "col_index" avoids the name
+-- lookup for each row.
 local function gdt_table_cursor_get(c, k)
     local val = gdt_value()
-    local e = cgdt.gdt_table_cursor_get(c, k, val)
+    local e
+    if type(k) == 'number' then
+        e = cgdt.gdt_table_cursor_get_column(c, k - 1, val)
+    else
+        e = cgdt.gdt_table_cursor_get(c, k, val)
+    end
     if e < 0 then error(string.format("invalid key \"%s\" or invalid cursor", k), 2) end
     return extract_value(e, val)
 end
@@ -365,7 +434,17 @@ end
 local function gdt_table_cursor_set(c, k, val)
     local rv
     local tp = type(val)
-    if tp == 'number' then
+    if type(k) == 'number' then
+        local j = k - 1
+        if tp == 'number' then
+            rv = cgdt.gdt_table_cursor_set_column_number(c, j, val)
+        elseif tp == 'string' then
+            rv = cgdt.gdt_table_cursor_set_column_string(c, j, val)
+        else
+            assert(tp ~= nil, 'expect a number, string or nil value')
+            rv = cgdt.gdt_table_cursor_set_column_undef(c, j)
+        end
+    elseif tp == 'number' then
         rv = cgdt.gdt_table_cursor_set_number(c, k, val)
     elseif tp == 'string' then
         rv = cgdt.gdt_table_cursor_set_string(c, k, val)
@@ -394,6 +473,11 @@ gdt = {
     filter = gdt_table_filter,
     create = gdt_table_create,
 
+    save_binary = gdt_table_save_binary,
+    load_binary = gdt_table_load_binary,
+
+    get_unsafe        = gdt_table_get_unsafe,
+    level_codes       = gdt_table_level_codes,
     get_number_unsafe = gdt_table_get_number_unsafe,
 }
 
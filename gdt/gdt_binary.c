@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "gdt_binary.h"
+#include "gdt_table_priv.h"
+#include "mapped_file.h"
+#include "xmalloc.h"
+
+/* Layout of the binary file. All the offsets are in bytes from the
+   beginning of the file.
+
+   - the file header, struct binary_header;
+   - the column headers: "size2" int32 offsets, -1 for columns without
+     a name, followed by the null-terminated names;
+   - the strings of the table in the order of their index, each
+     terminated by a null character;
+   - the table's elements, aligned to BINARY_DATA_ALIGN, stored with
+     the table's layout without any gap between rows or columns.
+
+   Integers and elements are stored with the byte order of the machine
+   and a file written with a different byte order is refused. */
+
+#define BINARY_MAGIC "GDTTABLE"
+#define BINARY_VERSION 1
+#define BINARY_BYTE_ORDER 0x01020304u
+#define BINARY_DATA_ALIGN 64
+
+struct binary_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    int32_t layout;
+    int32_t size1;
+    int32_t size2;
+    int32_t strings_count;
+    uint64_t headers_offset;
+    uint64_t headers_size;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t data_offset;
+};
+
+static uint64_t
+headers_size(const gdt_table *t)
+{
+    const struct string_array *h = t->headers;
+    uint64_t size = sizeof(int32_t) * t->size2;
+    for (int j = 0; j < t->size2; j++)
+    {
+        if (h->offset_data[j] >= 0)
+            size += strlen(h->buffer->data + h->offset_data[j]) + 1;
+    }
+    return size;
+}
+
+static uint64_t
+strings_size(const gdt_table *t)
+{
+    uint64_t size = 0;
+    for (int k = 0; k < t->strings->length; k++)
+        size += strlen(gdt_index_get(t->strings, k)) + 1;
+    return size;
+}
+
+static int
+write_headers(const gdt_table *t, FILE *f)
+{
+    const struct string_array *h = t->headers;
+    int32_t offset = 0;
+    for (int j = 0; j < t->size2; j++)
+    {
+        int32_t name_offset = -1;
+        if (h->offset_data[j] >= 0)
+        {
+            name_offset = offset;
+            offset += strlen(h->buffer->data + h->offset_data[j]) + 1;
+        }
+        if (fwrite(&name_offset, sizeof(int32_t), 1, f) != 1) return (-1);
+    }
+    for (int j = 0; j < t->size2; j++)
+    {
+        if (h->offset_data[j] >= 0)
+        {
+            const char *name = h->buffer->data + h->offset_data[j];
+            if (fwrite(name, strlen(name) + 1, 1, f) != 1) return (-1);
+        }
+    }
+    return 0;
+}
+
+static int
+write_strings(const gdt_table *t, FILE *f)
+{
+    for (int k = 0; k < t->strings->length; k++)
+    {
+        const char *s = gdt_index_get(t->strings, k);
+        if (fwrite(s, strlen(s) + 1, 1, f) != 1) return (-1);
+    }
+    return 0;
+}
+
+static int
+write_data(const gdt_table *t, FILE *f)
+{
+    const int column_major = (t->layout == GDT_LAYOUT_COLUMN_MAJOR);
+    const int n_outer = (column_major ? t->size2 : t->size1);
+    const int n_inner = (column_major ? t->size1 : t->size2);
+    if (n_inner == 0) return 0;
+    if (t->tda == n_inner)
+    {
+        size_t n = (size_t) n_outer * n_inner;
+        return (fwrite(t->data, sizeof(gdt_element), n, f) == n ? 0 : -1);
+    }
+    for (int k = 0; k < n_outer; k++)
+    {
+        const gdt_element *line = t->data + (size_t) k * t->tda;
+        if (fwrite(line, sizeof(gdt_element), n_inner, f) != (size_t) n_inner)
+            return (-1);
+    }
+    return 0;
+}
+
+int
+gdt_table_save_binary(const gdt_table *t, const char *filename)
+{
+    struct binary_header head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, BINARY_MAGIC, 8);
+    head.version = BINARY_VERSION;
+    head.byte_order = BINARY_BYTE_ORDER;
+    head.layout = t->layout;
+    head.size1 = t->size1;
+    head.size2 = t->size2;
+    head.strings_count = t->strings->length;
+    head.headers_offset = sizeof(head);
+    head.headers_size = headers_size(t);
+    head.strings_offset = head.headers_offset + head.headers_size;
+    head.strings_size = strings_size(t);
+    const uint64_t strings_end = head.strings_offset + head.strings_size;
+    head.data_offset = (strings_end + BINARY_DATA_ALIGN - 1) & ~((uint64_t) BINARY_DATA_ALIGN - 1);
+
+    FILE *f = fopen(filename, "wb");
+    if (f == NULL) return (-1);
+
+    static const char padding[BINARY_DATA_ALIGN] = {0};
+    int status = 0;
+    if (fwrite(&head, sizeof(head), 1, f) != 1) status = -1;
+    if (status == 0) status = write_headers(t, f);
+    if (status == 0) status = write_strings(t, f);
+    if (status == 0 && head.data_offset > strings_end)
+    {
+        size_t n = head.data_offset - strings_end;
+        if (fwrite(padding, 1, n, f) != n) status = -1;
+    }
+    if (status == 0) status = write_data(t, f);
+    if (fclose(f) != 0) status = -1;
+    return status;
+}
+
+static int
+section_is_valid(const struct mapped_file *file, uint64_t offset, uint64_t size)
+{
+    return offset <= file->size && size <= file->size - offset;
+}
+
+static int
+check_header(const struct mapped_file *file, const struct binary_header *head)
+{
+    if (memcmp(head->magic, BINARY_MAGIC, 8) != 0) return (-1);
+    if (head->version != BINARY_VERSION) return (-1);
+    if (head->byte_order != BINARY_BYTE_ORDER) return (-1);
+    if (head->layout != GDT_LAYOUT_ROW_MAJOR && head->layout != GDT_LAYOUT_COLUMN_MAJOR) return (-1);
+    if (head->size1 < 0 || head->size2 < 0 || head->strings_count < 0) return (-1);
+    if (head->headers_size < sizeof(int32_t) * (uint64_t) head->size2) return (-1);
+    if (!section_is_valid(file, head->headers_offset, head->headers_size)) return (-1);
+    if (!section_is_valid(file, head->strings_offset, head->strings_size)) return (-1);
+    if (head->strings_size > 0 && file->data[head->strings_offset + head->strings_size - 1] != 0) return (-1);
+    if (head->data_offset % sizeof(gdt_element) != 0) return (-1);
+    const uint64_t n = (uint64_t) head->size1 * (uint64_t) head->size2;
+    if (n > SIZE_MAX / sizeof(gdt_element)) return (-1);
+    if (!section_is_valid(file, head->data_offset, n * sizeof(gdt_element))) return (-1);
+    return 0;
+}
+
+static int
+load_headers(gdt_table *t, const struct mapped_file *file, const struct binary_header *head)
+{
+    const char *section = file->data + head->headers_offset;
+    const char *names = section + sizeof(int32_t) * head->size2;
+    const uint64_t names_size = head->headers_size - sizeof(int32_t) * head->size2;
+    for (int j = 0; j < head->size2; j++)
+    {
+        int32_t offset;
+        memcpy(&offset, section + sizeof(int32_t) * j, sizeof(int32_t));
+        if (offset < 0) continue;
+        if ((uint64_t) offset >= names_size || memchr(names + offset, 0, names_size - offset) == NULL)
+            return (-1);
+        gdt_table_set_header(t, j, names + offset);
+    }
+    return 0;
+}
+
+static int
+load_strings(gdt_table *t, const struct mapped_file *file, const struct binary_header *head)
+{
+    const char *s = file->data + head->strings_offset;
+    const char *end = s + head->strings_size;
+    for (int k = 0; k < head->strings_count; k++)
+    {
+        if (s >= end) return (-1);
+        if (gdt_index_intern(&t->strings, s) != k) return (-1);
+        s += strlen(s) + 1;
+    }
+    return 0;
+}
+
+/* The elements are not copied: the table's data points directly into
+   the file mapped in memory. The mapping is private so that pages are
+   shared between processes until they are modified. String indexes in
+   the elements are not checked, an invalid index is read as an
+   undefined string by gdt_index_get. */
+gdt_table *
+gdt_table_load_binary(const char *filename)
+{
+    struct mapped_file *file = xmalloc(sizeof(struct mapped_file));
+    if (mapped_file_open_private(file, filename) != 0)
+    {
+        free(file);
+        return NULL;
+    }
+
+    struct binary_header head;
+    if (file->size < sizeof(head))
+        goto load_error;
+    memcpy(&head, file->data, sizeof(head));
+    if (check_header(file, &head) != 0)
+        goto load_error;
+
+    gdt_table *t = gdt_table_new_mapped(file, head.data_offset, head.size1, head.size2, head.layout);
+    if (load_headers(t, file, &head) != 0 || load_strings(t, file, &head) != 0)
+    {
+        gdt_table_free(t);
+        free(t);
+        return NULL;
+    }
+    return t;
+
+load_error:
+    mapped_file_close(file);
+    free(file);
+    return NULL;
+}
@@ -0,0 +1,9 @@
+#ifndef GDT_BINARY_H
+#define GDT_BINARY_H
+
+#include "gdt_table.h"
+
+extern int          gdt_table_save_binary  (const gdt_table *t, const char *filename);
+extern gdt_table *  gdt_table_load_binary  (const char *filename);
+
+#endif
@@ -7,6 +7,32 @@
 #include "xmalloc.h"
 
 #define STRING_SECTION_INIT_SIZE 256
+#define HASH_MIN_SIZE 16
+
+static unsigned int
+hash_size_for(int alloc_size)
+{
+    unsigned int n = round_two_power(2 * alloc_size);
+    return (n < HASH_MIN_SIZE ? HASH_MIN_SIZE : n);
+}
+
+static int *
+hash_table_new(unsigned int n)
+{
+    int *hash = xmalloc(sizeof(int) * n);
+    memset(hash, 0, sizeof(int) * n);
+    return hash;
+}
+
+static void
+hash_insert(gdt_index *g, int idx, unsigned int h)
+{
+    unsigned int k = h & g->hash_mask;
+    while (g->hash[k] != 0) {
+        k = (k + 1) & g->hash_mask;
+    }
+    g->hash[k] = idx + 1;
+}
 
 gdt_index *
 gdt_index_new(int alloc_size)
@@ -14,15 +40,38 @@ gdt_index_new(int alloc_size)
     size_t extra_size = sizeof(int) * (alloc_size - INDEX_AUTO);
     gdt_index *g = xmalloc(sizeof(gdt_index) + extra_size);
     char_buffer_init(g->names, STRING_SECTION_INIT_SIZE);
+    unsigned int hash_size = hash_size_for(alloc_size);
+    g->hash = hash_table_new(hash_size);
+    g->hash_mask = hash_size - 1;
     g->length = 0;
     g->size = alloc_size;
     return g;
 }
 
+/* Return a copy of the index. The strings have the same indexes in the
+   copy and in the original. */
+gdt_index *
+gdt_index_copy(const gdt_index *g)
+{
+    size_t extra_size = sizeof(int) * (g->size - INDEX_AUTO);
+    gdt_index *new_g = xmalloc(sizeof(gdt_index) + extra_size);
+    char_buffer_init(new_g->names, g->names->size);
+    memcpy(new_g->names->data, g->names->data, g->names->length);
+    new_g->names->length = g->names->length;
+    new_g->hash = xmalloc(sizeof(int) * (g->hash_mask + 1));
+    memcpy(new_g->hash, g->hash, sizeof(int) * (g->hash_mask + 1));
+    new_g->hash_mask = g->hash_mask;
+    new_g->length = g->length;
+    new_g->size = g->size;
+    memcpy(new_g->index, g->index, sizeof(int) * g->length);
+    return new_g;
+}
+
 void
 gdt_index_free(gdt_index *g)
 {
     char_buffer_free(g->names);
+    free(g->hash);
     free(g);
 }
 
@@ -38,6 +87,16 @@ gdt_index_resize(gdt_index *g)
     new_g->size = alloc_size;
     memcpy(new_g->index, g->index, sizeof(int) * g->length);
 
+    /* rebuild the hash table with the new size */
+    unsigned int hash_size = hash_size_for(alloc_size);
+    new_g->hash = hash_table_new(hash_size);
+    new_g->hash_mask = hash_size - 1;
+    const char *base = new_g->names->data;
+    for (int k = 0; k < new_g->length; k++) {
+        hash_insert(new_g, k, gdt_string_hash(base + new_g->index[k]));
+    }
+
+    free(g->hash);
     free(g);
     return new_g;
 }
@@ -56,6 +115,8 @@ gdt_index_add(gdt_index *g, const char *str)
     int idx = g->length;
     g->index[idx] = str_offset;
     g->length ++;
+
+    hash_insert(g, idx, gdt_string_hash(str));
     return idx;
 }
 
@@ -71,11 +132,32 @@ int
 gdt_index_lookup(gdt_index *g, const char *req)
 {
     const char *base = g->names->data;
-    for (int k = 0; k < g->length; k++)
+    unsigned int k = gdt_string_hash(req) & g->hash_mask;
+    for (int slot = g->hash[k]; slot != 0; slot = g->hash[k])
     {
-        const char *str = base + g->index[k];
+        const char *str = base + g->index[slot - 1];
         if (strcmp(str, req) == 0)
-            return k;
+            return slot - 1;
+        k = (k + 1) & g->hash_mask;
     }
     return (-1);
 }
+
+/* Return the index of the given string, adding it to the index if it
+   is not already present. The index can be reallocated so the pointer
+   stored in "g_ptr" is updated. */
+int
+gdt_index_intern(gdt_index **g_ptr, const char *str)
+{
+    int idx = gdt_index_lookup(*g_ptr, str);
+    if (idx < 0)
+    {
+        idx = gdt_index_add(*g_ptr, str);
+        if (idx < 0)
+        {
+            *g_ptr = gdt_index_resize(*g_ptr);
+            idx = gdt_index_add(*g_ptr, str);
+        }
+    }
+    return idx;
+}
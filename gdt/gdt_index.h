@@ -6,18 +6,37 @@
 
 #define INDEX_AUTO 4
 
+/* The "hash" table uses open addressing with linear probing. Each
+   slot contains the string index plus one or zero for an empty slot.
+   The number of slots is a power of two at least twice "size". */
 typedef struct {
     struct char_buffer names[1];
+    int *hash;
+    unsigned int hash_mask;
     int length;
     int size;
     int index[INDEX_AUTO];
 } gdt_index;
 
+/* FNV-1a hash function. */
+static inline unsigned int
+gdt_string_hash(const char *s)
+{
+    unsigned int h = 2166136261u;
+    for (/* */; *s; s++) {
+        h ^= (unsigned char) *s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
 extern gdt_index *   gdt_index_new         (int alloc_size);
+extern gdt_index *   gdt_index_copy        (const gdt_index *g);
 extern void          gdt_index_free        (gdt_index *g);
 extern gdt_index *   gdt_index_resize      (gdt_index *g);
 extern int           gdt_index_add         (gdt_index *g, const char *str);
 extern const char *  gdt_index_get         (gdt_index *g, int index);
 extern int           gdt_index_lookup      (gdt_index *g, const char *req);
+extern int           gdt_index_intern      (gdt_index **g_ptr, const char *str);
 
 #endif
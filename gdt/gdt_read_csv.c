@@ -0,0 +1,730 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "gdt_read_csv.h"
+#include "gdt_table_priv.h"
+#include "mapped_file.h"
+#include "xmalloc.h"
+
+/* Minimum size of the data assigned to each thread when the number of
+   threads is chosen automatically. */
+#define CSV_CHUNK_MIN_SIZE (4 << 20)
+
+/* Buffer used to store the content of a field after the quotes are
+   resolved. The content is always terminated by a zero. */
+struct field_buffer {
+    char *data;
+    size_t size;
+};
+
+typedef struct {
+    gdt_value_enum type;
+    double number;
+    /* The field's text with the spaces stripped if requested. It is
+       also set for undefined cells, as needed by the header detection. */
+    const char *string;
+} csv_cell;
+
+/* Cells of the first line of the file. They are used to detect
+   if the first line is a header and are stored in the table at the
+   end, either as headers or as the first row. */
+struct csv_head {
+    struct char_buffer strings[1];
+    gdt_value_enum *type;
+    double *number;
+    int *offset;
+    int *dup;
+    int length;
+};
+
+static void
+field_buffer_reserve(struct field_buffer *b, size_t len)
+{
+    if (len + 1 > b->size)
+    {
+        b->size = round_two_power(len + 1);
+        b->data = xrealloc(b->data, b->size);
+    }
+}
+
+static inline int
+is_space(int c)
+{
+    return (c == ' ' || (c >= '\t' && c <= '\r'));
+}
+
+static inline int
+is_digit(int c)
+{
+    return (c >= '0' && c <= '9');
+}
+
+static size_t
+count_lines(const char *p, const char *end)
+{
+    size_t n = 1;
+    while ((p = memchr(p, '\n', end - p)) != NULL)
+    {
+        n++;
+        p++;
+    }
+    return n;
+}
+
+/* Read the field starting at "p" into the field buffer. Quoted fields
+   follow the same rules of csv.line: a doubled quote is read as a
+   single quote and any character between the closing quote and the
+   next comma is discarded. Newlines are allowed inside quoted fields.
+   Return a pointer to the character that terminates the field: a
+   comma, a newline or the end of the data. */
+static const char *
+read_field(const char *p, const char *end, struct field_buffer *buf)
+{
+    size_t len = 0;
+    if (p < end && *p == '"')
+    {
+        p++;
+        while (p < end)
+        {
+            const char *q = memchr(p, '"', end - p);
+            const char *seg_end = (q ? q : end);
+            field_buffer_reserve(buf, len + (seg_end - p) + 1);
+            memcpy(buf->data + len, p, seg_end - p);
+            len += seg_end - p;
+            p = seg_end;
+            if (q == NULL) break;
+            if (q + 1 < end && q[1] == '"')
+            {
+                buf->data[len++] = '"';
+                p = q + 2;
+            }
+            else
+            {
+                p = q + 1;
+                break;
+            }
+        }
+        while (p < end && *p != ',' && *p != '\n')
+            p++;
+    }
+    else
+    {
+        const char *q = p;
+        while (q < end && *q != ',' && *q != '\n')
+            q++;
+        size_t n = q - p;
+        if (n > 0 && q < end && *q == '\n' && p[n - 1] == '\r')
+            n--;
+        field_buffer_reserve(buf, n);
+        memcpy(buf->data, p, n);
+        len = n;
+        p = q;
+    }
+    buf->data[len] = 0;
+    return p;
+}
+
+/* Parse a number with the same rules of Lua's tonumber for decimal and
+   hexadecimal numbers. The string should not have leading or trailing
+   spaces. Return 1 if the conversion was successful. */
+static int
+parse_number(const char *s, double *x)
+{
+    const char *p = s;
+    if (*p == '+' || *p == '-') p++;
+    if (!(is_digit(p[0]) || (p[0] == '.' && is_digit(p[1]))))
+        return 0;
+    char *tail;
+    *x = strtod(s, &tail);
+    return (*tail == 0);
+}
+
+/* Find the type and the value of the cell stored in the field buffer.
+   The content of the buffer can be modified. */
+static void
+classify_cell(char *s, int strip_spaces, csv_cell *cell)
+{
+    char *a = s, *b = s + strlen(s);
+    while (a < b && is_space(a[0])) a++;
+    while (b > a && is_space(b[-1])) b--;
+
+    if (a == b)
+    {
+        cell->type = GDT_VAL_UNDEF;
+        cell->string = (strip_spaces ? "" : s);
+        return;
+    }
+
+    const char saved = *b;
+    *b = 0;
+    if (parse_number(a, &cell->number))
+    {
+        cell->type = GDT_VAL_NUMBER;
+        return;
+    }
+    if (!strip_spaces)
+    {
+        *b = saved;
+        a = s;
+    }
+    cell->type = GDT_VAL_STRING;
+    cell->string = a;
+}
+
+static int
+cell_equal(const struct csv_head *head, int k, const csv_cell *cell)
+{
+    if (head->type[k] == GDT_VAL_NUMBER)
+        return (cell->type == GDT_VAL_NUMBER && cell->number == head->number[k]);
+    if (cell->type == GDT_VAL_NUMBER)
+        return 0;
+    return (strcmp(head->strings->data + head->offset[k], cell->string) == 0);
+}
+
+static void
+csv_head_init(struct csv_head *head)
+{
+    char_buffer_init(head->strings, 256);
+    head->type = NULL;
+    head->number = NULL;
+    head->offset = NULL;
+    head->dup = NULL;
+    head->length = 0;
+}
+
+static void
+csv_head_free(struct csv_head *head)
+{
+    char_buffer_free(head->strings);
+    free(head->type);
+    free(head->number);
+    free(head->offset);
+    free(head->dup);
+}
+
+static void
+csv_head_append(struct csv_head *head, const csv_cell *cell)
+{
+    const int k = head->length;
+    if ((k & (k - 1)) == 0)
+    {
+        const size_t n = (k == 0 ? 1 : 2 * k);
+        head->type = xrealloc(head->type, sizeof(gdt_value_enum) * n);
+        head->number = xrealloc(head->number, sizeof(double) * n);
+        head->offset = xrealloc(head->offset, sizeof(int) * n);
+        head->dup = xrealloc(head->dup, sizeof(int) * n);
+    }
+    head->type[k] = cell->type;
+    head->number[k] = cell->number;
+    head->offset[k] = char_buffer_append(head->strings, cell->type == GDT_VAL_NUMBER ? "" : cell->string);
+    head->dup[k] = 0;
+    head->length = k + 1;
+}
+
+static void
+table_set_cell(gdt_table *t, int i, int j, const csv_cell *cell)
+{
+    switch (cell->type)
+    {
+    case GDT_VAL_NUMBER:
+        gdt_table_set_number(t, i, j, cell->number);
+        break;
+    case GDT_VAL_STRING:
+        gdt_table_set_string(t, i, j, cell->string);
+        break;
+    default:
+        gdt_table_set_undef(t, i, j);
+    }
+}
+
+static const char *
+skip_empty_lines(const char *p, const char *end)
+{
+    while (p < end)
+    {
+        if (p[0] == '\n')
+            p++;
+        else if (p[0] == '\r' && p + 1 < end && p[1] == '\n')
+            p += 2;
+        else
+            break;
+    }
+    return p;
+}
+
+static const char *
+read_head(const char *p, const char *end, struct csv_head *head, struct field_buffer *buf, int strip_spaces)
+{
+    csv_cell cell;
+    do {
+        p = read_field(p, end, buf);
+        classify_cell(buf->data, strip_spaces, &cell);
+        csv_head_append(head, &cell);
+    } while (p < end && *(p++) == ',');
+    return p;
+}
+
+/* Store the first line either as the table's headers or as its first
+   row using the same heuristic of gdt-parse-csv.lua. The first row of
+   the table was reserved for the purpose. */
+static void
+store_head(gdt_table *t, const struct csv_head *head, int all_strings)
+{
+    const int ncols = t->size2;
+    int head_all_string = 1, dup_count = 0;
+    for (int k = 0; k < head->length; k++)
+    {
+        if (head->type[k] == GDT_VAL_NUMBER) head_all_string = 0;
+        if (head->dup[k]) dup_count++;
+    }
+    const int header_stand = (2 * dup_count < ncols);
+    const int has_header = head_all_string && (header_stand || !all_strings);
+
+    if (has_header)
+    {
+        for (int k = 0; k < head->length; k++)
+            gdt_table_set_header(t, k, head->strings->data + head->offset[k]);
+        gdt_table_remove_rows(t, 0, 1);
+    }
+    else
+    {
+        for (int k = 0; k < ncols; k++)
+        {
+            if (k < head->length)
+            {
+                const csv_cell cell = {head->type[k], head->number[k], head->strings->data + head->offset[k]};
+                table_set_cell(t, 0, k, &cell);
+            }
+            else
+            {
+                gdt_table_set_undef(t, 0, k);
+            }
+        }
+    }
+}
+
+/* Read all the lines after the first one in the table. The first row
+   of the table is reserved to store the first line of the file. The
+   number of lines is only used to allocate the rows and the empty lines
+   are skipped, so the limit on the number of rows is checked while
+   reading. */
+static gdt_table *
+read_rows(const char *p, const char *end, struct csv_head *head, const gdt_csv_options *opt, int *all_strings, int *error)
+{
+    struct field_buffer buf[1] = {{NULL, 0}};
+    const size_t nlines = count_lines(p, end);
+    const int nalloc = (nlines < INT_MAX ? nlines + 1 : INT_MAX);
+    gdt_table *t = gdt_table_new(1, head->length, nalloc, opt->layout);
+    if (unlikely(t == NULL))
+    {
+        *error = GDT_CSV_ERROR_MEMORY;
+        return NULL;
+    }
+
+    for (p = skip_empty_lines(p, end); p < end; p = skip_empty_lines(p, end))
+    {
+        const int i = t->size1;
+        if (unlikely(i == INT_MAX))
+        {
+            *error = GDT_CSV_ERROR_TOO_MANY_ROWS;
+            goto read_error;
+        }
+        if (unlikely(gdt_table_insert_rows(t, i, 1) != 0)) goto memory_error;
+
+        int k = 0;
+        do {
+            csv_cell cell;
+            p = read_field(p, end, buf);
+            classify_cell(buf->data, opt->strip_spaces, &cell);
+
+            if (k >= t->size2)
+            {
+                if (unlikely(gdt_table_insert_columns(t, k, 1) != 0)) goto memory_error;
+                for (int r = 0; r < i; r++)
+                    gdt_table_set_undef(t, r, k);
+            }
+
+            if (cell.type == GDT_VAL_NUMBER) *all_strings = 0;
+            if (k < head->length && !head->dup[k])
+                head->dup[k] = cell_equal(head, k, &cell);
+
+            table_set_cell(t, i, k, &cell);
+            k++;
+        } while (p < end && *(p++) == ',');
+
+        for (/* */; k < t->size2; k++)
+            gdt_table_set_undef(t, i, k);
+    }
+
+    free(buf->data);
+    return t;
+
+memory_error:
+    *error = GDT_CSV_ERROR_MEMORY;
+read_error:
+    gdt_table_free(t);
+    free(buf->data);
+    return NULL;
+}
+
+/* For parallel reading the data is split into chunks. Each chunk is
+   read by a thread into its own list of cells using its own string
+   index. The cells are then copied into the table, in parallel, after
+   the strings are remapped into the table's string index. */
+struct csv_chunk {
+    /* The lines starting in [begin, end) belong to the chunk. */
+    const char *begin, *end;
+    const char *data_end;
+    /* Position where the reading stopped. If the boundaries of the
+       chunks are correct it is equal to "end". */
+    const char *stop;
+    const struct csv_head *head;
+    int strip_spaces;
+    int quotes;
+
+    gdt_element *cells;
+    size_t cells_len, cells_size;
+    size_t *row_start;
+    size_t nrows, rows_size;
+    int ncols;
+    gdt_index *strings;
+    int *dup;
+    int all_strings;
+
+    gdt_table *table;
+    int row_offset;
+    int *string_map;
+};
+
+static int
+cpu_count()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0 ? n : 1);
+#else
+    return 1;
+#endif
+}
+
+static int
+csv_thread_count(int requested, size_t size)
+{
+    if (requested > 0)
+        return ((size_t) requested <= size ? requested : 1);
+    const size_t n_max = size / CSV_CHUNK_MIN_SIZE;
+    const int n = cpu_count();
+    return ((size_t) n <= n_max ? n : (n_max > 0 ? (int) n_max : 1));
+}
+
+/* Run the given function for each chunk, each in its own thread. */
+static void
+run_chunks(struct csv_chunk *chunks, int n, void *(*work)(void *))
+{
+    pthread_t *threads = xmalloc(sizeof(pthread_t) * n);
+    int *started = xmalloc(sizeof(int) * n);
+    for (int k = 1; k < n; k++)
+    {
+        started[k] = (pthread_create(&threads[k], NULL, work, &chunks[k]) == 0);
+        if (!started[k])
+            work(&chunks[k]);
+    }
+    work(&chunks[0]);
+    for (int k = 1; k < n; k++)
+    {
+        if (started[k])
+            pthread_join(threads[k], NULL);
+    }
+    free(started);
+    free(threads);
+}
+
+static void *
+chunk_count_quotes(void *arg)
+{
+    struct csv_chunk *c = arg;
+    int n = 0;
+    for (const char *p = c->begin; p < c->end; p++)
+    {
+        p = memchr(p, '"', c->end - p);
+        if (p == NULL) break;
+        n++;
+    }
+    c->quotes = n;
+    return NULL;
+}
+
+static void
+chunk_push_cell(struct csv_chunk *c, const csv_cell *cell)
+{
+    if (c->cells_len >= c->cells_size)
+    {
+        c->cells_size = (c->cells_size > 0 ? 2 * c->cells_size : 1024);
+        c->cells = xrealloc(c->cells, sizeof(gdt_element) * c->cells_size);
+    }
+    gdt_element *e = &c->cells[c->cells_len++];
+    switch (cell->type)
+    {
+    case GDT_VAL_NUMBER:
+        e->number = cell->number;
+        break;
+    case GDT_VAL_STRING:
+        e->word.hi = TAG_STRING;
+        e->word.lo = gdt_index_intern(&c->strings, cell->string);
+        break;
+    default:
+        e->word.hi = TAG_UNDEF;
+        e->word.lo = 0;
+    }
+}
+
+static void
+chunk_push_row(struct csv_chunk *c)
+{
+    if (c->nrows + 1 >= c->rows_size)
+    {
+        c->rows_size = (c->rows_size > 0 ? 2 * c->rows_size : 256);
+        c->row_start = xrealloc(c->row_start, sizeof(size_t) * c->rows_size);
+    }
+    c->row_start[c->nrows++] = c->cells_len;
+}
+
+static void *
+chunk_parse(void *arg)
+{
+    struct csv_chunk *c = arg;
+    struct field_buffer buf[1] = {{NULL, 0}};
+    const struct csv_head *head = c->head;
+    const char *p = c->begin, *end = c->data_end;
+
+    while (p < c->end)
+    {
+        if (p[0] == '\n')
+        {
+            p++;
+            continue;
+        }
+        if (p[0] == '\r' && p + 1 < end && p[1] == '\n')
+        {
+            p += 2;
+            continue;
+        }
+
+        chunk_push_row(c);
+        int k = 0;
+        do {
+            csv_cell cell;
+            p = read_field(p, end, buf);
+            classify_cell(buf->data, c->strip_spaces, &cell);
+            if (cell.type == GDT_VAL_NUMBER) c->all_strings = 0;
+            if (k < head->length && !c->dup[k])
+                c->dup[k] = cell_equal(head, k, &cell);
+            chunk_push_cell(c, &cell);
+            k++;
+        } while (p < end && *(p++) == ',');
+
+        if (k > c->ncols) c->ncols = k;
+    }
+    chunk_push_row(c);
+    c->nrows--;
+    c->stop = p;
+
+    free(buf->data);
+    return NULL;
+}
+
+static void *
+chunk_store(void *arg)
+{
+    struct csv_chunk *c = arg;
+    gdt_table *t = c->table;
+    for (size_t r = 0; r < c->nrows; r++)
+    {
+        const int i = c->row_offset + r;
+        const gdt_element *row = c->cells + c->row_start[r];
+        const int len = c->row_start[r + 1] - c->row_start[r];
+        int k;
+        for (k = 0; k < len; k++)
+        {
+            gdt_element e = row[k];
+            if (e.word.hi == TAG_STRING)
+                e.word.lo = c->string_map[e.word.lo];
+            *gdt_table_element(t, i, k) = e;
+        }
+        for (/* */; k < t->size2; k++)
+            gdt_table_element(t, i, k)->word.hi = TAG_UNDEF;
+    }
+    return NULL;
+}
+
+static void
+chunk_free(struct csv_chunk *c)
+{
+    free(c->cells);
+    free(c->row_start);
+    free(c->dup);
+    free(c->string_map);
+    gdt_index_free(c->strings);
+}
+
+/* Place each boundary between chunks after the first newline that is
+   not inside a quoted field. Whether a position is inside a quoted
+   field is known from the parity of the number of quotes that precede
+   it. */
+static void
+chunks_set_boundaries(struct csv_chunk *chunks, int n)
+{
+    int in_quote = 0;
+    run_chunks(chunks, n, chunk_count_quotes);
+    for (int k = 1; k < n; k++)
+    {
+        const char *p = chunks[k].begin, *end = chunks[k].data_end;
+        in_quote ^= (chunks[k - 1].quotes & 1);
+        int q = in_quote;
+        for (/* */; p < end; p++)
+        {
+            if (*p == '"')
+            {
+                q = !q;
+            }
+            else if (*p == '\n' && !q)
+            {
+                p++;
+                break;
+            }
+        }
+        if (p < chunks[k - 1].begin)
+            p = chunks[k - 1].begin;
+        chunks[k - 1].end = p;
+        chunks[k].begin = p;
+    }
+}
+
+/* Parallel version of read_rows. Return NULL if the data cannot be
+   read in parallel because the boundaries of the chunks were not found
+   correctly. It may happens if the file contains quotes that are not
+   at the beginning or at the end of a field. Otherwise "error" is set
+   when NULL is returned. */
+static gdt_table *
+read_rows_parallel(const char *data, const char *end, struct csv_head *head, const gdt_csv_options *opt, int n, int *all_strings, int *error)
+{
+    struct csv_chunk *chunks = xmalloc(sizeof(struct csv_chunk) * n);
+    const size_t size = end - data;
+    gdt_table *t = NULL;
+
+    for (int k = 0; k < n; k++)
+    {
+        struct csv_chunk *c = &chunks[k];
+        memset(c, 0, sizeof(struct csv_chunk));
+        c->begin = data + size * k / n;
+        c->end = data + size * (k + 1) / n;
+        c->data_end = end;
+        c->head = head;
+        c->strip_spaces = opt->strip_spaces;
+        c->strings = gdt_index_new(16);
+        c->dup = xmalloc(sizeof(int) * (head->length > 0 ? head->length : 1));
+        memset(c->dup, 0, sizeof(int) * head->length);
+        c->all_strings = 1;
+    }
+
+    chunks_set_boundaries(chunks, n);
+    run_chunks(chunks, n, chunk_parse);
+
+    size_t nrows = 1;
+    int ncols = head->length;
+    for (int k = 0; k < n; k++)
+    {
+        struct csv_chunk *c = &chunks[k];
+        if (k + 1 < n && c->stop != c->end) goto read_exit;
+        c->row_offset = nrows;
+        nrows += c->nrows;
+        if (nrows > INT_MAX)
+        {
+            *error = GDT_CSV_ERROR_TOO_MANY_ROWS;
+            goto read_exit;
+        }
+        if (c->ncols > ncols) ncols = c->ncols;
+    }
+
+    t = gdt_table_new(nrows, ncols, nrows, opt->layout);
+    if (unlikely(t == NULL))
+    {
+        *error = GDT_CSV_ERROR_MEMORY;
+        goto read_exit;
+    }
+
+    for (int k = 0; k < n; k++)
+    {
+        struct csv_chunk *c = &chunks[k];
+        const int nstr = c->strings->length;
+        c->string_map = xmalloc(sizeof(int) * (nstr > 0 ? nstr : 1));
+        for (int id = 0; id < nstr; id++)
+            c->string_map[id] = gdt_index_intern(&t->strings, gdt_index_get(c->strings, id));
+        c->table = t;
+    }
+
+    run_chunks(chunks, n, chunk_store);
+
+    for (int k = 0; k < n; k++)
+    {
+        const struct csv_chunk *c = &chunks[k];
+        if (!c->all_strings) *all_strings = 0;
+        for (int j = 0; j < head->length; j++)
+            head->dup[j] = head->dup[j] || c->dup[j];
+    }
+
+read_exit:
+    for (int k = 0; k < n; k++)
+        chunk_free(&chunks[k]);
+    free(chunks);
+    return t;
+}
+
+gdt_table *
+gdt_table_read_csv(const char *filename, const gdt_csv_options *opt, int *error)
+{
+    struct mapped_file file[1];
+    *error = 0;
+    if (mapped_file_open(file, filename) != 0)
+    {
+        *error = GDT_CSV_ERROR_OPEN;
+        return NULL;
+    }
+
+    const char *p = file->data, *end = file->data + file->size;
+    struct field_buffer buf[1] = {{NULL, 0}};
+    struct csv_head head[1];
+    csv_head_init(head);
+
+    p = skip_empty_lines(p, end);
+    if (p >= end)
+    {
+        csv_head_free(head);
+        mapped_file_close(file);
+        gdt_table *t = gdt_table_new(0, 0, 0, opt->layout);
+        if (unlikely(t == NULL)) *error = GDT_CSV_ERROR_MEMORY;
+        return t;
+    }
+
+    p = read_head(p, end, head, buf, opt->strip_spaces);
+
+    gdt_table *t = NULL;
+    int all_strings = 1;
+    const int nthreads = csv_thread_count(opt->threads, end - p);
+    if (nthreads > 1)
+        t = read_rows_parallel(p, end, head, opt, nthreads, &all_strings, error);
+    if (t == NULL && *error == 0)
+        t = read_rows(p, end, head, opt, &all_strings, error);
+    if (t != NULL)
+        store_head(t, head, all_strings);
+
+    csv_head_free(head);
+    free(buf->data);
+    mapped_file_close(file);
+    return t;
+}
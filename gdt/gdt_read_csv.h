@@ -0,0 +1,25 @@
+#ifndef GDT_READ_CSV_H
+#define GDT_READ_CSV_H
+
+#include "gdt_table.h"
+
+/* If "threads" is zero or negative the number of threads is chosen
+   based on the number of processors and the size of the file. */
+typedef struct {
+    int strip_spaces;
+    gdt_layout_enum layout;
+    int threads;
+} gdt_csv_options;
+
+/* Error codes set by gdt_table_read_csv when it returns NULL. The
+   number of rows of a table is an int and a file with more rows cannot
+   be read. */
+enum {
+    GDT_CSV_ERROR_OPEN = 1,
+    GDT_CSV_ERROR_TOO_MANY_ROWS,
+    GDT_CSV_ERROR_MEMORY,
+};
+
+extern gdt_table *  gdt_table_read_csv  (const char *filename, const gdt_csv_options *opt, int *error);
+
+#endif
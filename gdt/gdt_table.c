@@ -2,11 +2,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include "gdt_table.h"
 #include "gdt_table_priv.h"
 #include "xmalloc.h"
 
+static const char * gdt_table_element_get_string (const gdt_table *t, const gdt_element *e);
+
 static inline int
 elem_is_string(const gdt_element* e)
 {
@@ -19,6 +22,49 @@ elem_is_undef(const gdt_element* e)
     return e->word.hi == TAG_UNDEF;
 }
 
+#define STRING_ARRAY_HASH_MIN_SIZE 16
+
+/* Return the slot of the hash table where the given name is stored or
+   the empty slot where it should be stored. */
+static unsigned int
+string_array_hash_slot(const struct string_array *v, const char *key)
+{
+    const char *base_data = v->buffer->data;
+    unsigned int k = gdt_string_hash(key) & v->hash_mask;
+    for (int slot = v->hash[k]; slot != 0; slot = v->hash[k])
+    {
+        if (strcmp(base_data + v->offset_data[slot - 1], key) == 0)
+            break;
+        k = (k + 1) & v->hash_mask;
+    }
+    return k;
+}
+
+static void
+string_array_hash_rebuild(struct string_array *v)
+{
+    unsigned int size = round_two_power(2 * v->offset_len);
+    if (size < STRING_ARRAY_HASH_MIN_SIZE)
+        size = STRING_ARRAY_HASH_MIN_SIZE;
+    free(v->hash);
+    v->hash = xmalloc(sizeof(int) * size);
+    memset(v->hash, 0, sizeof(int) * size);
+    v->hash_mask = size - 1;
+    v->hash_count = 0;
+
+    const char *base_data = v->buffer->data;
+    for (int k = 0; k < v->offset_len; k++)
+    {
+        if (v->offset_data[k] < 0) continue;
+        unsigned int slot = string_array_hash_slot(v, base_data + v->offset_data[k]);
+        if (v->hash[slot] == 0)
+        {
+            v->hash[slot] = k + 1;
+            v->hash_count ++;
+        }
+    }
+}
+
 static void
 string_array_init(struct string_array *v, int length)
 {
@@ -29,6 +75,8 @@ string_array_init(struct string_array *v, int length)
     {
         v->offset_data[k] = -1;
     }
+    v->hash = NULL;
+    string_array_hash_rebuild(v);
 }
 
 static void
@@ -36,6 +84,7 @@ string_array_free(struct string_array *v)
 {
     char_buffer_free(v->buffer);
     free(v->offset_data);
+    free(v->hash);
 }
 
 static const char *
@@ -48,22 +97,37 @@ string_array_get(const struct string_array *v, int k)
 static void
 string_array_set(struct string_array *v, int k, const char *str)
 {
+    const int renamed = (v->offset_data[k] >= 0);
     int offset = char_buffer_append(v->buffer, str);
     v->offset_data[k] = offset;
+
+    /* when a name is replaced the old one cannot be removed from the
+       hash table so it is rebuilt */
+    if (renamed)
+    {
+        string_array_hash_rebuild(v);
+        return;
+    }
+
+    unsigned int slot = string_array_hash_slot(v, str);
+    if (v->hash[slot] == 0)
+    {
+        v->hash[slot] = k + 1;
+        v->hash_count ++;
+        if (2 * v->hash_count > (int) v->hash_mask + 1)
+            string_array_hash_rebuild(v);
+    }
+    else if (v->hash[slot] > k + 1)
+    {
+        v->hash[slot] = k + 1;
+    }
 }
 
 static int
 string_array_lookup(const struct string_array *v, const char *key)
 {
-    int k, len = v->offset_len;
-    const char * base_data = v->buffer->data;
-    for (k = 0; k < len; k++)
-    {
-        int offset = v->offset_data[k];
-        if (offset >= 0 && strcmp(base_data + offset, key) == 0)
-            return k;
-    }
-    return (-1);
+    unsigned int slot = string_array_hash_slot(v, key);
+    return v->hash[slot] - 1;
 }
 
 static void
@@ -86,6 +150,13 @@ string_array_insert(struct string_array *v, int j_in, int n)
 
     v->offset_data = new_data;
     v->offset_len = new_len;
+
+    /* shift the index of the names stored after the inserted ones */
+    for (unsigned int slot = 0; slot <= v->hash_mask; slot++)
+    {
+        if (v->hash[slot] > j_in)
+            v->hash[slot] += n;
+    }
 }
 
 /* match string in the form "V[1-9]\d*". strtol is not used because
@@ -121,12 +192,13 @@ write_anonymous_header(char buffer[], const int buf_size, int index)
 }
 
 static gdt_block *
-gdt_block_new(long long size)
+gdt_block_new(size_t n1, size_t n2)
 {
     gdt_element *data = NULL;
+    if (n2 > 0 && n1 > SIZE_MAX / sizeof(gdt_element) / n2)
+        return NULL;
+    const size_t size = n1 * n2;
     if (size > 0) {
-        if (size * sizeof(gdt_element) > INT_MAX)
-            return NULL;
         data = malloc(size * sizeof(gdt_element));
         if (unlikely(data == NULL))
             return NULL;
@@ -135,6 +207,20 @@ gdt_block_new(long long size)
     b->data = data;
     b->size = size;
     b->ref_count = 0;
+    b->file = NULL;
+    return b;
+}
+
+/* Create a block whose data is stored in a mapped file starting at the
+   given offset. The block takes the ownership of the mapping. */
+static gdt_block *
+gdt_block_new_mapped(struct mapped_file *file, size_t offset, size_t size)
+{
+    gdt_block *b = xmalloc(sizeof(gdt_block));
+    b->data = (gdt_element *) (file->data + offset);
+    b->size = size;
+    b->ref_count = 0;
+    b->file = file;
     return b;
 }
 
@@ -150,25 +236,30 @@ gdt_block_unref(gdt_block *b)
     b->ref_count --;
     if (b->ref_count <= 0)
     {
-        free(b->data);
+        if (b->file)
+        {
+            mapped_file_close(b->file);
+            free(b->file);
+        }
+        else
+        {
+            free(b->data);
+        }
         free(b);
     }
 }
 
-gdt_table *
-gdt_table_new(int nb_rows, int nb_columns, int nb_rows_alloc)
+static gdt_table *
+table_new_with_block(gdt_block *b, int nb_rows, int nb_columns, int tda, gdt_layout_enum layout)
 {
-    if (unlikely(nb_rows < 0 || nb_columns < 0)) return NULL;
-    long long sz = (long long)nb_columns * (long long)nb_rows_alloc;
-    gdt_block *b = gdt_block_new(sz);
-    if (unlikely(b == NULL)) return NULL;
     gdt_block_ref(b);
 
     gdt_table *dt = xmalloc(sizeof(gdt_table));
 
     dt->size1 = nb_rows;
     dt->size2 = nb_columns;
-    dt->tda = nb_columns;
+    dt->layout = layout;
+    dt->tda = tda;
     dt->data = b->data;
     dt->block = b;
 
@@ -181,6 +272,27 @@ gdt_table_new(int nb_rows, int nb_columns, int nb_rows_alloc)
     return dt;
 }
 
+gdt_table *
+gdt_table_new(int nb_rows, int nb_columns, int nb_rows_alloc, gdt_layout_enum layout)
+{
+    if (unlikely(nb_rows < 0 || nb_columns < 0 || nb_rows_alloc < 0)) return NULL;
+    gdt_block *b = gdt_block_new(nb_rows_alloc, nb_columns);
+    if (unlikely(b == NULL)) return NULL;
+    const int tda = (layout == GDT_LAYOUT_COLUMN_MAJOR ? nb_rows_alloc : nb_columns);
+    return table_new_with_block(b, nb_rows, nb_columns, tda, layout);
+}
+
+/* Create a table whose data is stored, without any gap between rows or
+   columns, in the mapped file at the given offset. The table takes the
+   ownership of the mapping. */
+gdt_table *
+gdt_table_new_mapped(struct mapped_file *file, size_t offset, int nb_rows, int nb_columns, gdt_layout_enum layout)
+{
+    gdt_block *b = gdt_block_new_mapped(file, offset, (size_t) nb_rows * nb_columns);
+    const int tda = (layout == GDT_LAYOUT_COLUMN_MAJOR ? nb_rows : nb_columns);
+    return table_new_with_block(b, nb_rows, nb_columns, tda, layout);
+}
+
 void
 gdt_table_free(gdt_table *t)
 {
@@ -202,10 +314,16 @@ gdt_table_size2(const gdt_table *t)
     return t->size2;
 }
 
+gdt_layout_enum
+gdt_table_layout(const gdt_table *t)
+{
+    return t->layout;
+}
+
 gdt_value_enum
 gdt_table_get(const gdt_table *t, int i, int j, gdt_value *value)
 {
-    const gdt_element e = t->data[i * t->tda + j];
+    const gdt_element e = *gdt_table_element(t, i, j);
     if (e.word.hi <= TAG_NUMBER) {
         value->number = e.number;
         return GDT_VAL_NUMBER;
@@ -247,7 +365,7 @@ gdt_table_header_index(const gdt_table *t, const char* col_name)
     return (-1);
 }
 
-const char *
+static const char *
 gdt_table_element_get_string(const gdt_table *t, const gdt_element *e)
 {
     if (elem_is_string(e))
@@ -258,34 +376,24 @@ gdt_table_element_get_string(const gdt_table *t, const gdt_element *e)
 void
 gdt_table_set_undef(gdt_table *t, int i, int j)
 {
-    gdt_element *e = &t->data[i * t->tda + j];
+    gdt_element *e = gdt_table_element(t, i, j);
     e->word.hi = TAG_UNDEF;
 }
 
 void
 gdt_table_set_number(gdt_table *t, int i, int j, double num)
 {
-    gdt_element *e = &t->data[i * t->tda + j];
+    gdt_element *e = gdt_table_element(t, i, j);
     e->number = num;
 }
 
 void
 gdt_table_set_string(gdt_table *t, int i, int j, const char *s)
 {
-    gdt_element *e = &t->data[i * t->tda + j];
+    gdt_element *e = gdt_table_element(t, i, j);
 
     if (likely(s != NULL)) {
-        int str_index = gdt_index_lookup(t->strings, s);
-        if (str_index < 0)
-        {
-            str_index = gdt_index_add(t->strings, s);
-            if (str_index < 0)
-            {
-                t->strings = gdt_index_resize(t->strings);
-                str_index = gdt_index_add(t->strings, s);
-            }
-        }
-
+        int str_index = gdt_index_intern(&t->strings, s);
         e->word.hi = TAG_STRING;
         e->word.lo = str_index;
     } else {
@@ -310,37 +418,34 @@ gdt_table_set_header(gdt_table *t, int j, const char *str)
     string_array_set(t->headers, j, str);
 }
 
-int
-gdt_table_insert_columns(gdt_table *t, int j_in, int n)
+/* Round up to a power of two the number of rows or columns to allocate,
+   without going over INT_MAX. */
+static int
+alloc_round(int n)
 {
-    int os2 = t->size2, ns2 = t->size2 + n;
-    int sz = ns2 * t->size1;
-    int *src, *dst;
+    return (n > INT_MAX / 2 + 1 ? INT_MAX : (int) round_two_power(n));
+}
+
+static int
+row_major_insert_columns(gdt_table *t, int j_in, int n)
+{
+    if (unlikely(n > INT_MAX - t->size2)) return (-1);
+    const int os2 = t->size2, ns2 = t->size2 + n;
     int i;
 
-    if (unlikely(sz <= 0)) return (-1);
-    gdt_block *new_block = gdt_block_new(sz);
+    gdt_block *new_block = gdt_block_new(t->size1, ns2);
     if (unlikely(new_block == NULL)) return (-1);
     gdt_block_ref(new_block);
 
-    src = (int *) t->data;
-    dst = (int *) new_block->data;
+    const gdt_element *src = t->data;
+    gdt_element *dst = new_block->data;
 
     for (i = 0; i < t->size1; i++)
     {
-        int j;
-
-        for (j = 0; j < 2 * j_in; j++)
-        {
-            dst[j] = src[j];
-        }
-        for (/* */; j < 2 * os2; j++)
-        {
-            dst[j + 2 * n] = src[j];
-        }
-
-        dst += 2 * ns2;
-        src += 2 * os2;
+        memcpy(dst, src, sizeof(gdt_element) * j_in);
+        memcpy(dst + j_in + n, src + j_in, sizeof(gdt_element) * (os2 - j_in));
+        dst += ns2;
+        src += os2;
     }
 
     gdt_block_unref(t->block);
@@ -350,50 +455,125 @@ gdt_table_insert_columns(gdt_table *t, int j_in, int n)
     t->block = new_block;
     t->data = new_block->data;
 
-    string_array_insert(t->headers, j_in, n);
-
     return 0;
 }
 
-int
-gdt_table_insert_rows(gdt_table *t, int i_in, int n)
+static int
+row_major_insert_rows(gdt_table *t, int i_in, int n)
 {
-    int n1 = t->size1, n2 = t->size2;
-    int i;
+    if (unlikely(n > INT_MAX - t->size1)) return (-1);
+    const int n1 = t->size1, n2 = t->size2;
+    const size_t head_size = sizeof(gdt_element) * i_in * (size_t) n2;
+    const size_t tail_size = sizeof(gdt_element) * (n1 - i_in) * (size_t) n2;
+    const size_t offset = (size_t) n * n2;
 
-    if (t->block->size < (n1 + n) * n2)
+    if (t->block->size < (size_t) (n1 + n) * n2)
     {
-        int size_req = (n1 + n) * n2;
-        if (unlikely(size_req <= 0)) return (-1);
-        int new_size = round_two_power(size_req);
-        gdt_block *new_block = gdt_block_new(new_size);
+        gdt_block *new_block = gdt_block_new(alloc_round(n1 + n), n2);
 
         if (unlikely(new_block == NULL)) return (-1);
         gdt_block_ref(new_block);
 
-        int * const src = (int *) t->data;
-        int * const dst = (int *) new_block->data;
+        gdt_element * const src = t->data;
+        gdt_element * const dst = new_block->data;
 
-        for (i = 0; i < 2 * i_in * n2; i++)
-        {
-            dst[i] = src[i];
-        }
+        memcpy(dst, src, head_size);
+        memcpy(dst + (size_t) i_in * n2 + offset, src + (size_t) i_in * n2, tail_size);
+
+        gdt_block_unref(t->block);
+        t->block = new_block;
+        t->data = new_block->data;
+    }
+    else
+    {
+        gdt_element * const data = t->data + (size_t) i_in * n2;
+        memmove(data + offset, data, tail_size);
+    }
+
+    t->size1 = n1 + n;
+
+    return 0;
+}
+
+/* Number of columns that can be stored in the table's block with the
+   column-major layout without reallocation. */
+static int
+column_major_capacity(const gdt_table *t)
+{
+    if (t->tda == 0) return t->size2;
+    const size_t ncols = t->block->size / t->tda;
+    return (ncols > INT_MAX ? INT_MAX : (int) ncols);
+}
+
+static int
+column_major_insert_columns(gdt_table *t, int j_in, int n)
+{
+    if (unlikely(n > INT_MAX - t->size2)) return (-1);
+    const int os2 = t->size2, ns2 = t->size2 + n;
+    const int tda = t->tda;
+    const size_t col_size = sizeof(gdt_element) * tda;
+
+    /* If no rows are allocated the columns do not need any storage. */
+    if (tda > 0 && column_major_capacity(t) < ns2)
+    {
+        gdt_block *new_block = gdt_block_new(tda, alloc_round(ns2));
+        if (unlikely(new_block == NULL)) return (-1);
+        gdt_block_ref(new_block);
+
+        gdt_element *dst = new_block->data;
+        memcpy(dst, t->data, col_size * j_in);
+        memcpy(dst + (size_t) (j_in + n) * tda, t->data + (size_t) j_in * tda, col_size * (os2 - j_in));
+
+        gdt_block_unref(t->block);
+        t->block = new_block;
+        t->data = new_block->data;
+    }
+    else
+    {
+        /* When appending at the end nothing needs to be moved. */
+        memmove(t->data + (size_t) (j_in + n) * tda, t->data + (size_t) j_in * tda, col_size * (os2 - j_in));
+    }
+
+    t->size2 = ns2;
 
-        for (/* */; i < 2 * n1 * n2; i++)
+    return 0;
+}
+
+static int
+column_major_insert_rows(gdt_table *t, int i_in, int n)
+{
+    if (unlikely(n > INT_MAX - t->size1)) return (-1);
+    const int n1 = t->size1, n2 = t->size2;
+    int j;
+
+    if (t->tda < n1 + n)
+    {
+        const int ncols = column_major_capacity(t);
+        const int new_tda = alloc_round(n1 + n);
+        gdt_block *new_block = gdt_block_new(new_tda, (ncols > n2 ? ncols : n2));
+
+        if (unlikely(new_block == NULL)) return (-1);
+        gdt_block_ref(new_block);
+
+        for (j = 0; j < n2; j++)
         {
-            dst[i + 2 * n * n2] = src[i];
+            const gdt_element *src = t->data + (size_t) j * t->tda;
+            gdt_element *dst = new_block->data + (size_t) j * new_tda;
+            memcpy(dst, src, sizeof(gdt_element) * i_in);
+            memcpy(dst + i_in + n, src + i_in, sizeof(gdt_element) * (n1 - i_in));
         }
 
         gdt_block_unref(t->block);
         t->block = new_block;
         t->data = new_block->data;
+        t->tda = new_tda;
     }
     else
     {
-        int * const data = (int *) t->data;
-        for (i = 2 * n1 * n2 - 1; i >= 2 * i_in * n2; i--)
+        for (j = 0; j < n2; j++)
         {
-            data[i + 2 * n * n2] = data[i];
+            gdt_element *col = t->data + (size_t) j * t->tda;
+            memmove(col + i_in + n, col + i_in, sizeof(gdt_element) * (n1 - i_in));
         }
     }
 
@@ -402,6 +582,201 @@ gdt_table_insert_rows(gdt_table *t, int i_in, int n)
     return 0;
 }
 
+int
+gdt_table_insert_columns(gdt_table *t, int j_in, int n)
+{
+    int status;
+    if (t->layout == GDT_LAYOUT_COLUMN_MAJOR)
+        status = column_major_insert_columns(t, j_in, n);
+    else
+        status = row_major_insert_columns(t, j_in, n);
+    if (status == 0)
+        string_array_insert(t->headers, j_in, n);
+    return status;
+}
+
+int
+gdt_table_insert_rows(gdt_table *t, int i_in, int n)
+{
+    if (t->layout == GDT_LAYOUT_COLUMN_MAJOR)
+        return column_major_insert_rows(t, i_in, n);
+    return row_major_insert_rows(t, i_in, n);
+}
+
+int
+gdt_table_remove_rows(gdt_table *t, int i_in, int n)
+{
+    const int n1 = t->size1, n2 = t->size2;
+    if (unlikely(i_in < 0 || n < 0 || i_in + n > n1)) return (-1);
+
+    if (t->layout == GDT_LAYOUT_COLUMN_MAJOR)
+    {
+        for (int j = 0; j < n2; j++)
+        {
+            gdt_element *col = t->data + (size_t) j * t->tda;
+            memmove(col + i_in, col + i_in + n, sizeof(gdt_element) * (n1 - i_in - n));
+        }
+    }
+    else
+    {
+        gdt_element *data = t->data;
+        memmove(data + (size_t) i_in * t->tda, data + (size_t) (i_in + n) * t->tda,
+                sizeof(gdt_element) * (n1 - i_in - n) * t->tda);
+    }
+
+    t->size1 = n1 - n;
+
+    return 0;
+}
+
+/* Return a new table, with the same layout and headers, that contains
+   the given rows of "t" in the given order. The string index is copied
+   so that the string elements can be copied without remapping. */
+gdt_table *
+gdt_table_take_rows(const gdt_table *t, const int *rows, int n)
+{
+    const int n1 = t->size1, n2 = t->size2;
+    if (unlikely(n < 0)) return NULL;
+    for (int k = 0; k < n; k++)
+    {
+        if (unlikely(rows[k] < 0 || rows[k] >= n1)) return NULL;
+    }
+
+    gdt_table *new_t = gdt_table_new(n, n2, n, t->layout);
+    if (unlikely(new_t == NULL)) return NULL;
+
+    if (t->layout == GDT_LAYOUT_COLUMN_MAJOR)
+    {
+        for (int j = 0; j < n2; j++)
+        {
+            const gdt_element *src = t->data + (size_t) j * t->tda;
+            gdt_element *dst = new_t->data + (size_t) j * new_t->tda;
+            for (int k = 0; k < n; k++)
+                dst[k] = src[rows[k]];
+        }
+    }
+    else
+    {
+        for (int k = 0; k < n; k++)
+        {
+            memcpy(new_t->data + (size_t) k * new_t->tda, t->data + (size_t) rows[k] * t->tda,
+                   sizeof(gdt_element) * n2);
+        }
+    }
+
+    gdt_index_free(new_t->strings);
+    new_t->strings = gdt_index_copy(t->strings);
+
+    for (int j = 0; j < n2; j++)
+    {
+        const char *name = string_array_get(t->headers, j);
+        if (name)
+            string_array_set(new_t->headers, j, name);
+    }
+
+    return new_t;
+}
+
+#define LEVELS_HASH_MIN_SIZE 64
+
+static inline unsigned int
+element_hash(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (unsigned int) x;
+}
+
+#define SIGN_BIT UINT64_C(0x8000000000000000)
+
+/* Return the bits of the element used to compare the levels. A zero
+   is always positive so that 0 and -0 are the same level. The zero is
+   found on the bits as a floating point comparison with -ffast-math
+   can be true for NaN. */
+static inline uint64_t
+element_key(const gdt_element *e)
+{
+    uint64_t key;
+    memcpy(&key, e, sizeof(uint64_t));
+    if (!elem_is_string(e) && (key & ~SIGN_BIT) == 0)
+        key = 0;
+    return key;
+}
+
+/* Find the distinct values of the column "j" using a hash table of the
+   elements: strings are compared by their index and numbers by value.
+   For each row the index of its level, or -1 for an undefined value,
+   is stored in "codes" if it is not NULL. The index of the row where
+   each level appears first is stored in "level_rows". Both arrays
+   should have a size equal at least to the number of rows. Return the
+   number of levels or -1 if the column index is not valid. */
+int
+gdt_table_column_levels(const gdt_table *t, int j, int *codes, int *level_rows)
+{
+    if (unlikely(j < 0 || j >= t->size2)) return (-1);
+
+    unsigned int size = LEVELS_HASH_MIN_SIZE, mask = size - 1;
+    int *hash = xmalloc(sizeof(int) * size);
+    memset(hash, 0, sizeof(int) * size);
+    uint64_t *keys = NULL;
+    int nlevels = 0, keys_size = 0;
+
+    for (int i = 0; i < t->size1; i++)
+    {
+        const gdt_element *e = gdt_table_element(t, i, j);
+        if (elem_is_undef(e)) {
+            if (codes) codes[i] = -1;
+            continue;
+        }
+
+        const uint64_t key = element_key(e);
+        unsigned int k = element_hash(key) & mask;
+        int slot;
+        for (slot = hash[k]; slot != 0; slot = hash[k])
+        {
+            if (keys[slot - 1] == key) break;
+            k = (k + 1) & mask;
+        }
+
+        if (slot == 0)
+        {
+            if (nlevels >= keys_size)
+            {
+                keys_size = (keys_size > 0 ? 2 * keys_size : LEVELS_HASH_MIN_SIZE);
+                keys = xrealloc(keys, sizeof(uint64_t) * keys_size);
+            }
+            keys[nlevels] = key;
+            level_rows[nlevels] = i;
+            slot = ++nlevels;
+            hash[k] = slot;
+
+            /* keep the hash table at most half full */
+            if (2 * (unsigned int) nlevels > size)
+            {
+                size *= 2;
+                mask = size - 1;
+                free(hash);
+                hash = xmalloc(sizeof(int) * size);
+                memset(hash, 0, sizeof(int) * size);
+                for (int q = 0; q < nlevels; q++)
+                {
+                    unsigned int h = element_hash(keys[q]) & mask;
+                    while (hash[h] != 0)
+                        h = (h + 1) & mask;
+                    hash[h] = q + 1;
+                }
+            }
+        }
+
+        if (codes) codes[i] = slot - 1;
+    }
+
+    free(hash);
+    free(keys);
+    return nlevels;
+}
+
 gdt_table_cursor *
 gdt_table_get_cursor(gdt_table *t)
 {
@@ -473,3 +848,46 @@ gdt_table_cursor_set_undef(gdt_table_cursor *c, const char *key)
     }
     return (-1);
 }
+
+gdt_value_enum
+gdt_table_cursor_get_column(const gdt_table_cursor *c, int j, gdt_value *value)
+{
+    const gdt_table *t = c->table;
+    if (likely(t != NULL && j >= 0 && j < t->size2)) {
+        return gdt_table_get(t, c->index, j, value);
+    }
+    return GDT_VAL_ERROR;
+}
+
+int
+gdt_table_cursor_set_column_number(gdt_table_cursor *c, int j, double x)
+{
+    gdt_table *t = c->table;
+    if (likely(t != NULL && j >= 0 && j < t->size2)) {
+        gdt_table_set_number(t, c->index, j, x);
+        return 0;
+    }
+    return (-1);
+}
+
+int
+gdt_table_cursor_set_column_string(gdt_table_cursor *c, int j, const char *x)
+{
+    gdt_table *t = c->table;
+    if (likely(t != NULL && j >= 0 && j < t->size2)) {
+        gdt_table_set_string(t, c->index, j, x);
+        return 0;
+    }
+    return (-1);
+}
+
+int
+gdt_table_cursor_set_column_undef(gdt_table_cursor *c, int j)
+{
+    gdt_table *t = c->table;
+    if (likely(t != NULL && j >= 0 && j < t->size2)) {
+        gdt_table_set_undef(t, c->index, j);
+        return 0;
+    }
+    return (-1);
+}
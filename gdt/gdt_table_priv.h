@@ -1,7 +1,9 @@
 #ifndef GDT_TABLE_PRIV_H
 #define GDT_TABLE_PRIV_H
 
+#include "gdt_table.h"
 #include "gdt_index.h"
+#include "mapped_file.h"
 
 enum {
     TAG_STRING = 0xffff0000,
@@ -23,16 +25,26 @@ typedef union {
     } word;
 } gdt_element;
 
+/* The size is the number of elements. If "file" is not NULL the data
+   points inside a file mapped in memory and the block owns the mapping. */
 typedef struct {
-    int size;
+    size_t size;
     gdt_element *data;
     int ref_count;
+    struct mapped_file *file;
 } gdt_block;
 
+/* "hash" maps the names to their index with open addressing and
+   linear probing. Each slot contains the index plus one or zero for an
+   empty slot. If a name is used more than once the smallest index is
+   stored. */
 struct string_array {
     struct char_buffer buffer[1];
     int *offset_data;
     int offset_len;
+    int *hash;
+    unsigned int hash_mask;
+    int hash_count;
 };
 
 struct __gdt_table_cursor {
@@ -42,10 +54,14 @@ struct __gdt_table_cursor {
 
 #define GDT_HEADER_TEMP_SIZE 16
 
+/* With the row-major layout "tda" is the distance between two rows
+   while with the column-major layout it is the distance between two
+   columns, i.e. the number of rows allocated for each column. */
 struct __gdt_table {
     int size1;
     int size2;
     int tda;
+    gdt_layout_enum layout;
     gdt_element *data;
     gdt_block *block;
     gdt_index *strings;
@@ -54,6 +70,14 @@ struct __gdt_table {
     gdt_table_cursor cursor[1];
 };
 
-static const char *        gdt_table_element_get_string (const gdt_table *t, const gdt_element *e);
+extern gdt_table *gdt_table_new_mapped(struct mapped_file *file, size_t offset, int nb_rows, int nb_columns, gdt_layout_enum layout);
+
+static inline gdt_element *
+gdt_table_element(const gdt_table *t, int i, int j)
+{
+    if (t->layout == GDT_LAYOUT_COLUMN_MAJOR)
+        return &t->data[(size_t) j * t->tda + i];
+    return &t->data[(size_t) i * t->tda + j];
+}
 
 #endif
@@ -0,0 +1,95 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mapped_file.h"
+
+#ifdef WIN32
+
+int
+mapped_file_open(struct mapped_file *m, const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) return (-1);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc(size > 0 ? size : 1);
+    if (data == NULL || fread(data, 1, size, f) != (size_t) size) {
+        free(data);
+        fclose(f);
+        return (-1);
+    }
+    fclose(f);
+    m->data = data;
+    m->size = size;
+    return 0;
+}
+
+int
+mapped_file_open_private(struct mapped_file *m, const char *filename)
+{
+    return mapped_file_open(m, filename);
+}
+
+void
+mapped_file_close(struct mapped_file *m)
+{
+    free((char *) m->data);
+}
+
+#else
+
+static int
+map_file(struct mapped_file *m, const char *filename, int prot, int advice)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return (-1);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return (-1);
+    }
+    m->size = st.st_size;
+    m->data = NULL;
+    if (m->size > 0) {
+        void *p = mmap(NULL, m->size, prot, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return (-1);
+        }
+        posix_madvise(p, m->size, advice);
+        m->data = p;
+    }
+    close(fd);
+    return 0;
+}
+
+int
+mapped_file_open(struct mapped_file *m, const char *filename)
+{
+    return map_file(m, filename, PROT_READ, POSIX_MADV_SEQUENTIAL);
+}
+
+int
+mapped_file_open_private(struct mapped_file *m, const char *filename)
+{
+    return map_file(m, filename, PROT_READ | PROT_WRITE, POSIX_MADV_NORMAL);
+}
+
+void
+mapped_file_close(struct mapped_file *m)
+{
+    if (m->size > 0)
+        munmap((void *) m->data, m->size);
+}
+
+#endif
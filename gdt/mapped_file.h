@@ -0,0 +1,19 @@
+#ifndef GDT_MAPPED_FILE_H
+#define GDT_MAPPED_FILE_H
+
+#include <stddef.h>
+
+/* View of a whole file. On POSIX systems the file is memory mapped,
+   otherwise its content is read into a malloc'ed buffer. The view
+   returned by mapped_file_open_private can be modified: the pages are
+   copied on write and the changes are never written back to the file. */
+struct mapped_file {
+    const char *data;
+    size_t size;
+};
+
+extern int  mapped_file_open          (struct mapped_file *m, const char *filename);
+extern int  mapped_file_open_private  (struct mapped_file *m, const char *filename);
+extern void mapped_file_close         (struct mapped_file *m);
+
+#endif
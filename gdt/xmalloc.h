@@ -16,6 +16,17 @@ static inline void *xmalloc(size_t sz)
     return p;
 }
 
+static inline void *xrealloc(void *p, size_t sz)
+{
+    void *new_p = realloc(p, sz);
+    if (unlikely(new_p == NULL))
+    {
+        fputs("not enough virtual memory!\n", stderr);
+        abort();
+    }
+    return new_p;
+}
+
 static inline unsigned int round_two_power(unsigned int n)
 {
     n = n - 1;
@@ -108,6 +108,23 @@ ffi.cdef[[
 	int owner;
      } gsl_matrix_complex;
 
+     typedef struct
+     {
+       size_t size;
+       float * data;
+       int ref_count;
+     } gsl_block_float;
+
+     typedef struct
+     {
+       size_t size1;
+       size_t size2;
+       size_t tda;
+       float * data;
+       gsl_block_float * block;
+       int owner;
+     } gsl_matrix_float;
+
      typedef gsl_vector gsl_vector_view;
      typedef gsl_vector gsl_vector_const_view;
 
@@ -1302,6 +1319,14 @@ int  gsl_blas_zher2 (CBLAS_UPLO_t Uplo,
                      const gsl_vector_complex * Y,
                      gsl_matrix_complex * A);
 
+int  gsl_blas_sgemm (CBLAS_TRANSPOSE_t TransA,
+                     CBLAS_TRANSPOSE_t TransB,
+                     float alpha,
+                     const gsl_matrix_float * A,
+                     const gsl_matrix_float * B,
+                     float beta,
+                     gsl_matrix_float * C);
+
 int  gsl_blas_dgemm (CBLAS_TRANSPOSE_t TransA,
                      CBLAS_TRANSPOSE_t TransB,
                      double alpha,
@@ -19,11 +19,13 @@ require('gdt')
 require('gdt-parse-csv')
 require('gdt-hist')
 require('gdt-plot')
+require('gdt-aggregate')
 require('gdt-lm')
 require('gdt-interp')
 require('linfit')
 
 num.bspline = require 'bspline'
+matrix.sparse = require 'sparse'
 
 local demomod
 
@@ -24,6 +24,22 @@ num.quad_prepare {method= <string>, order= <int>, limits= <int>}
    *limits*
       The maximum number of subdivisions for adaptive algorithms.
       The default value is 64.
+
+   *vector*
+      If true the integrand is called as f(xs, n, ys) and should store
+      in ys[i] its value at xs[i] for i from 0 to n-1.
+]],
+
+   [num.integ_many] = [[
+num.integ_many(f, m, a, b[, epsabs, epsrel, limit])
+
+   Compute the integrals of a family of "m" functions over the
+   intervals given by "a" and "b", numbers or column matrices, with a
+   single adaptive subdivision. The function "f" is called as
+   f(xs, n, ys) and should store the value of the j-th function at
+   xs[i] in ys[j*n + i]. Returns the matrices of the integrals and of
+   the errors, with a row for each function and a column for each
+   interval.
 ]],
 
    [num.linfit] = [[
@@ -8,12 +8,13 @@ local ODE = get_ode()
 
 local M = {
     [num.ode] = [[
-num.ode {N= <int>, eps_abs= <num>, eps_rel= <num>}
+num.ode {N= <int>, eps_abs= <num>, eps_rel= <num>, method= <string>}
 
    Return an ODE object to numerically integrate an ordinary
    differential equation. N is the dimension of the system and
    eps_abs, eps_rel are the requested absolute and relative 
-   precision, respectively.
+   precision, respectively. The method can be "rkf45", the default,
+   "rk8pd" or, for stiff systems, "rosenbrock" or "bdf".
 ]]
 }
 
@@ -44,6 +45,30 @@ if ODE then
    called again to further advance the ODE system.
 ]]
 
+    if ODE.sample then
+        M[ODE.sample] = [[
+<ode>:sample(ts[, out])
+
+   Advance the ODE system up to the last of the increasing times given
+   by the column matrix ts and give the values of the system variables
+   at each time, interpolated between the natural steps of the
+   integrator. The values are stored in the rows of the matrix "out",
+   or of a new matrix if it is not given. If "out" is a function it is
+   called for each time as "out(t, y_1, y_2, ..., y_N)".
+]]
+    end
+
+    if ODE.set_jacobian then
+        M[ODE.set_jacobian] = [[
+<ode>:set_jacobian(df)
+
+   Give the function that computes the Jacobian of the system for the
+   implicit methods. It will be called as "df(t, J, y_1, y_2, ...,
+   y_N)" and should set the elements of the N x N matrix J, zero on
+   entry. Without it the Jacobian is computed by finite differences.
+]]
+    end
+
     M[ODE.evolve] = [[
  evolve(t1, t_step)
 
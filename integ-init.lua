@@ -2,12 +2,15 @@
 local template = require 'template'
 local check = require 'check'
 
+local ffi = require 'ffi'
+
 function num.quad_prepare(options)
    local known_methods = {qng= true, qag= true}
 
    local method = options.method or 'qag'
    local order  = options.order  or 21
    local limit  = options.limit  or 64
+   local vector = options.vector and true or false
 
    if not known_methods[method] then
       error('the method ' .. method .. ' is unknown')
@@ -17,7 +20,7 @@ function num.quad_prepare(options)
 
    if limit < 8 then limit = 8 end
    
-   local q = template.load(method, {limit= limit, order= order})
+   local q = template.load(method, {limit= limit, order= order, vector= vector})
 
    return q
 end
@@ -39,3 +42,85 @@ function num.integ(f, a, b, epsabs, epsrel)
 
    return result
 end
+
+local function endpoints(x)
+   if type(x) == 'number' then return {x} end
+   local n1, n2 = matrix.dim(x)
+   if n2 ~= 1 then
+      error('the interval limits should be numbers or column matrices', 3)
+   end
+   local t = {}
+   for i = 1, n1 do t[i] = x.data[(i-1)*x.tda] end
+   return t
+end
+
+local q_many
+
+function num.integ_many(f, m, a, b, epsabs, epsrel, limit)
+   epsabs = epsabs or 1e-8
+   epsrel = epsrel or 1e-8
+
+   check.integer(m)
+   if m < 1 then error('the number of integrands should be positive', 2) end
+
+   local at, bt = endpoints(a), endpoints(b)
+   local L = math.max(#at, #bt)
+   if (#at ~= L and #at ~= 1) or (#bt ~= L and #bt ~= 1) then
+      error('the interval limits should have the same length', 2)
+   end
+
+   -- sorted list of the distinct interval limits
+   local lo, hi, sign, pts, index = {}, {}, {}, {}, {}
+   for k = 1, L do
+      local ak, bk = at[#at == 1 and 1 or k], bt[#bt == 1 and 1 or k]
+      lo[k], hi[k], sign[k] = math.min(ak, bk), math.max(ak, bk), ak <= bk and 1 or -1
+      for _, x in ipairs {ak, bk} do
+         if not index[x] then index[x] = true; pts[#pts+1] = x end
+      end
+   end
+   table.sort(pts)
+   for i, x in ipairs(pts) do index[x] = i end
+
+   -- the segments between consecutive limits covered by an interval
+   local cover = {}
+   for i = 1, #pts do cover[i] = 0 end
+   for k = 1, L do
+      cover[index[lo[k]]] = cover[index[lo[k]]] + 1
+      cover[index[hi[k]]] = cover[index[hi[k]]] - 1
+   end
+
+   local seg, nseg, c = {}, 0, 0
+   for i = 1, #pts - 1 do
+      c = c + cover[i]
+      if c > 0 then seg[i] = nseg; nseg = nseg + 1 end
+   end
+
+   local sa, sb = ffi.new('double[?]', nseg), ffi.new('double[?]', nseg)
+   for i = 1, #pts - 1 do
+      if seg[i] then sa[seg[i]], sb[seg[i]] = pts[i], pts[i+1] end
+   end
+
+   local ilo, ihi = ffi.new('int[?]', L), ffi.new('int[?]', L)
+   for k = 1, L do
+      local i, j = index[lo[k]], index[hi[k]]
+      ilo[k-1] = i < j and seg[i] or 0
+      ihi[k-1] = i < j and seg[i] + (j - i) or 0
+   end
+
+   local r, e = matrix.new(m, L), matrix.new(m, L)
+
+   if nseg > 0 then
+      if not q_many then
+         q_many = template.load('qag-many', {order= 21})
+      end
+      q_many(f, m, sa, sb, nseg, ilo, ihi, L, epsabs, epsrel, limit or 64 * nseg, r.data, e.data)
+   end
+
+   for k = 1, L do
+      if sign[k] < 0 then
+         for j = 0, m - 1 do r.data[j*L + k-1] = - r.data[j*L + k-1] end
+      end
+   end
+
+   return r, e
+end
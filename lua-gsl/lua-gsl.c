@@ -30,11 +30,43 @@
 #include "fatal.h"
 
 #include "gdt/gdt_table.h"
+#include "gdt/gdt_read_csv.h"
+#include "gdt/gdt_binary.h"
+#include "matrix-pool.h"
+#include "matrix-sort.h"
+#include "matrix-mmap.h"
+#include "sparse-matrix.h"
+#include "lua-pool.h"
 
 /* used to force the linker to link the gdt library. Otherwise it
  * would be discarded as there are no other references to its functions. */
-extern gdt_table *(*_gdt_ref)(int nb_rows, int nb_columns, int nb_rows_alloc);
-gdt_table *(*_gdt_ref)(int nb_rows, int nb_columns, int nb_rows_alloc) = gdt_table_new;
+extern gdt_table *(*_gdt_ref)(int nb_rows, int nb_columns, int nb_rows_alloc, gdt_layout_enum layout);
+gdt_table *(*_gdt_ref)(int nb_rows, int nb_columns, int nb_rows_alloc, gdt_layout_enum layout) = gdt_table_new;
+
+/* The same for the CSV reader and the binary format, they are in their
+   own object files. */
+extern gdt_table *(*_gdt_read_csv_ref)(const char *filename, const gdt_csv_options *opt, int *error);
+gdt_table *(*_gdt_read_csv_ref)(const char *filename, const gdt_csv_options *opt, int *error) = gdt_table_read_csv;
+
+extern gdt_table *(*_gdt_binary_ref)(const char *filename);
+gdt_table *(*_gdt_binary_ref)(const char *filename) = gdt_table_load_binary;
+
+/* The same for the matrix pool, sort, mmap, sparse and Lua pool
+   functions that are used only from Lua. */
+extern void *(*_matrix_pool_ref)(size_t size);
+void *(*_matrix_pool_ref)(size_t size) = matrix_pool_alloc;
+
+extern void (*_matrix_sort_ref)(double *data, size_t stride, size_t n);
+void (*_matrix_sort_ref)(double *data, size_t stride, size_t n) = matrix_sort_strided;
+
+extern void (*_matrix_mmap_ref)(matrix_mmap *m);
+void (*_matrix_mmap_ref)(matrix_mmap *m) = matrix_mmap_close;
+
+extern void (*_sparse_matrix_ref)(sparse_matrix *a);
+void (*_sparse_matrix_ref)(sparse_matrix *a) = sparse_free;
+
+extern void (*_lua_pool_ref)(lua_pool *p);
+void (*_lua_pool_ref)(lua_pool *p) = lua_pool_free;
 
 struct gsl_shell_state* global_state;
 
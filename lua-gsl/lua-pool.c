@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+
+#include "lua-pool.h"
+
+struct lua_pool {
+    int nstates;
+    lua_State **states;
+    int *refs;
+};
+
+/* State shared by the threads during a run. The index of the next task
+   and the error message are protected by the mutex. */
+struct pool_run {
+    pthread_mutex_t mutex;
+    int next, ntasks;
+    const double *args;
+    int nargs;
+    int error;
+    char *errmsg;
+    size_t errlen;
+};
+
+struct pool_worker {
+    struct pool_run *run;
+    lua_State *L;
+    int ref;
+};
+
+static void
+set_error(char *errmsg, size_t errlen, const char *msg)
+{
+    if (errmsg && errlen > 0) {
+        strncpy(errmsg, msg ? msg : "unknown error", errlen - 1);
+        errmsg[errlen - 1] = 0;
+    }
+}
+
+lua_pool *
+lua_pool_new(int nstates, const char *code, char *errmsg, size_t errlen)
+{
+    lua_pool *p;
+    int k;
+
+    if (nstates < 1) {
+        set_error(errmsg, errlen, "invalid number of states");
+        return NULL;
+    }
+
+    p = malloc(sizeof(lua_pool));
+    if (p == NULL) {
+        set_error(errmsg, errlen, "not enough memory");
+        return NULL;
+    }
+    p->nstates = 0;
+    p->states = malloc(sizeof(lua_State *) * nstates);
+    p->refs = malloc(sizeof(int) * nstates);
+    if (p->states == NULL || p->refs == NULL) {
+        set_error(errmsg, errlen, "not enough memory");
+        lua_pool_free(p);
+        return NULL;
+    }
+
+    for (k = 0; k < nstates; k++) {
+        lua_State *L = luaL_newstate();
+        if (L == NULL) {
+            set_error(errmsg, errlen, "cannot create state: not enough memory");
+            lua_pool_free(p);
+            return NULL;
+        }
+        p->states[k] = L;
+        p->nstates = k + 1;
+
+        luaL_openlibs(L);
+        if (luaL_loadbuffer(L, code, strlen(code), "=pool") != 0 ||
+            lua_pcall(L, 0, 1, 0) != 0) {
+            set_error(errmsg, errlen, lua_tostring(L, -1));
+            lua_pool_free(p);
+            return NULL;
+        }
+        if (!lua_isfunction(L, -1)) {
+            set_error(errmsg, errlen, "the pool code should return a function");
+            lua_pool_free(p);
+            return NULL;
+        }
+        p->refs[k] = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+
+    return p;
+}
+
+static void *
+pool_work(void *arg)
+{
+    struct pool_worker *w = arg;
+    struct pool_run *run = w->run;
+    lua_State *L = w->L;
+
+    for (;;) {
+        int task, j;
+
+        pthread_mutex_lock(&run->mutex);
+        task = (run->error ? run->ntasks : run->next++);
+        pthread_mutex_unlock(&run->mutex);
+
+        if (task >= run->ntasks)
+            break;
+
+        lua_rawgeti(L, LUA_REGISTRYINDEX, w->ref);
+        lua_pushinteger(L, task);
+        for (j = 0; j < run->nargs; j++)
+            lua_pushnumber(L, run->args[j]);
+
+        if (lua_pcall(L, run->nargs + 1, 0, 0) != 0) {
+            pthread_mutex_lock(&run->mutex);
+            if (!run->error) {
+                run->error = 1;
+                set_error(run->errmsg, run->errlen, lua_tostring(L, -1));
+            }
+            pthread_mutex_unlock(&run->mutex);
+            lua_pop(L, 1);
+        }
+    }
+
+    return NULL;
+}
+
+int
+lua_pool_run(lua_pool *p, int ntasks, const double *args, int nargs,
+             char *errmsg, size_t errlen)
+{
+    struct pool_run run[1];
+    struct pool_worker *workers;
+    pthread_t *threads;
+    int *started;
+    int n = (ntasks < p->nstates ? ntasks : p->nstates), k;
+
+    if (n <= 0)
+        return 0;
+
+    workers = malloc(sizeof(struct pool_worker) * n);
+    threads = malloc(sizeof(pthread_t) * n);
+    started = malloc(sizeof(int) * n);
+    if (workers == NULL || threads == NULL || started == NULL) {
+        free(workers);
+        free(threads);
+        free(started);
+        set_error(errmsg, errlen, "not enough memory");
+        return -1;
+    }
+
+    pthread_mutex_init(&run->mutex, NULL);
+    run->next = 0;
+    run->ntasks = ntasks;
+    run->args = args;
+    run->nargs = nargs;
+    run->error = 0;
+    run->errmsg = errmsg;
+    run->errlen = errlen;
+
+    /* The first state is used by the calling thread. */
+    for (k = 0; k < n; k++) {
+        workers[k].run = run;
+        workers[k].L = p->states[k];
+        workers[k].ref = p->refs[k];
+        started[k] = (k > 0 && pthread_create(&threads[k], NULL, pool_work, &workers[k]) == 0);
+    }
+    pool_work(&workers[0]);
+    for (k = 1; k < n; k++) {
+        if (started[k])
+            pthread_join(threads[k], NULL);
+    }
+
+    pthread_mutex_destroy(&run->mutex);
+    free(workers);
+    free(threads);
+    free(started);
+    return (run->error ? -1 : 0);
+}
+
+int
+lua_pool_size(const lua_pool *p)
+{
+    return p->nstates;
+}
+
+void
+lua_pool_free(lua_pool *p)
+{
+    int k;
+    for (k = 0; k < p->nstates; k++)
+        lua_close(p->states[k]);
+    free(p->states);
+    free(p->refs);
+    free(p);
+}
@@ -0,0 +1,28 @@
+#ifndef LUA_POOL_H
+#define LUA_POOL_H
+
+#include <stddef.h>
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+/* Pool of independent Lua states used to run a task function in
+   parallel. Each state is created with the standard libraries and runs
+   the given chunk, that should return the task function. The function
+   is called with the index of the task, starting from zero, followed by
+   the arguments given to lua_pool_run. The tasks are distributed among
+   threads, one for each state. The states are kept between the runs so
+   that the code compiled by the JIT is reused. */
+
+typedef struct lua_pool lua_pool;
+
+extern lua_pool *lua_pool_new  (int nstates, const char *code, char *errmsg, size_t errlen);
+extern int       lua_pool_run  (lua_pool *p, int ntasks, const double *args, int nargs,
+                                char *errmsg, size_t errlen);
+extern int       lua_pool_size (const lua_pool *p);
+extern void      lua_pool_free (lua_pool *p);
+
+__END_DECLS
+
+#endif
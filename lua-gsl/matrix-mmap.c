@@ -0,0 +1,190 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "matrix-mmap.h"
+
+/* Layout of the file: the header, struct matrix_file_header, and the
+   elements starting at "data_offset", aligned to MATRIX_FILE_ALIGN. A
+   file written with a different byte order is refused. */
+
+#define MATRIX_FILE_MAGIC "GSLMATRX"
+#define MATRIX_FILE_VERSION 1
+#define MATRIX_FILE_BYTE_ORDER 0x01020304u
+#define MATRIX_FILE_ALIGN 64
+
+struct matrix_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t element_size;
+    uint32_t reserved;
+    uint64_t size1;
+    uint64_t size2;
+    uint64_t data_offset;
+};
+
+#ifdef WIN32
+
+matrix_mmap *
+matrix_mmap_open(const char *filename, int mode, size_t size1, size_t size2, int *error)
+{
+    *error = MATRIX_MMAP_EUNSUPPORTED;
+    return NULL;
+}
+
+void
+matrix_mmap_close(matrix_mmap *m)
+{
+}
+
+int
+matrix_mmap_advise(void *data, size_t length, int advice)
+{
+    return 0;
+}
+
+#else
+
+static int
+header_check(const struct matrix_file_header *h, size_t file_size)
+{
+    if (memcmp(h->magic, MATRIX_FILE_MAGIC, 8) != 0 || h->version != MATRIX_FILE_VERSION ||
+        h->byte_order != MATRIX_FILE_BYTE_ORDER || h->element_size != sizeof(double))
+        return MATRIX_MMAP_EFORMAT;
+    if (h->data_offset < sizeof(struct matrix_file_header) ||
+        h->data_offset % MATRIX_FILE_ALIGN != 0 || h->data_offset > file_size)
+        return MATRIX_MMAP_EFORMAT;
+    /* The dimensions are checked before the multiplication that could
+       overflow with a corrupted header. */
+    if (h->size1 > SIZE_MAX || h->size2 > SIZE_MAX ||
+        (h->size2 > 0 && h->size1 > SIZE_MAX / sizeof(double) / h->size2) ||
+        h->size1 * h->size2 * sizeof(double) > file_size - h->data_offset)
+        return MATRIX_MMAP_EFORMAT;
+    return 0;
+}
+
+/* Create the file with its header and the space for the elements,
+   that are initially zero. */
+static int
+file_create(const char *filename, size_t size1, size_t size2)
+{
+    struct matrix_file_header h;
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+        return -1;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MATRIX_FILE_MAGIC, 8);
+    h.version = MATRIX_FILE_VERSION;
+    h.byte_order = MATRIX_FILE_BYTE_ORDER;
+    h.element_size = sizeof(double);
+    h.size1 = size1;
+    h.size2 = size2;
+    h.data_offset = MATRIX_FILE_ALIGN;
+    if (write(fd, &h, sizeof(h)) != (ssize_t) sizeof(h) ||
+        ftruncate(fd, MATRIX_FILE_ALIGN + size1 * size2 * sizeof(double)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+matrix_mmap *
+matrix_mmap_open(const char *filename, int mode, size_t size1, size_t size2, int *error)
+{
+    int fd, prot, flags;
+    struct stat st;
+    const struct matrix_file_header *h;
+    matrix_mmap *m;
+    void *p;
+
+    *error = MATRIX_MMAP_ESYSTEM;
+    if (mode == MATRIX_MMAP_CREATE && size2 > 0 &&
+        size1 > (SIZE_MAX - MATRIX_FILE_ALIGN) / sizeof(double) / size2) {
+        errno = EFBIG;
+        return NULL;
+    }
+    if (mode == MATRIX_MMAP_CREATE)
+        fd = file_create(filename, size1, size2);
+    else
+        fd = open(filename, mode == MATRIX_MMAP_WRITE ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+    if ((size_t) st.st_size < sizeof(struct matrix_file_header)) {
+        close(fd);
+        *error = MATRIX_MMAP_EFORMAT;
+        return NULL;
+    }
+
+    /* The read-only mapping shares the pages of the file and any write
+       to them raises a segmentation fault. The private mapping is
+       writable with copy-on-write pages, the changes are not saved. */
+    prot = (mode == MATRIX_MMAP_READ ? PROT_READ : PROT_READ | PROT_WRITE);
+    flags = (mode == MATRIX_MMAP_PRIVATE ? MAP_PRIVATE : MAP_SHARED);
+    p = mmap(NULL, st.st_size, prot, flags, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return NULL;
+
+    h = p;
+    *error = header_check(h, st.st_size);
+    if (*error == 0 && size1 > 0 && (h->size1 != size1 || h->size2 != size2))
+        *error = MATRIX_MMAP_ESIZE;
+    if (*error != 0) {
+        munmap(p, st.st_size);
+        return NULL;
+    }
+
+    m = malloc(sizeof(matrix_mmap));
+    if (m == NULL) {
+        munmap(p, st.st_size);
+        *error = MATRIX_MMAP_ESYSTEM;
+        return NULL;
+    }
+    m->map = p;
+    m->length = st.st_size;
+    m->data = (double *) ((char *) p + h->data_offset);
+    m->size1 = h->size1;
+    m->size2 = h->size2;
+    return m;
+}
+
+void
+matrix_mmap_close(matrix_mmap *m)
+{
+    munmap(m->map, m->length);
+    free(m);
+}
+
+static const int advice_flags[] = {
+    POSIX_MADV_NORMAL, POSIX_MADV_SEQUENTIAL, POSIX_MADV_RANDOM,
+    POSIX_MADV_WILLNEED, POSIX_MADV_DONTNEED,
+};
+
+/* The address given to posix_madvise should be aligned to a page. */
+int
+matrix_mmap_advise(void *data, size_t length, int advice)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t) data & ~(uintptr_t) (page - 1);
+    if (advice < 0 || advice > MATRIX_MMAP_DONTNEED)
+        return -1;
+    return posix_madvise((void *) start, length + ((uintptr_t) data - start), advice_flags[advice]);
+}
+
+#endif
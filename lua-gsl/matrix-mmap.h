@@ -0,0 +1,57 @@
+#ifndef MATRIX_MMAP_H
+#define MATRIX_MMAP_H
+
+#include <stddef.h>
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+/* Matrix stored in a memory mapped file. The file begins with a header
+   that gives the dimensions of the matrix and is followed by its
+   elements, stored by rows as doubles with the byte order of the
+   machine. */
+
+enum matrix_mmap_mode {
+    MATRIX_MMAP_READ = 0,     /* read only, the elements cannot be written */
+    MATRIX_MMAP_PRIVATE = 1,  /* copy-on-write, the file is not changed */
+    MATRIX_MMAP_WRITE = 2,    /* the changes are written to the file */
+    MATRIX_MMAP_CREATE = 3    /* create a new file, then as WRITE */
+};
+
+enum matrix_mmap_error {
+    MATRIX_MMAP_ESYSTEM = 1,  /* system error, given by errno */
+    MATRIX_MMAP_EFORMAT,      /* not a matrix file or wrong byte order */
+    MATRIX_MMAP_ESIZE,        /* dimensions do not match the file */
+    MATRIX_MMAP_EUNSUPPORTED
+};
+
+enum matrix_mmap_advice {
+    MATRIX_MMAP_NORMAL = 0,
+    MATRIX_MMAP_SEQUENTIAL,
+    MATRIX_MMAP_RANDOM,
+    MATRIX_MMAP_WILLNEED,
+    MATRIX_MMAP_DONTNEED
+};
+
+typedef struct {
+    void *map;
+    size_t length;
+    double *data;
+    size_t size1, size2;
+} matrix_mmap;
+
+/* Map the file and return NULL in case of error with the error code in
+   "error". If "size1" and "size2" are not zero they should match the
+   dimensions of the matrix in the file. They are required to create a
+   new file. */
+extern matrix_mmap *matrix_mmap_open   (const char *filename, int mode, size_t size1, size_t size2, int *error);
+extern void         matrix_mmap_close  (matrix_mmap *m);
+
+/* Give to the system an advice about the use of the memory from "data"
+   for "length" bytes. It can be used on any part of a mapped matrix. */
+extern int          matrix_mmap_advise (void *data, size_t length, int advice);
+
+__END_DECLS
+
+#endif
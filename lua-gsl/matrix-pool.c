@@ -0,0 +1,204 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "matrix-pool.h"
+
+/* The size classes go from 64 bytes up to 2^MAX_SIZE_BITS bytes with
+   four classes for each power of two so that a buffer is at most 25%
+   bigger than requested. Bigger buffers are not pooled. */
+#define MIN_SIZE_BITS 6
+#define MAX_SIZE_BITS 36
+#define CLASS_NUMBER (4 * (MAX_SIZE_BITS - MIN_SIZE_BITS) + 1)
+#define NO_CLASS (-1)
+
+#define DEFAULT_CACHED_LIMIT ((size_t) 256 << 20)
+
+/* Each buffer is preceded by a header that gives its class and its
+   size. The header size keeps the alignment given by malloc. */
+union pool_header {
+    struct {
+        int size_class;
+        size_t size;
+    } info;
+    double align[2];
+};
+
+/* A buffer in a free list stores the pointer to the next one. */
+struct free_buffer {
+    struct free_buffer *next;
+};
+
+struct matrix_pool {
+    pthread_mutex_t lock[1];
+    struct free_buffer *free_list[CLASS_NUMBER];
+    size_t requests;
+    size_t hits;
+    size_t bytes_in_use;
+    size_t peak_bytes;
+    size_t cached_bytes;
+    size_t cached_limit;
+};
+
+static struct matrix_pool pool = {
+    .lock = {PTHREAD_MUTEX_INITIALIZER},
+    .cached_limit = DEFAULT_CACHED_LIMIT,
+};
+
+static int
+highest_bit(size_t n)
+{
+    int k = 0;
+    while (n >>= 1) k++;
+    return k;
+}
+
+/* Return the class of the given size or NO_CLASS if it is too big. */
+static int
+size_class(size_t size)
+{
+    if (size <= ((size_t) 1 << MIN_SIZE_BITS))
+        return 0;
+    int k = highest_bit(size - 1);
+    if (k >= MAX_SIZE_BITS)
+        return NO_CLASS;
+    size_t quarter = (size_t) 1 << (k - 2);
+    int s = (size - ((size_t) 1 << k) + quarter - 1) / quarter;
+    return 4 * (k - MIN_SIZE_BITS) + s;
+}
+
+static size_t
+class_size(int c)
+{
+    if (c == 0)
+        return (size_t) 1 << MIN_SIZE_BITS;
+    int k = (c - 1) / 4 + MIN_SIZE_BITS, s = (c - 1) % 4 + 1;
+    return ((size_t) 1 << k) + s * ((size_t) 1 << (k - 2));
+}
+
+static void
+count_in_use(size_t size)
+{
+    pool.bytes_in_use += size;
+    if (pool.bytes_in_use > pool.peak_bytes)
+        pool.peak_bytes = pool.bytes_in_use;
+}
+
+void *
+matrix_pool_alloc(size_t size)
+{
+    int c = size_class(size);
+    size_t alloc_size = (c != NO_CLASS ? class_size(c) : size);
+    struct free_buffer *b = NULL;
+
+    pthread_mutex_lock(pool.lock);
+    pool.requests++;
+    if (c != NO_CLASS && pool.free_list[c]) {
+        b = pool.free_list[c];
+        pool.free_list[c] = b->next;
+        pool.cached_bytes -= alloc_size;
+        pool.hits++;
+        count_in_use(alloc_size);
+    }
+    pthread_mutex_unlock(pool.lock);
+
+    if (b != NULL)
+        return b;
+
+    union pool_header *h = malloc(sizeof(union pool_header) + alloc_size);
+    if (unlikely(h == NULL))
+        return NULL;
+    h->info.size_class = c;
+    h->info.size = alloc_size;
+
+    pthread_mutex_lock(pool.lock);
+    count_in_use(alloc_size);
+    pthread_mutex_unlock(pool.lock);
+
+    return h + 1;
+}
+
+/* The buffer is added to the free list of its class unless the cached
+   buffers would exceed the limit. */
+void
+matrix_pool_free(void *p)
+{
+    if (p == NULL) return;
+    union pool_header *h = (union pool_header *) p - 1;
+    int c = h->info.size_class;
+    size_t size = h->info.size;
+    int cached = 0;
+
+    pthread_mutex_lock(pool.lock);
+    pool.bytes_in_use -= size;
+    if (c != NO_CLASS && pool.cached_bytes + size <= pool.cached_limit) {
+        struct free_buffer *b = p;
+        b->next = pool.free_list[c];
+        pool.free_list[c] = b;
+        pool.cached_bytes += size;
+        cached = 1;
+    }
+    pthread_mutex_unlock(pool.lock);
+
+    if (!cached)
+        free(h);
+}
+
+/* Release to the system all the buffers in the free lists. */
+void
+matrix_pool_trim(void)
+{
+    struct free_buffer *lists[CLASS_NUMBER];
+    int c;
+
+    pthread_mutex_lock(pool.lock);
+    for (c = 0; c < CLASS_NUMBER; c++) {
+        lists[c] = pool.free_list[c];
+        pool.free_list[c] = NULL;
+    }
+    pool.cached_bytes = 0;
+    pthread_mutex_unlock(pool.lock);
+
+    for (c = 0; c < CLASS_NUMBER; c++) {
+        struct free_buffer *b = lists[c];
+        while (b) {
+            struct free_buffer *next = b->next;
+            free((union pool_header *) b - 1);
+            b = next;
+        }
+    }
+}
+
+/* Set the maximum size of the buffers kept in the free lists. The
+   free lists are emptied if they are bigger than the new limit. */
+void
+matrix_pool_set_limit(size_t bytes)
+{
+    pthread_mutex_lock(pool.lock);
+    pool.cached_limit = bytes;
+    int exceeded = (pool.cached_bytes > bytes);
+    pthread_mutex_unlock(pool.lock);
+    if (exceeded)
+        matrix_pool_trim();
+}
+
+void
+matrix_pool_get_stats(struct matrix_pool_stats *stats)
+{
+    pthread_mutex_lock(pool.lock);
+    stats->requests     = pool.requests;
+    stats->hits         = pool.hits;
+    stats->bytes_in_use = pool.bytes_in_use;
+    stats->peak_bytes   = pool.peak_bytes;
+    stats->cached_bytes = pool.cached_bytes;
+    stats->cached_limit = pool.cached_limit;
+    pthread_mutex_unlock(pool.lock);
+}
+
+/* Set the peak of the bytes in use to the current value. */
+void
+matrix_pool_reset_peak(void)
+{
+    pthread_mutex_lock(pool.lock);
+    pool.peak_bytes = pool.bytes_in_use;
+    pthread_mutex_unlock(pool.lock);
+}
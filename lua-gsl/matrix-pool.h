@@ -0,0 +1,34 @@
+#ifndef MATRIX_POOL_H
+#define MATRIX_POOL_H
+
+#include <stddef.h>
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+/* Pool of memory buffers used for the storage of the matrices. The
+   buffers are grouped in size classes and the released buffers are
+   kept in a free list for each class to be reused by the following
+   allocations of the same class. All the functions can be called from
+   any thread. */
+
+struct matrix_pool_stats {
+    double requests;
+    double hits;
+    double bytes_in_use;
+    double peak_bytes;
+    double cached_bytes;
+    double cached_limit;
+};
+
+extern void * matrix_pool_alloc (size_t size);
+extern void   matrix_pool_free  (void *p);
+extern void   matrix_pool_trim  (void);
+extern void   matrix_pool_set_limit (size_t bytes);
+extern void   matrix_pool_get_stats (struct matrix_pool_stats *stats);
+extern void   matrix_pool_reset_peak (void);
+
+__END_DECLS
+
+#endif
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "matrix-sort.h"
+
+/* The sort is an introsort: a quicksort with the median of three as
+   pivot that switches to heapsort when the recursion is too deep and
+   leaves the small partitions to a final insertion sort. The selection
+   is a quickselect with the same fallback on the heapsort. */
+
+#define INSERTION_THRESHOLD 16
+
+/* NaN test on the bits of the number: the exponent has all the bits
+   set and the mantissa is not zero. The comparison x != x cannot be used
+   as it is optimized away with -ffast-math. */
+static inline int
+is_nan(double x)
+{
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(double));
+    return (bits & UINT64_C(0x7fffffffffffffff)) > UINT64_C(0x7ff0000000000000);
+}
+
+/* Ascending order with the NaN values at the end. The arrays are
+   sorted with the simple comparison after moving the NaN values at the
+   end. */
+#define LESS(a, b) ((a) < (b) || (is_nan(b) && !is_nan(a)))
+#define NUM_LESS(a, b) ((a) < (b))
+
+/* The argsort sorts the pairs of value and index. The ties are broken by
+   the index so that the order of equal elements is preserved. */
+struct sort_pair {
+    double value;
+    size_t index;
+};
+
+#define PAIR_LESS(a, b) ((a).value < (b).value || \
+    ((a).value == (b).value && (a).index < (b).index))
+
+static int
+depth_limit(size_t n)
+{
+    int k = 0;
+    while (n >>= 1) k++;
+    return 2 * k;
+}
+
+#define DEFINE_SORT(NAME, TYPE, LESS_FN)                                \
+static void                                                             \
+NAME ## _sift_down(TYPE *a, size_t root, size_t n)                      \
+{                                                                       \
+    TYPE value = a[root];                                               \
+    size_t child;                                                       \
+    while ((child = 2 * root + 1) < n) {                                \
+        if (child + 1 < n && LESS_FN(a[child], a[child + 1]))           \
+            child++;                                                    \
+        if (!LESS_FN(value, a[child]))                                  \
+            break;                                                      \
+        a[root] = a[child];                                             \
+        root = child;                                                   \
+    }                                                                   \
+    a[root] = value;                                                    \
+}                                                                       \
+                                                                        \
+static void                                                             \
+NAME ## _heapsort(TYPE *a, size_t n)                                    \
+{                                                                       \
+    size_t k;                                                           \
+    if (n < 2) return;                                                  \
+    for (k = n / 2; k-- > 0; )                                          \
+        NAME ## _sift_down(a, k, n);                                    \
+    for (k = n - 1; k > 0; k--) {                                       \
+        TYPE t = a[0]; a[0] = a[k]; a[k] = t;                           \
+        NAME ## _sift_down(a, 0, k);                                    \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+static void                                                             \
+NAME ## _insertion_sort(TYPE *a, size_t n)                              \
+{                                                                       \
+    size_t i, j;                                                        \
+    for (i = 1; i < n; i++) {                                           \
+        TYPE value = a[i];                                              \
+        for (j = i; j > 0 && LESS_FN(value, a[j - 1]); j--)             \
+            a[j] = a[j - 1];                                            \
+        a[j] = value;                                                   \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+/* Move the median of the elements 1, n/2 and n-1 to the first position \
+   and partition the others around it like in libstdc++. Return the    \
+   index of the first element of the right part, between 1 and n-1. */ \
+static size_t                                                           \
+NAME ## _partition(TYPE *a, size_t n)                                   \
+{                                                                       \
+    size_t x = 1, y = n / 2, z = n - 1, m, first = 1, last = n;         \
+    TYPE t, pivot;                                                      \
+    if (LESS_FN(a[x], a[y]))                                            \
+        m = LESS_FN(a[y], a[z]) ? y : (LESS_FN(a[x], a[z]) ? z : x);    \
+    else                                                                \
+        m = LESS_FN(a[x], a[z]) ? x : (LESS_FN(a[y], a[z]) ? z : y);    \
+    t = a[0]; a[0] = a[m]; a[m] = t;                                    \
+    pivot = a[0];                                                       \
+    for (;;) {                                                          \
+        while (LESS_FN(a[first], pivot)) first++;                       \
+        last--;                                                         \
+        while (LESS_FN(pivot, a[last])) last--;                         \
+        if (first >= last) return first;                                \
+        t = a[first]; a[first] = a[last]; a[last] = t;                  \
+        first++;                                                        \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+static void                                                             \
+NAME ## _introsort_loop(TYPE *a, size_t n, int depth)                   \
+{                                                                       \
+    while (n > INSERTION_THRESHOLD) {                                   \
+        size_t cut;                                                     \
+        if (depth-- == 0) {                                             \
+            NAME ## _heapsort(a, n);                                    \
+            return;                                                     \
+        }                                                               \
+        cut = NAME ## _partition(a, n);                                 \
+        NAME ## _introsort_loop(a + cut, n - cut, depth);               \
+        n = cut;                                                        \
+    }                                                                   \
+}                                                                       \
+                                                                        \
+static void                                                             \
+NAME ## _sort(TYPE *a, size_t n)                                        \
+{                                                                       \
+    NAME ## _introsort_loop(a, n, depth_limit(n));                      \
+    NAME ## _insertion_sort(a, n);                                      \
+}
+
+DEFINE_SORT(double, double, NUM_LESS)
+DEFINE_SORT(pair, struct sort_pair, PAIR_LESS)
+
+/* Move the NaN values at the end of the array and return the number of
+   the other elements. */
+static size_t
+move_nan_last(double *a, size_t n)
+{
+    size_t i = 0, k;
+    for (k = 0; k < n; k++) {
+        if (!is_nan(a[k])) {
+            double t = a[i]; a[i] = a[k]; a[k] = t;
+            i++;
+        }
+    }
+    return i;
+}
+
+void
+matrix_sort_strided(double *data, size_t stride, size_t n)
+{
+    size_t k;
+    double *a;
+    if (stride == 1) {
+        double_sort(data, move_nan_last(data, n));
+        return;
+    }
+    a = malloc(n * sizeof(double));
+    if (a == NULL) {
+        /* Without the work copy the elements are sorted in place with
+           an insertion sort. */
+        size_t i, j;
+        for (i = 1; i < n; i++) {
+            double value = data[i * stride];
+            for (j = i; j > 0 && LESS(value, data[(j - 1) * stride]); j--)
+                data[j * stride] = data[(j - 1) * stride];
+            data[j * stride] = value;
+        }
+        return;
+    }
+    for (k = 0; k < n; k++)
+        a[k] = data[k * stride];
+    double_sort(a, move_nan_last(a, n));
+    for (k = 0; k < n; k++)
+        data[k * stride] = a[k];
+    free(a);
+}
+
+/* Store in "perm" the indexes, starting from zero, of the elements in
+   ascending order. Return a non-zero value if the memory for the work
+   copy cannot be allocated. */
+int
+matrix_argsort_strided(const double *data, size_t stride, size_t n, size_t *perm)
+{
+    size_t k, i = 0, j;
+    struct sort_pair *a = malloc(n * sizeof(struct sort_pair));
+    if (a == NULL)
+        return 1;
+    /* The NaN values go at the end in the order of their indexes. */
+    for (k = 0; k < n; k++) {
+        if (!is_nan(data[k * stride])) {
+            a[i].value = data[k * stride];
+            a[i].index = k;
+            i++;
+        }
+    }
+    for (k = 0, j = i; k < n; k++) {
+        if (is_nan(data[k * stride])) {
+            a[j].value = data[k * stride];
+            a[j].index = k;
+            j++;
+        }
+    }
+    pair_sort(a, i);
+    for (k = 0; k < n; k++)
+        perm[k] = a[k].index;
+    free(a);
+    return 0;
+}
+
+/* Move the k-th smallest element at the index k of the array with the
+   smaller elements before it and the greater ones after it. */
+static void
+double_select(double *a, size_t n, size_t k)
+{
+    int depth;
+    n = move_nan_last(a, n);
+    if (k >= n)
+        return;
+    depth = depth_limit(n);
+    while (n > INSERTION_THRESHOLD) {
+        size_t cut;
+        if (depth-- == 0) {
+            double_heapsort(a, n);
+            return;
+        }
+        cut = double_partition(a, n);
+        if (k < cut) {
+            n = cut;
+        } else {
+            a += cut;
+            n -= cut;
+            k -= cut;
+        }
+    }
+    double_insertion_sort(a, n);
+}
+
+static double *
+matrix_work_copy(const double *data, size_t tda, size_t n1, size_t n2)
+{
+    size_t i, j;
+    double *a = malloc(n1 * n2 * sizeof(double));
+    if (a == NULL)
+        return NULL;
+    for (i = 0; i < n1; i++)
+        for (j = 0; j < n2; j++)
+            a[i * n2 + j] = data[i * tda + j];
+    return a;
+}
+
+double
+matrix_nth_element(const double *data, size_t tda, size_t n1, size_t n2, size_t k)
+{
+    double x, *a = matrix_work_copy(data, tda, n1, n2);
+    if (a == NULL)
+        return NAN;
+    double_select(a, n1 * n2, k);
+    x = a[k];
+    free(a);
+    return x;
+}
+
+/* The quantile is computed by linear interpolation between the two
+   elements around the position p (n - 1) like in
+   gsl_stats_quantile_from_sorted_data. After the selection the next
+   element is the smallest of the right part. */
+double
+matrix_quantile(const double *data, size_t tda, size_t n1, size_t n2, double p)
+{
+    size_t n = n1 * n2, k, lhs;
+    double index, delta, x, *a;
+    if (n == 0)
+        return NAN;
+    a = matrix_work_copy(data, tda, n1, n2);
+    if (a == NULL)
+        return NAN;
+    index = p * (n - 1);
+    lhs = (size_t) index;
+    delta = index - lhs;
+    double_select(a, n, lhs);
+    x = a[lhs];
+    if (lhs + 1 < n && delta > 0) {
+        double y = a[lhs + 1];
+        for (k = lhs + 2; k < n; k++)
+            if (LESS(a[k], y)) y = a[k];
+        x = (1 - delta) * x + delta * y;
+    }
+    free(a);
+    return x;
+}
@@ -0,0 +1,25 @@
+#ifndef MATRIX_SORT_H
+#define MATRIX_SORT_H
+
+#include <stddef.h>
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+/* Sorting and selection of arrays of doubles with a stride, like the
+   columns of a matrix. The numbers are in ascending order with the NaN
+   values at the end. */
+
+extern void   matrix_sort_strided    (double *data, size_t stride, size_t n);
+extern int    matrix_argsort_strided (const double *data, size_t stride, size_t n, size_t *perm);
+
+/* Selection of the elements of a n1 x n2 matrix with row stride "tda".
+   They return NaN if the memory for the work copy of the elements
+   cannot be allocated. */
+extern double matrix_nth_element (const double *data, size_t tda, size_t n1, size_t n2, size_t k);
+extern double matrix_quantile    (const double *data, size_t tda, size_t n1, size_t n2, double p);
+
+__END_DECLS
+
+#endif
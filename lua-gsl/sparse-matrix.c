@@ -0,0 +1,706 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "sparse-matrix.h"
+
+#define COO_INIT_SIZE 64
+
+/* The CSR products are divided among threads only if each thread has at
+   least this number of nonzero elements. */
+#define MATVEC_THREAD_MIN_NNZ 65536
+#define MATVEC_MAX_THREADS 64
+
+static int matvec_threads = 0;
+
+struct matvec_chunk;
+
+/* Worker threads of the CSR products. They are started when a product
+   first needs them and then wait for the chunks of the next products,
+   so that a product does not pay for the creation of the threads. The
+   fields are protected by the mutex. A product started while another
+   one is running, from another thread, is computed by its caller. */
+static struct {
+    pthread_mutex_t run;
+    pthread_mutex_t mutex;
+    pthread_cond_t start, done;
+    int nworkers;
+    unsigned long generation;
+    struct matvec_chunk *chunks;
+    int next, nchunks, pending;
+} matvec_workers = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    0, 0, NULL, 0, 0, 0
+};
+
+sparse_coo *
+sparse_coo_new(size_t size1, size_t size2)
+{
+    sparse_coo *c = malloc(sizeof(sparse_coo));
+    if (c == NULL)
+        return NULL;
+    c->size1 = size1;
+    c->size2 = size2;
+    c->nz = 0;
+    c->size = COO_INIT_SIZE;
+    c->rows = malloc(sizeof(size_t) * c->size);
+    c->cols = malloc(sizeof(size_t) * c->size);
+    c->data = malloc(sizeof(double) * c->size);
+    if (c->rows == NULL || c->cols == NULL || c->data == NULL) {
+        sparse_coo_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+void
+sparse_coo_free(sparse_coo *c)
+{
+    free(c->rows);
+    free(c->cols);
+    free(c->data);
+    free(c);
+}
+
+/* Add a triplet, with indexes starting from zero. Return a non-zero
+   value if the arrays cannot be enlarged. */
+int
+sparse_coo_add(sparse_coo *c, size_t i, size_t j, double x)
+{
+    if (c->nz >= c->size) {
+        size_t size = 2 * c->size;
+        size_t *rows = realloc(c->rows, sizeof(size_t) * size);
+        if (rows == NULL) return 1;
+        c->rows = rows;
+        size_t *cols = realloc(c->cols, sizeof(size_t) * size);
+        if (cols == NULL) return 1;
+        c->cols = cols;
+        double *data = realloc(c->data, sizeof(double) * size);
+        if (data == NULL) return 1;
+        c->data = data;
+        c->size = size;
+    }
+    c->rows[c->nz] = i;
+    c->cols[c->nz] = j;
+    c->data[c->nz] = x;
+    c->nz++;
+    return 0;
+}
+
+static sparse_matrix *
+sparse_alloc(size_t size1, size_t size2, size_t nnz, int format)
+{
+    size_t n_major = (format == SPARSE_CSR ? size1 : size2);
+    sparse_matrix *a = malloc(sizeof(sparse_matrix));
+    if (a == NULL)
+        return NULL;
+    a->size1 = size1;
+    a->size2 = size2;
+    a->nz = nnz;
+    a->sptype = format;
+    a->ptr = calloc(n_major + 1, sizeof(size_t));
+    a->index = malloc(sizeof(size_t) * (nnz > 0 ? nnz : 1));
+    a->data = malloc(sizeof(double) * (nnz > 0 ? nnz : 1));
+    if (a->ptr == NULL || a->index == NULL || a->data == NULL) {
+        sparse_free(a);
+        return NULL;
+    }
+    return a;
+}
+
+void
+sparse_free(sparse_matrix *a)
+{
+    free(a->ptr);
+    free(a->index);
+    free(a->data);
+    free(a);
+}
+
+/* Store in "order" the positions 0 .. n-1 sorted by "key" with a
+   stable counting sort. The array "count" should have n_keys + 1
+   elements. */
+static void
+counting_sort(const size_t *key, const size_t *order_in, size_t n, size_t n_keys,
+              size_t *count, size_t *order)
+{
+    size_t k;
+    memset(count, 0, sizeof(size_t) * (n_keys + 1));
+    for (k = 0; k < n; k++)
+        count[key[order_in ? order_in[k] : k] + 1]++;
+    for (k = 0; k < n_keys; k++)
+        count[k + 1] += count[k];
+    for (k = 0; k < n; k++) {
+        size_t p = (order_in ? order_in[k] : k);
+        order[count[key[p]]++] = p;
+    }
+}
+
+sparse_matrix *
+sparse_from_coo(const sparse_coo *c, int format)
+{
+    const size_t *major = (format == SPARSE_CSR ? c->rows : c->cols);
+    const size_t *minor = (format == SPARSE_CSR ? c->cols : c->rows);
+    size_t n_major = (format == SPARSE_CSR ? c->size1 : c->size2);
+    size_t n_minor = (format == SPARSE_CSR ? c->size2 : c->size1);
+    size_t n_max = (n_major > n_minor ? n_major : n_minor);
+    size_t nnz = c->nz, k, m;
+
+    size_t *count = malloc(sizeof(size_t) * (n_max + 1));
+    size_t *order1 = malloc(sizeof(size_t) * (nnz > 0 ? nnz : 1));
+    size_t *order2 = malloc(sizeof(size_t) * (nnz > 0 ? nnz : 1));
+    sparse_matrix *a = NULL;
+    if (count == NULL || order1 == NULL || order2 == NULL)
+        goto done;
+
+    /* Sorting by the minor index and then, stably, by the major one
+       gives the elements in order. */
+    counting_sort(minor, NULL, nnz, n_minor, count, order1);
+    counting_sort(major, order1, nnz, n_major, count, order2);
+
+    /* Count the distinct elements of each row to allocate the matrix. */
+    size_t distinct = 0;
+    for (k = 0; k < nnz; k++) {
+        size_t p = order2[k], q = (k > 0 ? order2[k - 1] : 0);
+        if (k == 0 || major[p] != major[q] || minor[p] != minor[q])
+            distinct++;
+    }
+
+    a = sparse_alloc(c->size1, c->size2, distinct, format);
+    if (a == NULL)
+        goto done;
+
+    /* The duplicated elements are summed. */
+    m = 0;
+    for (k = 0; k < nnz; k++) {
+        size_t p = order2[k], q = (k > 0 ? order2[k - 1] : 0);
+        if (k == 0 || major[p] != major[q] || minor[p] != minor[q]) {
+            a->index[m] = minor[p];
+            a->data[m] = c->data[p];
+            a->ptr[major[p] + 1]++;
+            m++;
+        } else {
+            a->data[m - 1] += c->data[p];
+        }
+    }
+    for (k = 0; k < n_major; k++)
+        a->ptr[k + 1] += a->ptr[k];
+
+done:
+    free(count);
+    free(order1);
+    free(order2);
+    return a;
+}
+
+sparse_matrix *
+sparse_from_dense(const double *data, size_t tda, size_t size1, size_t size2, int format)
+{
+    size_t i, j, nnz = 0, m = 0;
+    for (i = 0; i < size1; i++)
+        for (j = 0; j < size2; j++)
+            if (data[i * tda + j] != 0)
+                nnz++;
+    sparse_matrix *a = sparse_alloc(size1, size2, nnz, format);
+    if (a == NULL)
+        return NULL;
+    if (format == SPARSE_CSR) {
+        for (i = 0; i < size1; i++) {
+            for (j = 0; j < size2; j++) {
+                double x = data[i * tda + j];
+                if (x != 0) {
+                    a->index[m] = j;
+                    a->data[m++] = x;
+                }
+            }
+            a->ptr[i + 1] = m;
+        }
+    } else {
+        for (j = 0; j < size2; j++) {
+            for (i = 0; i < size1; i++) {
+                double x = data[i * tda + j];
+                if (x != 0) {
+                    a->index[m] = i;
+                    a->data[m++] = x;
+                }
+            }
+            a->ptr[j + 1] = m;
+        }
+    }
+    return a;
+}
+
+/* Return a copy of the matrix with the other compressed format. The
+   arrays of the result are the ones of the transpose in the same
+   format. */
+static sparse_matrix *
+sparse_swap_format(const sparse_matrix *a)
+{
+    int format = (a->sptype == SPARSE_CSR ? SPARSE_CSC : SPARSE_CSR);
+    size_t n_major = (a->sptype == SPARSE_CSR ? a->size1 : a->size2);
+    size_t n_minor = (a->sptype == SPARSE_CSR ? a->size2 : a->size1);
+    size_t i, p;
+    sparse_matrix *b = sparse_alloc(a->size1, a->size2, a->nz, format);
+    if (b == NULL)
+        return NULL;
+    for (p = 0; p < a->nz; p++)
+        b->ptr[a->index[p] + 1]++;
+    for (i = 0; i < n_minor; i++)
+        b->ptr[i + 1] += b->ptr[i];
+    size_t *next = malloc(sizeof(size_t) * (n_minor > 0 ? n_minor : 1));
+    if (next == NULL) {
+        sparse_free(b);
+        return NULL;
+    }
+    memcpy(next, b->ptr, sizeof(size_t) * n_minor);
+    for (i = 0; i < n_major; i++) {
+        for (p = a->ptr[i]; p < a->ptr[i + 1]; p++) {
+            size_t q = next[a->index[p]]++;
+            b->index[q] = i;
+            b->data[q] = a->data[p];
+        }
+    }
+    free(next);
+    return b;
+}
+
+static sparse_matrix *
+sparse_copy(const sparse_matrix *a)
+{
+    size_t n_major = (a->sptype == SPARSE_CSR ? a->size1 : a->size2);
+    sparse_matrix *b = sparse_alloc(a->size1, a->size2, a->nz, a->sptype);
+    if (b == NULL)
+        return NULL;
+    memcpy(b->ptr, a->ptr, sizeof(size_t) * (n_major + 1));
+    memcpy(b->index, a->index, sizeof(size_t) * a->nz);
+    memcpy(b->data, a->data, sizeof(double) * a->nz);
+    return b;
+}
+
+sparse_matrix *
+sparse_convert(const sparse_matrix *a, int format)
+{
+    return (a->sptype == format ? sparse_copy(a) : sparse_swap_format(a));
+}
+
+/* The transpose has the same arrays of the matrix in the other
+   format. */
+sparse_matrix *
+sparse_transpose(const sparse_matrix *a)
+{
+    sparse_matrix *b = sparse_swap_format(a);
+    if (b == NULL)
+        return NULL;
+    size_t t = b->size1;
+    b->size1 = b->size2;
+    b->size2 = t;
+    b->sptype = a->sptype;
+    return b;
+}
+
+static int
+index_compare(const void *a, const void *b)
+{
+    size_t x = *(const size_t *) a, y = *(const size_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* Product of two CSR matrices with the Gustavson algorithm. Each row of
+   the result is accumulated in a dense array. */
+sparse_matrix *
+sparse_matmul(const sparse_matrix *a, const sparse_matrix *b)
+{
+    size_t n1 = a->size1, n2 = b->size2, i, p, q, k;
+    size_t size = a->nz + b->nz + 1, nnz = 0;
+    double *acc = calloc(n2 > 0 ? n2 : 1, sizeof(double));
+    size_t *mark = malloc(sizeof(size_t) * (n2 > 0 ? n2 : 1));
+    size_t *row_cols = malloc(sizeof(size_t) * (n2 > 0 ? n2 : 1));
+    size_t *ptr = malloc(sizeof(size_t) * (n1 + 1));
+    size_t *index = malloc(sizeof(size_t) * size);
+    double *data = malloc(sizeof(double) * size);
+    sparse_matrix *c = NULL;
+    if (!acc || !mark || !row_cols || !ptr || !index || !data)
+        goto done;
+
+    for (k = 0; k < n2; k++)
+        mark[k] = (size_t) -1;
+
+    ptr[0] = 0;
+    for (i = 0; i < n1; i++) {
+        size_t row_nnz = 0;
+        for (p = a->ptr[i]; p < a->ptr[i + 1]; p++) {
+            size_t j = a->index[p];
+            double x = a->data[p];
+            for (q = b->ptr[j]; q < b->ptr[j + 1]; q++) {
+                size_t col = b->index[q];
+                if (mark[col] != i) {
+                    mark[col] = i;
+                    row_cols[row_nnz++] = col;
+                    acc[col] = 0;
+                }
+                acc[col] += x * b->data[q];
+            }
+        }
+        if (nnz + row_nnz > size) {
+            while (nnz + row_nnz > size)
+                size *= 2;
+            size_t *new_index = realloc(index, sizeof(size_t) * size);
+            if (new_index == NULL) goto done;
+            index = new_index;
+            double *new_data = realloc(data, sizeof(double) * size);
+            if (new_data == NULL) goto done;
+            data = new_data;
+        }
+        qsort(row_cols, row_nnz, sizeof(size_t), index_compare);
+        for (k = 0; k < row_nnz; k++) {
+            index[nnz] = row_cols[k];
+            data[nnz++] = acc[row_cols[k]];
+        }
+        ptr[i + 1] = nnz;
+    }
+
+    c = malloc(sizeof(sparse_matrix));
+    if (c == NULL)
+        goto done;
+    c->size1 = n1;
+    c->size2 = n2;
+    c->nz = nnz;
+    c->sptype = SPARSE_CSR;
+    c->ptr = ptr;
+    c->index = index;
+    c->data = data;
+    ptr = NULL, index = NULL, data = NULL;
+
+done:
+    free(acc);
+    free(mark);
+    free(row_cols);
+    free(ptr);
+    free(index);
+    free(data);
+    return c;
+}
+
+/* Return the position of the element of index "j" in the segment
+   "from" - "to" or "to" if it is not present. */
+static size_t
+segment_find(const size_t *index, size_t from, size_t to, size_t j)
+{
+    size_t lo = from, hi = to;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index[mid] < j)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (lo < to && index[lo] == j ? lo : to);
+}
+
+double
+sparse_get(const sparse_matrix *a, size_t i, size_t j)
+{
+    size_t major = (a->sptype == SPARSE_CSR ? i : j);
+    size_t minor = (a->sptype == SPARSE_CSR ? j : i);
+    size_t from = a->ptr[major], to = a->ptr[major + 1];
+    size_t p = segment_find(a->index, from, to, minor);
+    return (p < to ? a->data[p] : 0.0);
+}
+
+void
+sparse_to_dense(const sparse_matrix *a, double *data, size_t tda)
+{
+    size_t n_major = (a->sptype == SPARSE_CSR ? a->size1 : a->size2);
+    size_t i, p;
+    for (i = 0; i < a->size1; i++)
+        memset(data + i * tda, 0, sizeof(double) * a->size2);
+    for (i = 0; i < n_major; i++) {
+        for (p = a->ptr[i]; p < a->ptr[i + 1]; p++) {
+            if (a->sptype == SPARSE_CSR)
+                data[i * tda + a->index[p]] = a->data[p];
+            else
+                data[a->index[p] * tda + i] = a->data[p];
+        }
+    }
+}
+
+void
+sparse_diagonal(const sparse_matrix *a, double *d)
+{
+    size_t n = (a->size1 < a->size2 ? a->size1 : a->size2), i;
+    for (i = 0; i < n; i++) {
+        size_t p = segment_find(a->index, a->ptr[i], a->ptr[i + 1], i);
+        d[i] = (p < a->ptr[i + 1] ? a->data[p] : 0.0);
+    }
+}
+
+struct matvec_chunk {
+    const sparse_matrix *a;
+    double alpha, beta;
+    const double *x;
+    double *y;
+    size_t incx, incy;
+    size_t row_begin, row_end;
+};
+
+static void *
+csr_matvec_rows(void *arg)
+{
+    const struct matvec_chunk *c = arg;
+    const sparse_matrix *a = c->a;
+    const size_t *ptr = a->ptr, *index = a->index;
+    const double *data = a->data, *x = c->x;
+    size_t i, p;
+    for (i = c->row_begin; i < c->row_end; i++) {
+        double s = 0;
+        for (p = ptr[i]; p < ptr[i + 1]; p++)
+            s += data[p] * x[index[p] * c->incx];
+        double *yi = c->y + i * c->incy;
+        *yi = c->alpha * s + (c->beta != 0 ? c->beta * *yi : 0.0);
+    }
+    return NULL;
+}
+
+static int
+cpu_count()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0 ? n : 1);
+#else
+    return 1;
+#endif
+}
+
+/* Set the number of threads of the products, zero to use one for each
+   processor. The workers are started by the next big product. */
+void
+sparse_set_threads(int n)
+{
+    matvec_threads = (n > 0 ? n : 0);
+}
+
+static int
+matvec_thread_count(size_t nnz)
+{
+    size_t n_max = nnz / MATVEC_THREAD_MIN_NNZ;
+    int n = (matvec_threads > 0 ? matvec_threads : cpu_count());
+    if (n > MATVEC_MAX_THREADS)
+        n = MATVEC_MAX_THREADS;
+    return ((size_t) n <= n_max ? n : (n_max > 0 ? (int) n_max : 1));
+}
+
+/* Compute the chunks of the current product until none is left. Called
+   with the mutex locked. */
+static void
+matvec_take_chunks()
+{
+    while (matvec_workers.next < matvec_workers.nchunks) {
+        struct matvec_chunk *c = &matvec_workers.chunks[matvec_workers.next++];
+        pthread_mutex_unlock(&matvec_workers.mutex);
+        csr_matvec_rows(c);
+        pthread_mutex_lock(&matvec_workers.mutex);
+        if (--matvec_workers.pending == 0)
+            pthread_cond_signal(&matvec_workers.done);
+    }
+}
+
+static void *
+matvec_worker(void *arg)
+{
+    unsigned long seen = 0;
+    pthread_mutex_lock(&matvec_workers.mutex);
+    for (;;) {
+        while (matvec_workers.generation == seen)
+            pthread_cond_wait(&matvec_workers.start, &matvec_workers.mutex);
+        seen = matvec_workers.generation;
+        matvec_take_chunks();
+    }
+    return NULL;
+}
+
+/* Start the workers up to "n", if possible. Called with the mutex
+   locked. */
+static void
+matvec_start_workers(int n)
+{
+    while (matvec_workers.nworkers < n) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, matvec_worker, NULL) != 0)
+            break;
+        pthread_detach(thread);
+        matvec_workers.nworkers++;
+    }
+}
+
+/* Compute the chunks with the workers. The caller computes the chunks
+   too, so the product completes even if no worker could be started. */
+static void
+matvec_run(struct matvec_chunk *chunks, int n)
+{
+    int k;
+    if (pthread_mutex_trylock(&matvec_workers.run) != 0) {
+        for (k = 0; k < n; k++)
+            csr_matvec_rows(&chunks[k]);
+        return;
+    }
+    pthread_mutex_lock(&matvec_workers.mutex);
+    matvec_start_workers(n - 1);
+    matvec_workers.chunks = chunks;
+    matvec_workers.next = 0;
+    matvec_workers.nchunks = n;
+    matvec_workers.pending = n;
+    matvec_workers.generation++;
+    pthread_cond_broadcast(&matvec_workers.start);
+    matvec_take_chunks();
+    while (matvec_workers.pending > 0)
+        pthread_cond_wait(&matvec_workers.done, &matvec_workers.mutex);
+    matvec_workers.chunks = NULL;
+    matvec_workers.nchunks = 0;
+    pthread_mutex_unlock(&matvec_workers.mutex);
+    pthread_mutex_unlock(&matvec_workers.run);
+}
+
+/* The rows are divided so that each thread has about the same number of
+   nonzero elements. */
+static void
+csr_matvec(const sparse_matrix *a, double alpha, const double *x, size_t incx,
+           double beta, double *y, size_t incy)
+{
+    struct matvec_chunk chunks[MATVEC_MAX_THREADS];
+    int n = matvec_thread_count(a->nz), k;
+    size_t row = 0;
+    for (k = 0; k < n; k++) {
+        struct matvec_chunk *c = &chunks[k];
+        size_t target = (a->nz / n) * (k + 1);
+        c->a = a;
+        c->alpha = alpha;
+        c->beta = beta;
+        c->x = x;
+        c->y = y;
+        c->incx = incx;
+        c->incy = incy;
+        c->row_begin = row;
+        if (k == n - 1) {
+            row = a->size1;
+        } else {
+            while (row < a->size1 && a->ptr[row] < target)
+                row++;
+        }
+        c->row_end = row;
+    }
+    if (n > 1)
+        matvec_run(chunks, n);
+    else
+        csr_matvec_rows(&chunks[0]);
+}
+
+static void
+csc_matvec(const sparse_matrix *a, double alpha, const double *x, size_t incx,
+           double beta, double *y, size_t incy)
+{
+    size_t i, j, p;
+    for (i = 0; i < a->size1; i++)
+        y[i * incy] = (beta != 0 ? beta * y[i * incy] : 0.0);
+    for (j = 0; j < a->size2; j++) {
+        double xj = alpha * x[j * incx];
+        for (p = a->ptr[j]; p < a->ptr[j + 1]; p++)
+            y[a->index[p] * incy] += a->data[p] * xj;
+    }
+}
+
+void
+sparse_matvec(const sparse_matrix *a, double alpha, const double *x, size_t incx,
+              double beta, double *y, size_t incy)
+{
+    if (a->sptype == SPARSE_CSR)
+        csr_matvec(a, alpha, x, incx, beta, y, incy);
+    else
+        csc_matvec(a, alpha, x, incx, beta, y, incy);
+}
+
+void
+sparse_ilu0_free(sparse_ilu0 *f)
+{
+    if (f->lu)
+        sparse_free(f->lu);
+    free(f->diag);
+    free(f);
+}
+
+/* Incomplete LU factorization of a square CSR matrix, with the IKJ
+   variant of the Gaussian elimination restricted to the pattern of the
+   matrix. Return NULL if a diagonal element is missing or zero. */
+sparse_ilu0 *
+sparse_ilu0_new(const sparse_matrix *a)
+{
+    size_t n = a->size1, i, p, q;
+    sparse_ilu0 *f = calloc(1, sizeof(sparse_ilu0));
+    size_t *pos = malloc(sizeof(size_t) * (n > 0 ? n : 1));
+    if (f == NULL || pos == NULL)
+        goto error;
+    f->lu = sparse_copy(a);
+    f->diag = malloc(sizeof(size_t) * (n > 0 ? n : 1));
+    if (f->lu == NULL || f->diag == NULL)
+        goto error;
+
+    const size_t *ptr = f->lu->ptr, *index = f->lu->index;
+    double *lu = f->lu->data;
+    for (i = 0; i < n; i++) {
+        f->diag[i] = segment_find(index, ptr[i], ptr[i + 1], i);
+        if (f->diag[i] == ptr[i + 1])
+            goto error;
+        pos[i] = (size_t) -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        for (p = ptr[i]; p < ptr[i + 1]; p++)
+            pos[index[p]] = p;
+        for (p = ptr[i]; p < f->diag[i]; p++) {
+            size_t k = index[p];
+            double lik = lu[p] / lu[f->diag[k]];
+            lu[p] = lik;
+            for (q = f->diag[k] + 1; q < ptr[k + 1]; q++) {
+                size_t r = pos[index[q]];
+                if (r != (size_t) -1)
+                    lu[r] -= lik * lu[q];
+            }
+        }
+        for (p = ptr[i]; p < ptr[i + 1]; p++)
+            pos[index[p]] = (size_t) -1;
+        if (lu[f->diag[i]] == 0)
+            goto error;
+    }
+    free(pos);
+    return f;
+
+error:
+    free(pos);
+    if (f)
+        sparse_ilu0_free(f);
+    return NULL;
+}
+
+/* Solve in place L U x = b where L has a unit diagonal. */
+void
+sparse_ilu0_solve(const sparse_ilu0 *f, double *x)
+{
+    const sparse_matrix *a = f->lu;
+    const size_t *ptr = a->ptr, *index = a->index, *diag = f->diag;
+    const double *lu = a->data;
+    size_t n = a->size1, i, p;
+    for (i = 0; i < n; i++) {
+        double s = x[i];
+        for (p = ptr[i]; p < diag[i]; p++)
+            s -= lu[p] * x[index[p]];
+        x[i] = s;
+    }
+    for (i = n; i-- > 0; ) {
+        double s = x[i];
+        for (p = diag[i] + 1; p < ptr[i + 1]; p++)
+            s -= lu[p] * x[index[p]];
+        x[i] = s / lu[diag[i]];
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include <stddef.h>
+
+#include "defs.h"
+
+__BEGIN_DECLS
+
+/* Sparse matrices in compressed form. In the CSR format "ptr" has an
+   entry for each row plus one and gives the position in "index" and
+   "data" of the elements of the row, "index" gives their columns. In
+   the CSC format the roles of rows and columns are exchanged. The
+   indexes of each row, or column, are sorted and without
+   duplicates. */
+
+enum sparse_format { SPARSE_CSR = 0, SPARSE_CSC = 1 };
+
+typedef struct {
+    size_t size1, size2;
+    size_t nz;
+    int sptype;
+    size_t *ptr;
+    size_t *index;
+    double *data;
+} sparse_matrix;
+
+/* List of (row, column, value) triplets used to assemble a matrix. */
+typedef struct {
+    size_t size1, size2;
+    size_t nz, size;
+    size_t *rows;
+    size_t *cols;
+    double *data;
+} sparse_coo;
+
+/* Incomplete LU factorization with the pattern of the matrix. "diag"
+   gives the position of the diagonal element of each row. */
+typedef struct {
+    sparse_matrix *lu;
+    size_t *diag;
+} sparse_ilu0;
+
+extern sparse_coo *   sparse_coo_new  (size_t size1, size_t size2);
+extern void           sparse_coo_free (sparse_coo *c);
+extern int            sparse_coo_add  (sparse_coo *c, size_t i, size_t j, double x);
+
+extern sparse_matrix *sparse_from_coo   (const sparse_coo *c, int format);
+extern sparse_matrix *sparse_from_dense (const double *data, size_t tda, size_t size1, size_t size2, int format);
+extern sparse_matrix *sparse_convert    (const sparse_matrix *a, int format);
+extern sparse_matrix *sparse_transpose  (const sparse_matrix *a);
+extern sparse_matrix *sparse_matmul     (const sparse_matrix *a, const sparse_matrix *b);
+extern void           sparse_free       (sparse_matrix *a);
+
+extern double sparse_get      (const sparse_matrix *a, size_t i, size_t j);
+extern void   sparse_to_dense (const sparse_matrix *a, double *data, size_t tda);
+extern void   sparse_diagonal (const sparse_matrix *a, double *d);
+
+/* Compute y <- alpha A x + beta y. The CSR products of big matrices
+   are divided among worker threads, started by the first product that
+   needs them and kept for the next ones. */
+extern void   sparse_matvec (const sparse_matrix *a, double alpha, const double *x, size_t incx,
+                             double beta, double *y, size_t incy);
+extern void   sparse_set_threads (int n);
+
+extern sparse_ilu0 *sparse_ilu0_new   (const sparse_matrix *a);
+extern void         sparse_ilu0_free  (sparse_ilu0 *f);
+extern void         sparse_ilu0_solve (const sparse_ilu0 *f, double *x);
+
+__END_DECLS
+
+#endif
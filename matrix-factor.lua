@@ -0,0 +1,340 @@
+local ffi = require 'ffi'
+local gsl = require 'gsl'
+local gsl_check = require 'gsl-check'
+
+local gsl_matrix = ffi.typeof('gsl_matrix')
+
+local tonumber, setmetatable, error = tonumber, setmetatable, error
+
+-- Factorization objects. A matrix is factorized once and the
+-- factorization, with its permutation and workspace, is kept in the
+-- object so that each following solve costs O(n^2) for each right-hand
+-- side. The methods that return a matrix take an optional last
+-- argument to store the result in an existing matrix.
+
+local function is_real(m)
+    return ffi.istype(gsl_matrix, m)
+end
+
+local function dim(m)
+    return tonumber(m.size1), tonumber(m.size2)
+end
+
+local function column(m, j)
+    if is_real(m) then
+        return gsl.gsl_matrix_column(m, j)
+    else
+        return gsl.gsl_matrix_complex_column(m, j)
+    end
+end
+
+local function new_matrix(real, n1, n2)
+    return real and matrix.alloc(n1, n2) or matrix.calloc(n1, n2)
+end
+
+local function unit_matrix(real, n)
+    local m = real and matrix.new(n, n) or matrix.cnew(n, n)
+    for k = 1, n do m:set(k, k, 1) end
+    return m
+end
+
+-- Check the dimensions of the right-hand side "b" and return the matrix
+-- where the solution is stored, "x" if it is given. The errors are
+-- reported to the caller of the method.
+local function solution_matrix(f, b, x, one_column)
+    local n1, n2 = dim(b)
+    if n1 ~= f.size1 or (one_column and n2 ~= 1) then
+        error('matrix dimensions does not match', 3)
+    end
+    if f.real and not is_real(b) then
+        error('complex right-hand side for a real factorization', 3)
+    end
+    if x then
+        local x1, x2 = dim(x)
+        if x1 ~= f.size2 or x2 ~= n2 then
+            error('matrix dimensions does not match', 3)
+        end
+        if is_real(x) ~= f.real then
+            error('solution matrix of the wrong type', 3)
+        end
+        return x, n2
+    end
+    return new_matrix(f.real, f.size2, n2), n2
+end
+
+-- Solve for each column of "b" with the method "solve_column" of the
+-- factorization. The factorizations of square matrices solve in place
+-- so the columns are copied in "x" first.
+local function solve_columns(f, b, x, n2)
+    if f.in_place then
+        x:set(b)
+        for j = 0, n2 - 1 do
+            local xv = column(x, j)
+            f:solve_column(xv, xv)
+        end
+    else
+        for j = 0, n2 - 1 do
+            local bv, xv = column(b, j), column(x, j)
+            f:solve_column(bv, xv)
+        end
+    end
+    return x
+end
+
+local function factor_solve(f, b, x)
+    local x, n2 = solution_matrix(f, b, x, true)
+    return solve_columns(f, b, x, n2)
+end
+
+local function factor_solve_many(f, b, x)
+    local x, n2 = solution_matrix(f, b, x, false)
+    return solve_columns(f, b, x, n2)
+end
+
+-- Return the inverse by solving for the columns of the unit matrix. For
+-- the least squares factorizations of rectangular matrices this gives
+-- the pseudo-inverse.
+local function factor_inv_by_solve(f, r)
+    local u = unit_matrix(f.real, f.size1)
+    local r, n2 = solution_matrix(f, u, r, false)
+    return solve_columns(f, u, r, n2)
+end
+
+local function check_square(f)
+    if f.size1 ~= f.size2 then
+        error('the matrix is not square', 3)
+    end
+end
+
+local function check_inverse(f, r)
+    if r then
+        local r1, r2 = dim(r)
+        if r1 ~= f.size1 or r2 ~= f.size2 or is_real(r) ~= f.real then
+            error('matrix dimensions does not match', 3)
+        end
+        return r
+    end
+    return new_matrix(f.real, f.size1, f.size2)
+end
+
+-- LU factorization with partial pivoting, P A = L U.
+
+local function lu_solve_column(f, bv, xv)
+    if f.real then
+        gsl_check(gsl.gsl_linalg_LU_svx(f.lu, f.p, xv))
+    else
+        gsl_check(gsl.gsl_linalg_complex_LU_svx(f.lu, f.p, xv))
+    end
+end
+
+local function lu_det(f)
+    if f.real then
+        return gsl.gsl_linalg_LU_det(f.lu, f.signum)
+    else
+        return gsl.gsl_linalg_complex_LU_det(f.lu, f.signum)
+    end
+end
+
+local function lu_inv(f, r)
+    r = check_inverse(f, r)
+    if f.real then
+        gsl_check(gsl.gsl_linalg_LU_invert(f.lu, f.p, r))
+    else
+        gsl_check(gsl.gsl_linalg_complex_LU_invert(f.lu, f.p, r))
+    end
+    return r
+end
+
+local lu_mt = {
+    __index = {
+        solve        = factor_solve,
+        solve_many   = factor_solve_many,
+        solve_column = lu_solve_column,
+        det          = lu_det,
+        inv          = lu_inv,
+    }
+}
+
+local function factor_lu(m)
+    local n1, n2 = dim(m)
+    if n1 ~= n2 then error('the matrix is not square', 2) end
+    local real = is_real(m)
+    local lu = m:copy()
+    local p = ffi.gc(gsl.gsl_permutation_alloc(n1), gsl.gsl_permutation_free)
+    local signum = ffi.new('int[1]')
+    if real then
+        gsl_check(gsl.gsl_linalg_LU_decomp(lu, p, signum))
+    else
+        gsl_check(gsl.gsl_linalg_complex_LU_decomp(lu, p, signum))
+    end
+    local f = {lu = lu, p = p, signum = signum[0], real = real, size1 = n1, size2 = n2, in_place = true}
+    return setmetatable(f, lu_mt)
+end
+
+-- Cholesky factorization of a symmetric, or hermitian, positive
+-- definite matrix, A = L L^H.
+
+local function cholesky_solve_column(f, bv, xv)
+    if f.real then
+        gsl_check(gsl.gsl_linalg_cholesky_svx(f.chol, xv))
+    else
+        gsl_check(gsl.gsl_linalg_complex_cholesky_svx(f.chol, xv))
+    end
+end
+
+-- The diagonal of L is real and positive so the determinant is the
+-- square of the product of its elements.
+local function cholesky_det(f)
+    local chol, n = f.chol, f.size1
+    local tda, data = tonumber(chol.tda), chol.data
+    local d = 1
+    if f.real then
+        for k = 0, n - 1 do d = d * data[k * (tda + 1)] end
+    else
+        for k = 0, n - 1 do d = d * data[2 * k * (tda + 1)] end
+    end
+    return d * d
+end
+
+local function cholesky_inv(f, r)
+    if not f.real then return factor_inv_by_solve(f, r) end
+    r = check_inverse(f, r)
+    r:set(f.chol)
+    gsl_check(gsl.gsl_linalg_cholesky_invert(r))
+    return r
+end
+
+local cholesky_mt = {
+    __index = {
+        solve        = factor_solve,
+        solve_many   = factor_solve_many,
+        solve_column = cholesky_solve_column,
+        det          = cholesky_det,
+        inv          = cholesky_inv,
+    }
+}
+
+local function factor_cholesky(m)
+    local n1, n2 = dim(m)
+    if n1 ~= n2 then error('the matrix is not square', 2) end
+    local real = is_real(m)
+    local chol = m:copy()
+    if real then
+        gsl_check(gsl.gsl_linalg_cholesky_decomp(chol))
+    else
+        gsl_check(gsl.gsl_linalg_complex_cholesky_decomp(chol))
+    end
+    local f = {chol = chol, real = real, size1 = n1, size2 = n2, in_place = true}
+    return setmetatable(f, cholesky_mt)
+end
+
+-- QR factorization, A = Q R, of a real matrix with at least as many
+-- rows as columns. For rectangular matrices the solution is given in
+-- the least squares sense.
+
+local function qr_solve_column(f, bv, xv)
+    if f.in_place then
+        gsl_check(gsl.gsl_linalg_QR_svx(f.qr, f.tau, xv))
+    else
+        gsl_check(gsl.gsl_linalg_QR_lssolve(f.qr, f.tau, bv, xv, f.residual))
+    end
+end
+
+-- Each Householder reflection of Q with a non-zero coefficient has
+-- determinant -1.
+local function qr_det(f)
+    check_square(f)
+    local qr, n = f.qr, f.size1
+    local tda, data = tonumber(qr.tda), qr.data
+    local t = f.t.data
+    local d = 1
+    for k = 0, n - 1 do
+        d = d * data[k * (tda + 1)]
+        if t[k] ~= 0 then d = -d end
+    end
+    return d
+end
+
+local qr_mt = {
+    __index = {
+        solve        = factor_solve,
+        solve_many   = factor_solve_many,
+        solve_column = qr_solve_column,
+        det          = qr_det,
+        inv          = factor_inv_by_solve,
+    }
+}
+
+local function factor_qr(m)
+    if not is_real(m) then error('expected real matrix', 2) end
+    local n1, n2 = dim(m)
+    if n1 < n2 then error('the matrix has more columns than rows', 2) end
+    local qr = m:copy()
+    local t = matrix.alloc(n2, 1)
+    local tau = gsl.gsl_matrix_column(t, 0)
+    gsl_check(gsl.gsl_linalg_QR_decomp(qr, tau))
+    local f = {qr = qr, t = t, tau = tau, real = true, size1 = n1, size2 = n2, in_place = (n1 == n2)}
+    if n1 ~= n2 then
+        f.r = matrix.alloc(n1, 1)
+        f.residual = gsl.gsl_matrix_column(f.r, 0)
+    end
+    return setmetatable(f, qr_mt)
+end
+
+-- Singular value decomposition, A = U S V^T, of a real matrix with at
+-- least as many rows as columns. The singular values equal to zero are
+-- discarded by the solve methods so that the solution is given in the
+-- least squares sense.
+
+local function svd_solve_column(f, bv, xv)
+    gsl_check(gsl.gsl_linalg_SV_solve(f.u, f.v, f.sv, bv, xv))
+end
+
+-- The sign of the determinant is given by the ones of U and V. They are
+-- computed when first needed.
+local function svd_det(f)
+    check_square(f)
+    if not f.sign then
+        local du, dv = factor_lu(f.u):det(), factor_lu(f.v):det()
+        f.sign = (du * dv < 0 and -1 or 1)
+    end
+    local s, d = f.s.data, f.sign
+    for k = 0, f.size2 - 1 do d = d * s[k] end
+    return d
+end
+
+-- Return the singular values as a column matrix.
+local function svd_values(f)
+    return f.s:copy()
+end
+
+local svd_mt = {
+    __index = {
+        solve        = factor_solve,
+        solve_many   = factor_solve_many,
+        solve_column = svd_solve_column,
+        det          = svd_det,
+        inv          = factor_inv_by_solve,
+        values       = svd_values,
+    }
+}
+
+local function factor_svd(m)
+    if not is_real(m) then error('expected real matrix', 2) end
+    local n1, n2 = dim(m)
+    if n1 < n2 then error('the matrix has more columns than rows', 2) end
+    local u = m:copy()
+    local v = matrix.alloc(n2, n2)
+    local s, w = matrix.alloc(n2, 1), matrix.alloc(n2, 1)
+    local sv, wv = gsl.gsl_matrix_column(s, 0), gsl.gsl_matrix_column(w, 0)
+    gsl_check(gsl.gsl_linalg_SV_decomp(u, v, sv, wv))
+    local f = {u = u, v = v, s = s, sv = sv, real = true, size1 = n1, size2 = n2, in_place = false}
+    return setmetatable(f, svd_mt)
+end
+
+return {
+    lu       = factor_lu,
+    cholesky = factor_cholesky,
+    qr       = factor_qr,
+    svd      = factor_svd,
+}
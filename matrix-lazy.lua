@@ -0,0 +1,508 @@
+local ffi = require 'ffi'
+local check = require 'check'
+
+local is_integer, is_real = check.is_integer, check.is_real
+local concat, format = table.concat, string.format
+local tonumber, type, setmetatable, getmetatable = tonumber, type, setmetatable, getmetatable
+
+local gsl_matrix         = ffi.typeof('gsl_matrix')
+local gsl_matrix_complex = ffi.typeof('gsl_matrix_complex')
+local gsl_matrix_float   = ffi.typeof('gsl_matrix_float')
+local gsl_complex        = ffi.typeof('complex')
+
+-- A lazy expression is a tree of nodes. Each leaf refers to a matrix
+-- and each inner node is an element-wise operation whose operands are
+-- either other nodes or scalars. The whole tree is evaluated with a
+-- single loop over the elements, without any temporary matrix. The
+-- loop is generated as Lua code and compiled once for each shape of the
+-- tree so that it can be traced by the JIT compiler. The ordinary
+-- element-wise operators use the same loops for a single operation.
+-- The result of an expression is a single precision matrix when all
+-- its matrices are single precision.
+
+local expr_mt = {}
+
+local function is_expr(x)
+    return type(x) == 'table' and getmetatable(x) == expr_mt
+end
+
+-- Return the code of the matrix, "M", "F" or "Z" for the real, single
+-- precision and complex matrices.
+local function matrix_code(m)
+    if ffi.istype(gsl_matrix, m) then return 'M'
+    elseif ffi.istype(gsl_matrix_float, m) then return 'F'
+    elseif ffi.istype(gsl_matrix_complex, m) then return 'Z' end
+end
+
+local function is_matrix(x)
+    return matrix_code(x) ~= nil
+end
+
+local function new_result(code, n1, n2)
+    if code == 'M' then
+        return matrix.alloc(n1, n2)
+    elseif code == 'F' then
+        return matrix.falloc(n1, n2)
+    else
+        return matrix.calloc(n1, n2)
+    end
+end
+
+local function is_scalar(x)
+    return is_real(x) or ffi.istype(gsl_complex, x)
+end
+
+local function leaf_new(m)
+    local n1, n2 = tonumber(m.size1), tonumber(m.size2)
+    local code = matrix_code(m)
+    local real, float = (code ~= 'Z'), (code == 'F')
+    return setmetatable({op = false, value = m, n1 = n1, n2 = n2, real = real, float = float}, expr_mt)
+end
+
+local function as_expr(x)
+    if is_expr(x) then return x end
+    if is_matrix(x) then return leaf_new(x) end
+end
+
+local function operand_real(x)
+    if is_expr(x) then return x.real end
+    return is_real(x)
+end
+
+local function operand_float(x)
+    return not is_expr(x) or x.float
+end
+
+-- The operand "b" is false for the unary minus.
+local function node_new(op, a, b)
+    a, b = as_expr(a) or a, as_expr(b) or b
+    local ea, eb = is_expr(a), is_expr(b)
+    if ea and eb and (a.n1 ~= b.n1 or a.n2 ~= b.n2) then
+        error('matrix dimensions does not match', 3)
+    end
+    local e = ea and a or b
+    local real = operand_real(a) and (op == 'unm' or operand_real(b))
+    local float = real and operand_float(a) and (op == 'unm' or operand_float(b))
+    return setmetatable({op = op, a = a, b = b, value = false, n1 = e.n1, n2 = e.n2, real = real, float = float}, expr_mt)
+end
+
+-- Code generation. The function "emit" adds to the loop body the
+-- statements that compute the node and returns the names of the
+-- variables with its real and imaginary parts. The imaginary part is
+-- nil when it is known to be zero.
+
+local function emit_add(body, k, ar, ai, br, bi)
+    body[#body+1] = format('local x%d = %s + %s', k, ar, br)
+    if ai or bi then
+        local im = (ai and bi) and format('%s + %s', ai, bi) or (ai or bi)
+        body[#body+1] = format('local y%d = %s', k, im)
+        return 'x' .. k, 'y' .. k
+    end
+    return 'x' .. k
+end
+
+local function emit_sub(body, k, ar, ai, br, bi)
+    body[#body+1] = format('local x%d = %s - %s', k, ar, br)
+    if ai or bi then
+        local im = (ai and bi) and format('%s - %s', ai, bi) or (ai or ('-' .. bi))
+        body[#body+1] = format('local y%d = %s', k, im)
+        return 'x' .. k, 'y' .. k
+    end
+    return 'x' .. k
+end
+
+local function emit_mul(body, k, ar, ai, br, bi)
+    if ai and bi then
+        body[#body+1] = format('local x%d = %s*%s - %s*%s', k, ar, br, ai, bi)
+        body[#body+1] = format('local y%d = %s*%s + %s*%s', k, ar, bi, ai, br)
+    elseif ai or bi then
+        body[#body+1] = format('local x%d = %s*%s', k, ar, br)
+        body[#body+1] = format('local y%d = %s*%s', k, ai and ai or ar, ai and br or bi)
+    else
+        body[#body+1] = format('local x%d = %s*%s', k, ar, br)
+        return 'x' .. k
+    end
+    return 'x' .. k, 'y' .. k
+end
+
+local function emit_div(body, k, ar, ai, br, bi)
+    if bi then
+        body[#body+1] = format('local d%d = %s*%s + %s*%s', k, br, br, bi, bi)
+        body[#body+1] = format('local x%d = (%s*%s + %s*%s) / d%d', k, ar, br, ai or 0, bi, k)
+        body[#body+1] = format('local y%d = (%s*%s - %s*%s) / d%d', k, ai or 0, br, ar, bi, k)
+    else
+        body[#body+1] = format('local x%d = %s / %s', k, ar, br)
+        if not ai then return 'x' .. k end
+        body[#body+1] = format('local y%d = %s / %s', k, ai, br)
+    end
+    return 'x' .. k, 'y' .. k
+end
+
+local emit_op = {add = emit_add, sub = emit_sub, mul = emit_mul, div = emit_div}
+
+-- Walk the tree in the order of evaluation, append to "inputs" the
+-- matrices and scalars it refers to and to "key" a description of the
+-- shape of the tree. Two trees with the same key share the same loop.
+-- In the key the real and complex scalars are written "R" and "C" and
+-- the matrices with their codes.
+local function collect(e, inputs, key)
+    if not is_expr(e) then
+        inputs[#inputs+1] = e
+        key[#key+1] = is_real(e) and 'R' or 'C'
+    elseif e.value then
+        inputs[#inputs+1] = e.value
+        key[#key+1] = matrix_code(e.value)
+    else
+        key[#key+1] = e.op .. '('
+        collect(e.a, inputs, key)
+        if e.op ~= 'unm' then
+            key[#key+1] = ','
+            collect(e.b, inputs, key)
+        end
+        key[#key+1] = ')'
+    end
+end
+
+local function gen_kernel(key, out)
+    local args, setup, rows, body = {}, {}, {}, {}
+    local pos, nvar = 1, 0
+
+    local function emit()
+        local c = key:sub(pos, pos)
+        if c == 'R' or c == 'C' or c == 'M' or c == 'F' or c == 'Z' then
+            pos = pos + 1
+            nvar = nvar + 1
+            local k = nvar
+            if c == 'R' then
+                args[#args+1] = 's' .. k
+                return 's' .. k
+            elseif c == 'C' then
+                args[#args+1] = 's' .. k
+                setup[#setup+1] = format('local sr%d, si%d = s%d[0], s%d[1]', k, k, k, k)
+                return 'sr' .. k, 'si' .. k
+            end
+            args[#args+1] = 'm' .. k
+            setup[#setup+1] = format('local a%d, t%d = m%d.data, tonumber(m%d.tda)', k, k, k, k)
+            rows[#rows+1] = format('local o%d = i*t%d', k, k)
+            if c == 'M' or c == 'F' then
+                body[#body+1] = format('local x%d = a%d[o%d+j]', k, k, k)
+                return 'x' .. k
+            else
+                body[#body+1] = format('local x%d, y%d = a%d[2*(o%d+j)], a%d[2*(o%d+j)+1]', k, k, k, k, k, k)
+                return 'x' .. k, 'y' .. k
+            end
+        end
+        local op = key:match('^(%a+)%(', pos)
+        pos = pos + #op + 1
+        local ar, ai = emit()
+        local br, bi
+        if op ~= 'unm' then
+            pos = pos + 1
+            br, bi = emit()
+        end
+        pos = pos + 1
+        nvar = nvar + 1
+        local k = nvar
+        if op == 'unm' then
+            body[#body+1] = format('local x%d = -%s', k, ar)
+            if not ai then return 'x' .. k end
+            body[#body+1] = format('local y%d = -%s', k, ai)
+            return 'x' .. k, 'y' .. k
+        end
+        return emit_op[op](body, k, ar, ai, br, bi)
+    end
+
+    local xr, xi = emit()
+    if out ~= 'Z' then
+        body[#body+1] = format('rd[ro+j] = %s', xr)
+    else
+        body[#body+1] = format('rd[2*(ro+j)], rd[2*(ro+j)+1] = %s, %s', xr, xi or 0)
+    end
+
+    local src = {
+        'local tonumber = tonumber',
+        format('return function(n1, n2, r, %s)', concat(args, ', ')),
+        'local rd, rt = r.data, tonumber(r.tda)',
+        concat(setup, '\n'),
+        'for i = 0, n1-1 do',
+        'local ro = i*rt',
+        concat(rows, '\n'),
+        'for j = 0, n2-1 do',
+        concat(body, '\n'),
+        'end',
+        'end',
+        'end',
+    }
+    return assert(loadstring(concat(src, '\n'), '=(matrix expression)'))()
+end
+
+local kernel_cache = {}
+
+-- The code "out" of the result matrix is part of the key since the
+-- loops for different types of data are traced separately.
+local function kernel_get(key, out)
+    key = key .. '=' .. out
+    local kernel = kernel_cache[key]
+    if not kernel then
+        kernel = gen_kernel(key, out)
+        kernel_cache[key] = kernel
+    end
+    return kernel
+end
+
+local function is_contiguous(m)
+    return m.tda == m.size2
+end
+
+-- When all the matrices are contiguous the kernel is called as if
+-- they were a single row so that the elements are computed with a
+-- flat loop. Otherwise the loop goes row by row using "tda".
+local function kernel_run(kernel, n1, n2, r, flat, ...)
+    if flat then
+        kernel(1, n1 * n2, r, ...)
+    else
+        kernel(n1, n2, r, ...)
+    end
+end
+
+local function eval_into(r, e)
+    local inputs, key = {}, {}
+    collect(e, inputs, key)
+    local kernel = kernel_get(concat(key), matrix_code(r))
+    local flat = is_contiguous(r)
+    for k = 1, #inputs do
+        local x = inputs[k]
+        if flat and not is_scalar(x) then flat = is_contiguous(x) end
+    end
+    kernel_run(kernel, e.n1, e.n2, r, flat, unpack(inputs))
+end
+
+local function operand_code(x)
+    if is_real(x) then return 'R'
+    elseif ffi.istype(gsl_complex, x) then return 'C'
+    else return matrix_code(x) end
+end
+
+-- Return a function that gives the kernel for the code of the result and
+-- the codes of up to three operands, an empty string for the missing
+-- ones. The kernels are cached in nested tables since the
+-- concatenation of strings to build the key is not compiled.
+local function kernel_family(make_key)
+    local cache = {}
+    return function(out, c1, c2, c3)
+        local t = cache[out]
+        if not t then t = {}; cache[out] = t end
+        local t1 = t[c1]
+        if not t1 then t1 = {}; t[c1] = t1 end
+        local t2 = t1[c2]
+        if not t2 then t2 = {}; t1[c2] = t2 end
+        local kernel = t2[c3]
+        if not kernel then
+            kernel = kernel_get(make_key(c1, c2, c3), out)
+            t2[c3] = kernel
+        end
+        return kernel
+    end
+end
+
+local op_kernels = {
+    unm  = kernel_family(function(ca) return 'unm(' .. ca .. ')' end),
+    copy = kernel_family(function(ca) return ca end),
+    axpy = kernel_family(function(ca, cx, cy) return 'add(mul(' .. ca .. ',' .. cx .. '),' .. cy .. ')' end),
+}
+
+for _, op in ipairs {'add', 'sub', 'mul', 'div'} do
+    op_kernels[op] = kernel_family(function(ca, cb) return op .. '(' .. ca .. ',' .. cb .. ')' end)
+end
+
+local function is_matrix_code(c)
+    return c == 'M' or c == 'F' or c == 'Z'
+end
+
+local function is_complex_code(c)
+    return c == 'C' or c == 'Z'
+end
+
+-- Return true if the operand "x" is a scalar or a matrix with the
+-- dimensions of "r".
+local function operand_fits(r, x, c)
+    return not is_matrix_code(c) or (x.size1 == r.size1 and x.size2 == r.size2)
+end
+
+-- Return true if the operand "x" can be read with a flat loop.
+local function operand_flat(x, c)
+    return not is_matrix_code(c) or is_contiguous(x)
+end
+
+-- Store in "r", with the code "out", the result of the element-wise
+-- operation "op" on the operands, with the codes "ca", "cb" and "cc". The
+-- matrix "r" can be
+-- one of the operands. Return an error message if the operands are
+-- not compatible with "r" so that the callers can raise the error at
+-- the right level.
+local function run_into(r, out, op, a, ca, b, cb, c, cc)
+    if not (operand_fits(r, a, ca) and operand_fits(r, b, cb) and operand_fits(r, c, cc)) then
+        return 'matrix dimensions does not match'
+    end
+    if out ~= 'Z' and (is_complex_code(ca) or is_complex_code(cb) or is_complex_code(cc)) then
+        return 'cannot assign a complex expression to a real matrix'
+    end
+    local kernel = op_kernels[op](out, ca, cb, cc)
+    local n1, n2 = tonumber(r.size1), tonumber(r.size2)
+    if operand_flat(a, ca) and operand_flat(b, cb) and operand_flat(c, cc) and is_contiguous(r) then
+        kernel(1, n1 * n2, r, a, b, c)
+    else
+        kernel(n1, n2, r, a, b, c)
+    end
+end
+
+-- Compute right away the element-wise operation "op" between "a" and
+-- "b", at least one of them being a matrix, and return the result in a
+-- new matrix. For the unary minus "b" is not used. The result is a
+-- single precision matrix if the operands are single precision matrices
+-- and real scalars.
+local function elementwise(op, a, b)
+    local ca = operand_code(a)
+    local cb = (op ~= 'unm' and operand_code(b) or '')
+    local m = is_matrix_code(ca) and a or b
+    local out = 'Z'
+    if not (is_complex_code(ca) or is_complex_code(cb)) then
+        out = (ca == 'M' or cb == 'M') and 'M' or 'F'
+    end
+    local n1, n2 = tonumber(m.size1), tonumber(m.size2)
+    local r = new_result(out, n1, n2)
+    local err = run_into(r, out, op, a, ca, b, cb, nil, '')
+    if err then error(err, 2) end
+    return r
+end
+
+-- Store in the existing matrix "r" the result of the element-wise
+-- operation "op" between "a" and "b". The operation "copy" stores the
+-- value of "a".
+local function elementwise_into(r, op, a, b)
+    local ca, cb = operand_code(a), ''
+    if op ~= 'unm' and op ~= 'copy' then cb = operand_code(b) end
+    if not (ca and cb) then error('expected matrix or scalar', 2) end
+    local out = matrix_code(r)
+    if not out then error('expected matrix', 2) end
+    local err = run_into(r, out, op, a, ca, b, cb, nil, '')
+    if err then error(err, 2) end
+end
+
+-- Compute y <- alpha*x + y.
+local function axpy(alpha, x, y)
+    local ca, cx, cy = operand_code(alpha), operand_code(x), operand_code(y)
+    if not (ca and cx) then error('expected matrix or scalar', 2) end
+    if not is_matrix_code(cy) then error('expected matrix', 2) end
+    local err = run_into(y, cy, 'axpy', alpha, ca, x, cx, y, cy)
+    if err then error(err, 2) end
+end
+
+-- Return the matrix given by the expression. The result is stored in
+-- the node so that the expression is evaluated only once and the
+-- operands can be collected.
+local function expr_eval(e)
+    if not is_expr(e) then return e end
+    if not e.value then
+        local code = e.real and (e.float and 'F' or 'M') or 'Z'
+        local r = new_result(code, e.n1, e.n2)
+        eval_into(r, e)
+        e.value, e.a, e.b = r, false, false
+    end
+    return e.value
+end
+
+-- Write the value of the expression in the existing matrix "r". The
+-- operands can refer to "r" itself since each element depends only on
+-- the elements with the same indexes.
+local function expr_assign(r, e)
+    local n1, n2 = tonumber(r.size1), tonumber(r.size2)
+    if n1 ~= e.n1 or n2 ~= e.n2 then
+        error('matrix dimensions does not match', 2)
+    end
+    local out = matrix_code(r)
+    if not out then error('expected matrix', 2) end
+    if out ~= 'Z' and not e.real then
+        error('cannot assign a complex expression to a real matrix', 2)
+    end
+    eval_into(r, e)
+end
+
+local function expr_binop(op, element_wise, no_inverse)
+    return function(a, b)
+        local ma, mb = not is_scalar(a), not is_scalar(b)
+        if mb and no_inverse then
+            error('invalid operation on matrix', 2)
+        end
+        if ma and mb and not element_wise then
+            -- matrix product is not element-wise, it is computed right
+            -- away with BLAS on the evaluated operands.
+            return leaf_new(expr_eval(a) * expr_eval(b))
+        end
+        return node_new(op, a, b)
+    end
+end
+
+local function expr_unm(a)
+    return node_new('unm', a, false)
+end
+
+local function expr_dim(e)
+    return e.n1, e.n2
+end
+
+local expr_methods = {
+    eval = expr_eval,
+    dim  = expr_dim,
+}
+
+-- The other matrix methods are forwarded to the evaluated matrix.
+local forward_names = {'get', 'set', 'copy', 'norm', 'norm2', 'row', 'col', 'slice', 'sort', 'zero', 'show'}
+for _, name in ipairs(forward_names) do
+    expr_methods[name] = function(e, ...)
+        local m = expr_eval(e)
+        return m[name](m, ...)
+    end
+end
+
+expr_mt.__add = expr_binop('add', true)
+expr_mt.__sub = expr_binop('sub', true)
+expr_mt.__mul = expr_binop('mul', false)
+expr_mt.__div = expr_binop('div', true, true)
+expr_mt.__unm = expr_unm
+expr_mt.__pow = function(a, n) return expr_eval(a)^n end
+
+expr_mt.__index = function(e, k)
+    if is_integer(k) then
+        return expr_eval(e)[k]
+    end
+    return expr_methods[k]
+end
+
+expr_mt.__newindex = function(e, k, v)
+    if is_integer(k) then
+        expr_eval(e)[k] = v
+    else
+        error 'cannot set a matrix field'
+    end
+end
+
+local function lazy_new(m)
+    if is_expr(m) then return m end
+    if not is_matrix(m) then error('expected matrix', 2) end
+    return leaf_new(m)
+end
+
+return {
+    new    = lazy_new,
+    elementwise = elementwise,
+    elementwise_into = elementwise_into,
+    axpy   = axpy,
+    eval   = expr_eval,
+    assign = expr_assign,
+    is_expr = is_expr,
+    add    = expr_mt.__add,
+    sub    = expr_mt.__sub,
+    mul    = expr_mt.__mul,
+    div    = expr_mt.__div,
+}
@@ -1,5 +1,6 @@
 local bit = require 'bit'
 local gsl = require 'gsl'
+local blas = require 'blas'
 local check = require 'check'
 
 local band, rshift = bit.band, bit.rshift
@@ -18,7 +19,7 @@ local function power_raw(r, m, n, e)
                 -- The content of m2 is not needed here.
                 -- We compute r <- r * m using m2 as a temporary store
                 gsl.gsl_matrix_memcpy(m2, r)
-                gsl.gsl_blas_dgemm(NT, NT, 1, m, m2, 0, r)
+                blas.dgemm(NT, NT, 1, m, m2, 0, r)
             else
                 gsl.gsl_matrix_memcpy(r, m)
             end
@@ -28,7 +29,7 @@ local function power_raw(r, m, n, e)
 
         if e > 0 then
             -- compute m2 <- m * m
-            gsl.gsl_blas_dgemm(NT, NT, 1, m, m, 0, m2)
+            blas.dgemm(NT, NT, 1, m, m, 0, m2)
             m, m2 = m2, m
         end
     end
@@ -45,7 +46,7 @@ local function power_complex_raw(r, m, n, e)
                 -- The content of m2 is not needed here.
                 -- We compute r <- r * m using m2 as a temporary store
                 gsl.gsl_matrix_complex_memcpy(m2, r)
-                gsl.gsl_blas_zgemm(NT, NT, 1, m, m2, 0, r)
+                blas.zgemm(NT, NT, 1, m, m2, 0, r)
             else
                 gsl.gsl_matrix_complex_memcpy(r, m)
             end
@@ -55,7 +56,7 @@ local function power_complex_raw(r, m, n, e)
 
         if e > 0 then
             -- compute m2 <- m * m
-            gsl.gsl_blas_zgemm(NT, NT, 1, m, m, 0, m2)
+            blas.zgemm(NT, NT, 1, m, m, 0, m2)
             m, m2 = m2, m
         end
     end
@@ -1,5 +1,6 @@
 local ffi = require 'ffi'
 local gsl = require 'gsl'
+local blas = require 'blas'
 local algo = require 'algorithm'
 
 local sqrt, abs, floor = math.sqrt, math.abs, math.floor
@@ -8,11 +9,50 @@ local format = string.format
 local check = require 'check'
 local is_integer, is_real = check.is_integer, check.is_real
 
+ffi.cdef[[
+   struct matrix_pool_stats {
+      double requests;
+      double hits;
+      double bytes_in_use;
+      double peak_bytes;
+      double cached_bytes;
+      double cached_limit;
+   };
+
+   void * matrix_pool_alloc (size_t size);
+   void   matrix_pool_free  (void *p);
+   void   matrix_pool_trim  (void);
+   void   matrix_pool_set_limit (size_t bytes);
+   void   matrix_pool_get_stats (struct matrix_pool_stats *stats);
+   void   matrix_pool_reset_peak (void);
+
+   void   matrix_sort_strided    (double *data, size_t stride, size_t n);
+   int    matrix_argsort_strided (const double *data, size_t stride, size_t n, size_t *perm);
+   double matrix_nth_element (const double *data, size_t tda, size_t n1, size_t n2, size_t k);
+   double matrix_quantile    (const double *data, size_t tda, size_t n1, size_t n2, double p);
+
+   typedef struct {
+      void *map;
+      size_t length;
+      double *data;
+      size_t size1, size2;
+   } matrix_mmap;
+
+   matrix_mmap *matrix_mmap_open   (const char *filename, int mode, size_t size1, size_t size2, int *error);
+   void         matrix_mmap_close  (matrix_mmap *m);
+   int          matrix_mmap_advise (void *data, size_t length, int advice);
+
+   char *strerror(int errnum);
+]]
+
 local gsl_matrix         = ffi.typeof('gsl_matrix')
 local gsl_matrix_complex = ffi.typeof('gsl_matrix_complex')
+local gsl_matrix_float   = ffi.typeof('gsl_matrix_float')
 local gsl_complex        = ffi.typeof('complex')
 
 local gsl_check = require 'gsl-check'
+local matrix_lazy = require 'matrix-lazy'
+local matrix_factor = require 'matrix-factor'
 local tonumber = tonumber
 
 local function check_real(x)
@@ -24,6 +64,7 @@ local function get_typeid(a)
    if     is_real(a)                          then return true,  true
    elseif ffi.istype(gsl_complex, a)         then return false, true
    elseif ffi.istype(gsl_matrix, a)          then return true,  false
+   elseif ffi.istype(gsl_matrix_float, a)    then return true,  false
    elseif ffi.istype(gsl_matrix_complex, a)  then return false, false end
 end
 
@@ -49,36 +90,143 @@ local function matrix_len(m)
    return tonumber(m.size1)
 end
 
-local function block_alloc(n)
-   local b = ffi.cast('gsl_block *', ffi.C.malloc(ffi.sizeof('gsl_block')))
-   local data = ffi.C.malloc(n * ffi.sizeof('double'))
-   b.size, b.data, b.ref_count = n, data, 1
+-- The block header and the data are allocated together from the
+-- matrix pool. The data starts after the header at an offset that keeps
+-- the alignment of the pool buffers.
+local BLOCK_HEADER_SIZE = 32
+
+local function block_new(n, ctype, elem_size, data_ctype)
+   local p = ffi.C.matrix_pool_alloc(BLOCK_HEADER_SIZE + n * elem_size)
+   if p == nil then error('not enough memory', 3) end
+   local b = ffi.cast(ctype, p)
+   b.size, b.ref_count = n, 1
+   b.data = ffi.cast(data_ctype, ffi.cast('char *', p) + BLOCK_HEADER_SIZE)
    return b
 end
 
+local function block_alloc(n)
+   return block_new(n, 'gsl_block *', ffi.sizeof('double'), 'double *')
+end
+
 local function block_calloc(n)
-   local b = ffi.cast('gsl_block_complex *', ffi.C.malloc(ffi.sizeof('gsl_block_complex')))
-   local data = ffi.C.malloc(2 * n * ffi.sizeof('double'))
-   b.size, b.data, b.ref_count = n, data, 1
-   return b
+   return block_new(n, 'gsl_block_complex *', 2 * ffi.sizeof('double'), 'double *')
+end
+
+local function block_falloc(n)
+   return block_new(n, 'gsl_block_float *', ffi.sizeof('float'), 'float *')
+end
+
+-- The blocks of the memory mapped matrices are recorded, with their
+-- mapping, in "mapped_blocks" with the address of the block as a key.
+-- The file is unmapped when the block is released.
+local mapped_blocks, mapped_count = {}, 0
+
+local function block_key(b)
+   return tonumber(ffi.cast('intptr_t', b))
+end
+
+local function block_unref(b)
+   b.ref_count = b.ref_count - 1
+   if b.ref_count == 0 then
+      if mapped_count > 0 then
+         local key = block_key(b)
+         local mm = mapped_blocks[key]
+         if mm then
+            ffi.C.matrix_mmap_close(mm)
+            mapped_blocks[key], mapped_count = nil, mapped_count - 1
+         end
+      end
+      ffi.C.matrix_pool_free(b)
+   end
 end
 
 local function matrix_alloc(n1, n2)
    local b = block_alloc(n1 * n2)
-   local m = gsl_matrix(n1, n2, n2, b.data, b, 1)
-   return m
+   return gsl_matrix(n1, n2, n2, b.data, b, 1)
 end
 
 local function matrix_calloc(n1, n2)
    local b = block_calloc(n1 * n2)
-   local m = gsl_matrix_complex(n1, n2, n2, b.data, b, 1)
-   return m
+   return gsl_matrix_complex(n1, n2, n2, b.data, b, 1)
+end
+
+-- Single precision matrices use half of the memory of the real
+-- matrices. They support the element-wise operations, the matrix
+-- product with BLAS and the conversion to and from real matrices.
+local function matrix_falloc(n1, n2)
+   local b = block_falloc(n1 * n2)
+   return gsl_matrix_float(n1, n2, n2, b.data, b, 1)
+end
+
+local mmap_modes = {r = 0, c = 1, w = 2, ['w+'] = 3}
+
+local mmap_errors = {
+   [2] = 'not a matrix file or wrong byte order',
+   [3] = 'the matrix dimensions do not match the file',
+   [4] = 'memory mapped files are not supported',
+}
+
+local mmap_error = ffi.new('int[1]')
+
+-- Return a matrix whose elements are stored in a memory mapped file.
+-- The mode is 'r' to read the file, the elements should not be written,
+-- 'c' for a copy-on-write matrix whose changes are not saved, 'w' to
+-- write the changes to the file and 'w+' to create a new file. The
+-- views of the matrix share its block and the file is unmapped when all
+-- of them are collected.
+local function matrix_mmap(path, n1, n2, mode)
+   if type(n1) == 'string' then n1, n2, mode = nil, nil, n1 end
+   local code = mmap_modes[mode or 'r']
+   if not code then
+      error("invalid mode, expecting 'r', 'c', 'w' or 'w+'", 2)
+   end
+   if (n1 or n2 or code == 3) and not (is_integer(n1) and is_integer(n2) and n1 > 0 and n2 > 0) then
+      error('invalid matrix dimensions', 2)
+   end
+   local mm = ffi.C.matrix_mmap_open(path, code, n1 or 0, n2 or 0, mmap_error)
+   if mm == nil then
+      local msg = mmap_errors[mmap_error[0]] or ffi.string(ffi.C.strerror(ffi.errno()))
+      error(format('cannot map "%s": %s', path, msg), 2)
+   end
+   local p = ffi.C.matrix_pool_alloc(BLOCK_HEADER_SIZE)
+   if p == nil then
+      ffi.C.matrix_mmap_close(mm)
+      error('not enough memory', 2)
+   end
+   local b = ffi.cast('gsl_block *', p)
+   b.size, b.ref_count, b.data = mm.size1 * mm.size2, 1, mm.data
+   mapped_blocks[block_key(b)], mapped_count = mm, mapped_count + 1
+   return gsl_matrix(mm.size1, mm.size2, mm.size2, mm.data, b, 1)
+end
+
+local mmap_advices = {normal = 0, sequential = 1, random = 2, willneed = 3, dontneed = 4}
+
+-- Give to the system a hint about the access to the elements of the
+-- matrix, or of a view, that can be a mapped matrix.
+local function matrix_madvise(m, advice)
+   local code = mmap_advices[advice]
+   if not code then error('invalid advice: ' .. tostring(advice), 2) end
+   local n1, n2 = matrix_dim(m)
+   if n1 > 0 and n2 > 0 then
+      local size = ffi.sizeof('double')
+      if ffi.istype(gsl_matrix_complex, m) then size = 2 * size end
+      if ffi.istype(gsl_matrix_float, m) then size = ffi.sizeof('float') end
+      local length = ((n1 - 1) * tonumber(m.tda) + n2) * size
+      ffi.C.matrix_mmap_advise(m.data, length, code)
+   end
 end
 
 local function matrix_zero(m)
    gsl.gsl_matrix_set_zero(m)
 end
 
+local function matrix_float_zero(m)
+   local n1, n2 = tonumber(m.size1), tonumber(m.size2)
+   for i = 0, n1 - 1 do
+      ffi.fill(m.data + i * m.tda, n2 * ffi.sizeof('float'))
+   end
+end
+
 local function matrix_complex_zero(m)
    gsl.gsl_matrix_complex_set_zero(m)
 end
@@ -115,15 +263,67 @@ local function matrix_cnew(n1, n2, f)
    return m
 end
 
+local function matrix_fnew(n1, n2, f)
+   local m = matrix_falloc(n1, n2)
+   if f then
+      for i=0, n1-1 do
+         for j=0, n2-1 do
+            local x = check_real(f(i+1, j+1))
+            m.data[i*n2+j] = x
+         end
+      end
+   else
+      matrix_float_zero(m)
+   end
+   return m
+end
+
 local function matrix_free(m)
-   if m.owner then
-      local b = m.block
-      b.ref_count = b.ref_count - 1
-      if b.ref_count == 0 then
-         ffi.C.free(b.data)
-         ffi.C.free(b)
+   if m.owner ~= 0 then block_unref(m.block) end
+end
+
+-- Give back the storage of the matrix to the pool without waiting for
+-- the garbage collector. The matrix becomes empty, so that any access
+-- to its elements raises an error. The views of the matrix keep the
+-- storage alive.
+local function matrix_release(m)
+   if m.owner ~= 0 then block_unref(m.block) end
+   m.size1, m.size2, m.tda, m.data, m.block, m.owner = 0, 0, 0, nil, nil, 0
+end
+
+-- Call "f" with a function "tmp" followed by the given arguments. The
+-- matrices given to "tmp", that returns them, are released when "f"
+-- returns or raises an error. The other matrices are left to the
+-- garbage collector.
+local function matrix_scope(f, ...)
+   local registered = {}
+   local function tmp(...)
+      for k = 1, select('#', ...) do
+         local m = select(k, ...)
+         if m ~= nil then registered[#registered+1] = m end
       end
+      return ...
    end
+   local results = {pcall(f, tmp, ...)}
+   for k = 1, #registered do matrix_release(registered[k]) end
+   if not results[1] then error(results[2], 0) end
+   return unpack(results, 2, table.maxn(results))
+end
+
+local pool_stats = ffi.new('struct matrix_pool_stats')
+
+local function matrix_pool_stats()
+   ffi.C.matrix_pool_get_stats(pool_stats)
+   local s = pool_stats
+   return {
+      requests     = s.requests,
+      hits         = s.hits,
+      hit_rate     = s.requests > 0 and s.hits / s.requests or 0,
+      bytes_in_use = s.bytes_in_use,
+      peak_bytes   = s.peak_bytes,
+      cached_bytes = s.cached_bytes,
+      cached_limit = s.cached_limit,
+   }
 end
 
 local function matrix_copy(a)
@@ -140,6 +340,21 @@ local function matrix_complex_copy(a)
    return b
 end
 
+-- Conversions between real and single precision matrices.
+local function matrix_tofloat(a)
+   local n1, n2 = matrix_dim(a)
+   local b = matrix_falloc(n1, n2)
+   matrix_lazy.elementwise_into(b, 'copy', a)
+   return b
+end
+
+local function matrix_todouble(a)
+   local n1, n2 = matrix_dim(a)
+   local b = matrix_alloc(n1, n2)
+   matrix_lazy.elementwise_into(b, 'copy', a)
+   return b
+end
+
 local function check_indices(m, i, j)
    local r, c = matrix_dim(m)
    if i < 1 or i > r or j < 1 or j > c then
@@ -182,6 +397,16 @@ local function matrix_complex_set(m, i, j, v)
    return gsl.gsl_matrix_complex_set(m, i, j, v)
 end
 
+local function matrix_float_get(m, i, j)
+   i, j = check_indices(m, i, j)
+   return m.data[i*m.tda+j]
+end
+
+local function matrix_float_set(m, i, j, v)
+   i, j = check_indices(m, i, j)
+   m.data[i*m.tda+j] = check_real(v)
+end
+
 local function complex_conj(z)
    local x, y = cartesian(z)
    return gsl_complex(x, -y)
@@ -362,6 +587,39 @@ local function matrix_complex_slice(m, i, j, ni, nj)
    return r
 end
 
+local function matrix_float_col(m, j)
+   j = check_col_index (m, j)
+   local mb = m.block
+   local r = gsl_matrix_float(m.size1, 1, m.tda, m.data + j, mb, 1)
+   mb.ref_count = mb.ref_count + 1
+   return r
+end
+
+local function matrix_float_row(m, i)
+   i = check_row_index (m, i)
+   local mb = m.block
+   local r = gsl_matrix_float(1, m.size2, 1, m.data + i*m.tda, mb, 1)
+   mb.ref_count = mb.ref_count + 1
+   return r
+end
+
+local function matrix_float_row_as_column(m, i)
+   i = check_row_index (m, i)
+   local mb = m.block
+   local r = gsl_matrix_float(m.size2, 1, 1, m.data + i*m.tda, mb, 1)
+   mb.ref_count = mb.ref_count + 1
+   return r
+end
+
+local function matrix_float_slice(m, i, j, ni, nj)
+   check_indices (m, i+ni-1, j+nj-1)
+   i, j = check_indices (m, i, j)
+   local mb = m.block
+   local r = gsl_matrix_float(ni, nj, m.tda, m.data + i*m.tda + j, mb, 1)
+   mb.ref_count = mb.ref_count + 1
+   return r
+end
+
 local function matrix_vect_def(t)
    local n = #t
    local isr = true
@@ -389,36 +647,16 @@ local function matrix_vect_def(t)
    end
 end
 
-local function mat_op_gen(n1, n2, opa, a, opb, b, oper)
-   local c = matrix_alloc(n1, n2)
-   for i = 0, n1-1 do
-      for j = 0, n2-1 do
-         local ar = opa(a,i,j)
-         local br = opb(b,i,j)
-         c.data[i*n2+j] = oper(ar, br)
-      end
-   end
-   return c
-end
-
-local function mat_comp_op_gen(n1, n2, opa, a, opb, b, oper)
-   local c = matrix_calloc(n1, n2)
-   for i = 0, n1-1 do
-      for j = 0, n2-1 do
-         local ar, ai = opa(a,i,j)
-         local br, bi = opb(b,i,j)
-         local zr, zi = oper(ar, br, ai, bi)
-         c.data[2*i*n2+2*j  ] = zr
-         c.data[2*i*n2+2*j+1] = zi
-      end
-   end
-   return c
-end
-
 local function real_get(x) return x, 0 end
 local function complex_get(z) return z[0], z[1] end
 local function mat_real_get(m,i,j) return m.data[i*m.tda+j], 0 end
 
+-- The elements of single precision matrices are shown with the digits
+-- that they can represent.
+local function mat_float_get(m,i,j)
+   return tonumber(format('%.7g', m.data[i*m.tda+j])), 0
+end
+
 local function mat_complex_get(m,i,j)
    local idx = 2*i*m.tda+2*j
    return m.data[idx],  m.data[idx+1]
@@ -435,12 +673,7 @@ end
 local function mat_complex_of_real(m)
    local n1, n2 = matrix_dim(m)
    local mc = matrix_calloc(n1, n2)
-   for i=0, n1-1 do
-      for j=0, n2-1 do
-         mc.data[2*i*n2+2*j  ] = m.data[i*n2+j]
-         mc.data[2*i*n2+2*j+1] = 0
-      end
-   end
+   matrix_lazy.elementwise_into(mc, 'copy', m)
    return mc
 end
 
@@ -465,8 +698,11 @@ local function opdiv(ar, br, ai, bi)
    end
 end
 
-local function vector_op(scalar_op, element_wise, no_inverse)
+local function vector_op(name, scalar_op, element_wise, no_inverse)
+   local is_expr, lazy_op = matrix_lazy.is_expr, matrix_lazy[name]
+   local elementwise = matrix_lazy.elementwise
    return function(a, b)
+             if is_expr(a) or is_expr(b) then return lazy_op(a, b) end
              local ra, sa = get_typeid(a)
              local rb, sb = get_typeid(b)
              if not sb and no_inverse then
@@ -478,20 +714,21 @@ local function vector_op(scalar_op, element_wise, no_inverse)
                 local zr, zi = scalar_op(ar, br, ai, bi)
                 return gsl_complex(zr, zi)
              elseif element_wise or sa or sb then
-                local sela, selb = selector(ra, sa), selector(rb, sb)
-                local n1 = (sa and tonumber(b.size1) or tonumber(a.size1))
-                local n2 = (sa and tonumber(b.size2) or tonumber(a.size2))
-                if ra and rb then
-                   return mat_op_gen(n1, n2, sela, a, selb, b, scalar_op)
-                else
-                   return mat_comp_op_gen(n1, n2, sela, a, selb, b, scalar_op)
-                end
+                return elementwise(name, a, b)
              else
                 if ra and rb then
+                   local fa, fb = ffi.istype(gsl_matrix_float, a), ffi.istype(gsl_matrix_float, b)
                    local n1, n2 = tonumber(a.size1), tonumber(b.size2)
-                   local c = matrix_alloc(n1, n2)
                    local NT = gsl.CblasNoTrans
-                   gsl_check(gsl.gsl_blas_dgemm(NT, NT, 1, a, b, 0, c))
+                   if fa and fb then
+                      local c = matrix_falloc(n1, n2)
+                      gsl_check(blas.sgemm(NT, NT, 1, a, b, 0, c))
+                      return c
+                   end
+                   if fa then a = matrix_todouble(a) end
+                   if fb then b = matrix_todouble(b) end
+                   local c = matrix_alloc(n1, n2)
+                   gsl_check(blas.dgemm(NT, NT, 1, a, b, 0, c))
                    return c
                 else
                    if ra then a = mat_complex_of_real(a) end
@@ -499,7 +736,7 @@ local function vector_op(scalar_op, element_wise, no_inverse)
                    local n1, n2 = tonumber(a.size1), tonumber(b.size2)
                    local c = matrix_calloc(n1, n2)
                    local NT = gsl.CblasNoTrans
-                   gsl_check(gsl.gsl_blas_zgemm(NT, NT, 1, a, b, 0, c))
+                   gsl_check(blas.zgemm(NT, NT, 1, a, b, 0, c))
                    return c
                 end
              end
@@ -512,26 +749,7 @@ local function complex_unm(a)
 end
 
 local function matrix_unm(a)
-   local n1, n2 = matrix_dim(a)
-   local m = matrix_alloc(n1, n2)
-   for i=0, n1-1 do
-      for j=0, n2-1 do
-         m.data[n2*i+j] = -a.data[n2*i+j]
-      end
-   end
-   return m
-end
-
-local function matrix_complex_unm(a)
-   local n1, n2 = matrix_dim(a)
-   local m = matrix_calloc(n1, n2)
-   for i=0, n1-1 do
-      for j=0, n2-1 do
-         m.data[2*n2*i+2*j  ] = -a.data[2*n2*i+2*j  ]
-         m.data[2*n2*i+2*j+1] = -a.data[2*n2*i+2*j+1]
-      end
-   end
-   return m
+   return matrix_lazy.elementwise('unm', a)
 end
 
 local function matrix_norm2(m)
@@ -583,10 +801,10 @@ complex = {
    arg   = complex_arg
 }
 
-local generic_add = vector_op(opadd, true)
-local generic_sub = vector_op(opsub, true)
-local generic_mul = vector_op(opmul, false)
-local generic_div = vector_op(opdiv, true, true)
+local generic_add = vector_op('add', opadd, true)
+local generic_sub = vector_op('sub', opsub, true)
+local generic_mul = vector_op('mul', opmul, false)
+local generic_div = vector_op('div', opdiv, true, true)
 
 local complex_mt = {
 
@@ -629,19 +847,76 @@ local function matrix_fset(m, f)
    end
 end
 
+-- The functions that check their arguments in matrix-lazy are called
+-- with tail calls so that the errors are raised at the caller's level.
 local function matrix_set_equal(a, b)
-   local n1a, n2a = matrix_dim(a)
-   local n1b, n2b = matrix_dim(b)
-
-   if n1a ~= n1b or n2a ~= n2b then
-      error('matrix dimensions does not match', 2)
+   if matrix_lazy.is_expr(b) then
+      return matrix_lazy.assign(a, b)
+   else
+      return matrix_lazy.elementwise_into(a, 'copy', b)
    end
+end
+
+-- The method "set" sets a single element or, with a single argument,
+-- all the elements from another matrix.
+local function matrix_set_method(m, i, j, v)
+   if j == nil then return matrix_set_equal(m, i) end
+   return matrix_set(m, i, j, v)
+end
+
+local function matrix_float_set_method(m, i, j, v)
+   if j == nil then return matrix_set_equal(m, i) end
+   return matrix_float_set(m, i, j, v)
+end
+
+local function matrix_complex_set_method(m, i, j, v)
+   if j == nil then return matrix_set_equal(m, i) end
+   return matrix_complex_set(m, i, j, v)
+end
+
+local function matrix_add_to(m, x)
+   return matrix_lazy.elementwise_into(m, 'add', m, x)
+end
+
+local function matrix_scale(m, alpha)
+   return matrix_lazy.elementwise_into(m, 'mul', m, alpha)
+end
+
+local function blas_transpose(t)
+   if not t or t == 'N' then return gsl.CblasNoTrans end
+   if t == true or t == 'T' then return gsl.CblasTrans end
+   if t == 'C' then return gsl.CblasConjTrans end
+   error("invalid transpose option, expecting 'N', 'T' or 'C'", 3)
+end
 
-   for i=1, n1b do
-      for j=1, n2b do
-         a:set(i, j, b:get(i,j))
+-- Compute C <- alpha*op(A)*op(B) + beta*C where op(X) is X, its
+-- transpose or its hermitian conjugate. The operands are converted to
+-- the type of C.
+local function matrix_gemm(alpha, a, b, beta, c, transa, transb)
+   local ta, tb = blas_transpose(transa), blas_transpose(transb)
+   local ra, rb = check_typeid(a), check_typeid(b)
+   if ffi.istype(gsl_matrix, c) then
+      if not (ra and rb) then
+         error('cannot store a complex product in a real matrix', 2)
       end
+      if ffi.istype(gsl_matrix_float, a) then a = matrix_todouble(a) end
+      if ffi.istype(gsl_matrix_float, b) then b = matrix_todouble(b) end
+      gsl_check(blas.dgemm(ta, tb, check_real(alpha), a, b, check_real(beta), c))
+   elseif ffi.istype(gsl_matrix_float, c) then
+      if not (ra and rb) then
+         error('cannot store a complex product in a real matrix', 2)
+      end
+      if not ffi.istype(gsl_matrix_float, a) then a = matrix_tofloat(a) end
+      if not ffi.istype(gsl_matrix_float, b) then b = matrix_tofloat(b) end
+      gsl_check(blas.sgemm(ta, tb, check_real(alpha), a, b, check_real(beta), c))
+   elseif ffi.istype(gsl_matrix_complex, c) then
+      if ra then a = mat_complex_of_real(a) end
+      if rb then b = mat_complex_of_real(b) end
+      gsl_check(blas.zgemm(ta, tb, alpha, a, b, beta, c))
+   else
+      error('expected matrix', 2)
    end
+   return c
 end
 
 local function matrix_new_transpose(a)
@@ -677,8 +952,12 @@ end
 matrix = {
    new    = matrix_new,
    cnew   = matrix_cnew,
+   fnew   = matrix_fnew,
    alloc  = matrix_alloc,
    calloc = matrix_calloc,
+   falloc = matrix_falloc,
+   tofloat  = matrix_tofloat,
+   todouble = matrix_todouble,
    zero   = matrix_zero_tg,
    copy   = matrix_new_copy,
    unit   = matrix_new_unit,
@@ -686,17 +965,99 @@ matrix = {
    vec    = matrix_vect_def,
    set    = matrix_set_equal,
    fset   = matrix_fset,
+   gemm   = matrix_gemm,
+   axpy   = matrix_lazy.axpy,
    block  = block_alloc,
+   block_unref = block_unref,
+   release = matrix_release,
+   scope   = matrix_scope,
+   mmap    = matrix_mmap,
+   madvise = matrix_madvise,
+
+   pool_stats = matrix_pool_stats,
+   pool_trim  = ffi.C.matrix_pool_trim,
+   pool_limit = ffi.C.matrix_pool_set_limit,
+   pool_reset_peak = ffi.C.matrix_pool_reset_peak,
+   lazy   = matrix_lazy.new,
+   eval   = matrix_lazy.eval,
 
    transpose = matrix_new_transpose,
    hc        = matrix_new_hc,
+
+   factor_lu       = matrix_factor.lu,
+   factor_cholesky = matrix_factor.cholesky,
+   factor_qr       = matrix_factor.qr,
+   factor_svd      = matrix_factor.svd,
 }
 
+-- Without a comparison function each column is sorted in ascending
+-- order, with the NaN values at the end, by the native sort. Otherwise
+-- the elements of the column matrix are sorted using the function "f".
 local function matrix_sort(m, f)
-   local n = matrix_len(m)
-   algo.quicksort(m.data, 0, n - 1, f)
+   if f then
+      local n = matrix_len(m)
+      algo.quicksort(m.data, 0, n - 1, f)
+   else
+      local n1, n2 = matrix_dim(m)
+      for j = 0, n2 - 1 do
+         ffi.C.matrix_sort_strided(m.data + j, m.tda, n1)
+      end
+   end
+end
+
+-- Return a matrix with, for each column, the indexes of its elements in
+-- ascending order. The order of equal elements is preserved.
+local function matrix_argsort(m)
+   local n1, n2 = matrix_dim(m)
+   local p = matrix_alloc(n1, n2)
+   local perm = ffi.new('size_t[?]', n1)
+   for j = 0, n2 - 1 do
+      if ffi.C.matrix_argsort_strided(m.data + j, m.tda, n1, perm) ~= 0 then
+         error('not enough memory', 2)
+      end
+      for i = 0, n1 - 1 do
+         p.data[i * n2 + j] = tonumber(perm[i]) + 1
+      end
+   end
+   return p
 end
 
+-- The order statistics consider all the elements of the matrix and are
+-- computed by selection, in linear time, on a copy of the elements.
+local function check_real_matrix(m)
+   if not ffi.istype(gsl_matrix, m) then
+      error('expected real matrix', 3)
+   end
+end
+
+local function matrix_nth_element(m, k)
+   check_real_matrix(m)
+   local n1, n2 = matrix_dim(m)
+   if not is_integer(k) or k < 1 or k > n1 * n2 then
+      error('element index out of bounds', 2)
+   end
+   return ffi.C.matrix_nth_element(m.data, m.tda, n1, n2, k - 1)
+end
+
+local function matrix_quantile(m, p)
+   check_real_matrix(m)
+   if not (p >= 0 and p <= 1) then
+      error('quantile should be between 0 and 1', 2)
+   end
+   local n1, n2 = matrix_dim(m)
+   return ffi.C.matrix_quantile(m.data, m.tda, n1, n2, p)
+end
+
+local function matrix_median(m)
+   check_real_matrix(m)
+   local n1, n2 = matrix_dim(m)
+   return ffi.C.matrix_quantile(m.data, m.tda, n1, n2, 0.5)
+end
+
+matrix.quantile    = matrix_quantile
+matrix.median      = matrix_median
+matrix.nth_element = matrix_nth_element
+
 local matrix_methods = {
    alloc = matrix_alloc,
    dim   = matrix_dim,
@@ -704,12 +1065,16 @@ local matrix_methods = {
    col   = matrix_col,
    row   = matrix_row,
    get   = matrix_get,
-   set   = matrix_set,
+   set   = matrix_set_method,
    copy  = matrix_copy,
+   add_to = matrix_add_to,
+   scale = matrix_scale,
    norm  = matrix_norm,
    norm2 = matrix_norm2,
    slice = matrix_slice,
    sort  = matrix_sort,
+   argsort = matrix_argsort,
+   tofloat = matrix_tofloat,
    show  = matrix_display_gen(mat_real_get),
 }
 
@@ -768,6 +1133,53 @@ local matrix_mt = {
 
 ffi.metatype(gsl_matrix, matrix_mt)
 
+local matrix_float_methods = {
+   alloc = matrix_falloc,
+   dim   = matrix_dim,
+   zero  = matrix_float_zero,
+   col   = matrix_float_col,
+   row   = matrix_float_row,
+   get   = matrix_float_get,
+   set   = matrix_float_set_method,
+   copy  = matrix_tofloat,
+   add_to = matrix_add_to,
+   scale = matrix_scale,
+   norm  = matrix_norm,
+   norm2 = matrix_norm2,
+   slice = matrix_float_slice,
+   todouble = matrix_todouble,
+   show  = matrix_display_gen(mat_float_get),
+}
+
+local function matrix_float_index(m, i)
+   if is_integer(i) then
+      if m.size2 == 1 then
+         i = check_row_index (m, i)
+         return m.data[i * m.tda]
+      else
+         return matrix_float_row_as_column(m, i)
+      end
+   end
+   return matrix_float_methods[i]
+end
+
+local matrix_float_mt = {
+   __gc = matrix_free,
+
+   __add = generic_add,
+   __sub = generic_sub,
+   __mul = generic_mul,
+   __div = generic_div,
+   __unm = matrix_unm,
+
+   __len = matrix_len,
+
+   __index    = matrix_float_index,
+   __newindex = matrix_newindex,
+}
+
+ffi.metatype(gsl_matrix_float, matrix_float_mt)
+
 local matrix_complex_methods = {
    alloc = matrix_calloc,
    dim   = matrix_dim,
@@ -775,8 +1187,10 @@ local matrix_complex_methods = {
    col   = matrix_complex_col,
    row   = matrix_complex_row,
    get   = matrix_complex_get,
-   set   = matrix_complex_set,
+   set   = matrix_complex_set_method,
    copy  = matrix_complex_copy,
+   add_to = matrix_add_to,
+   scale = matrix_scale,
    norm  = matrix_complex_norm,
    norm2 = matrix_complex_norm2,
    slice = matrix_complex_slice,
@@ -830,7 +1244,7 @@ local matrix_complex_mt = {
    __mul = generic_mul,
    __div = generic_div,
    __pow = matrix_power.cpower,
-   __unm = matrix_complex_unm,
+   __unm = matrix_unm,
 
    __len = matrix_len,
 
@@ -1191,5 +1605,6 @@ local register_ffi_type = debug.getregistry().__gsl_reg_ffi_type
 register_ffi_type(gsl_complex, "complex")
 register_ffi_type(gsl_matrix, "matrix")
 register_ffi_type(gsl_matrix_complex, "complex matrix")
+register_ffi_type(gsl_matrix_float, "float matrix")
 
 return matrix
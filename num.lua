@@ -8,7 +8,7 @@ num = {}
 function num.ode(spec)
    local required = {N= 'number', eps_abs= 'number'}
    local defaults = {eps_rel = 0, a_y = 1, a_dydt = 0}
-   local is_known = {rkf45= true, rk8pd= true}
+   local is_known = {rkf45= true, rk8pd= true, rosenbrock= true, bdf= true}
 
    for k, tp in pairs(required) do
       if type(spec[k]) ~= tp then
@@ -28,12 +28,125 @@ function num.ode(spec)
    REG['GSL.help_hook'].ODE = ode
 
    local mt = {
-      __index = {step = ode.step, init = ode.init, evolve = ode.evolve}
+      __index = {step = ode.step, init = ode.init, evolve = ode.evolve,
+                 sample = ode.sample, set_jacobian = ode.set_jacobian}
    }
 
    return setmetatable(ode.new(), mt)
 end
 
+-- Code run by each state of the pool to integrate a batch of the
+-- trajectories of an ensemble.
+local ENSEMBLE_WORKER = [[
+local ffi = require 'ffi'
+local template = require 'template'
+local ode = template.load('odeens', %s)
+local f = assert(loadstring(%q))()
+local evolve, cast, min = ode.evolve, ffi.cast, math.min
+return function(task, t1, K, batch, y, dydt, t, h)
+   local lo = task * batch
+   local hi = min(lo + batch, K)
+   evolve(cast('double *', y), cast('double *', dydt), cast('double *', t),
+          cast('double *', h), K, f, t1, lo, hi)
+end
+]]
+
+local ENSEMBLE_METHODS = {}
+
+function ENSEMBLE_METHODS.init(e, t0, h0, f, y0)
+   local K, N = e.size, e.dim
+   local n1, n2 = matrix.dim(y0)
+   if n1 ~= K or n2 ~= N then
+      error('initial values should be given as a K x N matrix', 2)
+   end
+
+   local fsrc
+   if type(f) == 'string' then
+      fsrc = f
+      f = assert(loadstring(f))()
+   elseif e.workers > 1 then
+      error('the function should be given as Lua code to use workers', 2)
+   end
+
+   local y = e.y.data
+   for l = 0, K - 1 do
+      for i = 0, N - 1 do
+         y[i*K + l] = y0.data[l*y0.tda + i]
+      end
+   end
+   e.f = f
+   e.ode.init(y, e.dydt.data, e.t.data, e.h.data, K, f, t0, h0, 0, K)
+
+   if e.workers > 1 and fsrc ~= e.fsrc then
+      local pool = require 'pool'
+      local code = pool.paths() .. string.format(ENSEMBLE_WORKER, e.defs, fsrc)
+      e.pool = pool.new(e.workers, code)
+      e.fsrc = fsrc
+   end
+end
+
+function ENSEMBLE_METHODS.evolve(e, t1)
+   local K = e.size
+   if not e.f then error('the ensemble is not initialized', 2) end
+   if e.pool then
+      local pool = require 'pool'
+      local addr = pool.address
+      local ntasks = math.ceil(K / e.batch)
+      e.pool:run(ntasks, t1, K, e.batch, addr(e.y.data), addr(e.dydt.data),
+                 addr(e.t.data), addr(e.h.data))
+   else
+      e.ode.evolve(e.y.data, e.dydt.data, e.t.data, e.h.data, K, e.f, t1, 0, K)
+   end
+end
+
+function ENSEMBLE_METHODS.solution(e)
+   local K, N = e.size, e.dim
+   local r, y = matrix.alloc(K, N), e.y.data
+   for l = 0, K - 1 do
+      for i = 0, N - 1 do
+         r.data[l*N + i] = y[i*K + l]
+      end
+   end
+   return r
+end
+
+local ENSEMBLE = {__index = ENSEMBLE_METHODS}
+
+function num.ode_ensemble(spec)
+   local required = {N= 'number', K= 'number', eps_abs= 'number'}
+   local defaults = {eps_rel = 0, a_y = 1, a_dydt = 0, method = 'rkf45', workers = 1}
+   local is_known = {rkf45= true, rk8pd= true}
+
+   for k, tp in pairs(required) do
+      if type(spec[k]) ~= tp then
+         error(string.format('parameter %s should be a %s', k, tp))
+      end
+   end
+
+   local defs = {}
+   for k, v in pairs(defaults) do defs[k] = spec[k] or v end
+   defs.N, defs.eps_abs = spec.N, spec.eps_abs
+   if not is_known[defs.method] then error('unknown ode method: ' .. defs.method) end
+
+   local K, N, workers = spec.K, spec.N, defs.workers
+   defs.workers = nil
+
+   local ls = {}
+   for k, v in pairs(defs) do
+      ls[#ls+1] = string.format(type(v) == 'string' and '%s= %q' or '%s= %.17g', k, v)
+   end
+
+   local e = {
+      dim = N, size = K, workers = workers, ode = template.load('odeens', defs),
+      defs = '{' .. table.concat(ls, ', ') .. '}',
+      batch = spec.batch or math.max(1, math.ceil(K / (8 * workers))),
+      y = matrix.alloc(N, K), dydt = matrix.alloc(N, K),
+      t = matrix.alloc(K, 1), h = matrix.alloc(K, 1),
+   }
+
+   return setmetatable(e, ENSEMBLE)
+end
+
 local NLINFIT_METHODS = {
    set     = function(ss, fdf, x0) return ss.lm.set(fdf, x0) end,
    iterate = function(ss) return ss.lm.iterate() end,
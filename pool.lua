@@ -0,0 +1,63 @@
+local ffi = require 'ffi'
+
+local C = ffi.C
+local format = string.format
+
+-- Pools of independent Lua states to run a task function in parallel
+-- threads. Each state runs the given code, that should return the task
+-- function, and then calls it with the index of the task, from zero,
+-- and the numeric arguments given to run. The states share nothing with
+-- the main state: the data should be passed as addresses of C memory.
+
+ffi.cdef[[
+typedef struct lua_pool lua_pool;
+
+lua_pool *lua_pool_new  (int nstates, const char *code, char *errmsg, size_t errlen);
+int       lua_pool_run  (lua_pool *p, int ntasks, const double *args, int nargs,
+                         char *errmsg, size_t errlen);
+int       lua_pool_size (const lua_pool *p);
+void      lua_pool_free (lua_pool *p);
+]]
+
+local ERRMSG_LEN = 512
+
+local pool_methods = {}
+local pool_mt = {__index = pool_methods}
+
+function pool_methods.size(p)
+    return C.lua_pool_size(p.ptr)
+end
+
+function pool_methods.run(p, ntasks, ...)
+    local nargs = select('#', ...)
+    local args = ffi.new('double[?]', nargs + 1, ...)
+    local errmsg = ffi.new('char[?]', ERRMSG_LEN)
+    if C.lua_pool_run(p.ptr, ntasks, args, nargs, errmsg, ERRMSG_LEN) ~= 0 then
+        error(ffi.string(errmsg), 2)
+    end
+end
+
+local pool = {}
+
+function pool.new(n, code)
+    local errmsg = ffi.new('char[?]', ERRMSG_LEN)
+    local p = C.lua_pool_new(n, code, errmsg, ERRMSG_LEN)
+    if p == nil then
+        error(format('cannot create the pool: %s', ffi.string(errmsg)), 2)
+    end
+    return setmetatable({ptr = ffi.gc(p, C.lua_pool_free)}, pool_mt)
+end
+
+-- Return the address of a pointer as a number, to be passed to the
+-- pool functions.
+function pool.address(ptr)
+    return tonumber(ffi.cast('uintptr_t', ptr))
+end
+
+-- Return a string with the Lua code that sets the module paths of a
+-- state of the pool to the ones of the calling state.
+function pool.paths()
+    return format('package.path = %q\npackage.cpath = %q\n', package.path, package.cpath)
+end
+
+return pool
@@ -0,0 +1,511 @@
+local ffi = require 'ffi'
+local check = require 'check'
+
+local C = ffi.C
+local is_real, is_integer = check.is_real, check.is_integer
+local tonumber, error, sqrt, abs, min = tonumber, error, math.sqrt, math.abs, math.min
+local format = string.format
+
+-- Sparse real matrices. A matrix is assembled as a list of (row,
+-- column, value) triplets and is then compressed by rows (CSR) or by
+-- columns (CSC) for the computations. The iterative solvers take a
+-- square matrix in CSR form and a dense column matrix.
+
+ffi.cdef[[
+typedef struct {
+    size_t size1, size2;
+    size_t nz;
+    int sptype;
+    size_t *ptr;
+    size_t *index;
+    double *data;
+} sparse_matrix;
+
+typedef struct {
+    size_t size1, size2;
+    size_t nz, size;
+    size_t *rows;
+    size_t *cols;
+    double *data;
+} sparse_coo;
+
+typedef struct {
+    sparse_matrix *lu;
+    size_t *diag;
+} sparse_ilu0;
+
+sparse_coo *   sparse_coo_new  (size_t size1, size_t size2);
+void           sparse_coo_free (sparse_coo *c);
+int            sparse_coo_add  (sparse_coo *c, size_t i, size_t j, double x);
+
+sparse_matrix *sparse_from_coo   (const sparse_coo *c, int format);
+sparse_matrix *sparse_from_dense (const double *data, size_t tda, size_t size1, size_t size2, int format);
+sparse_matrix *sparse_convert    (const sparse_matrix *a, int format);
+sparse_matrix *sparse_transpose  (const sparse_matrix *a);
+sparse_matrix *sparse_matmul     (const sparse_matrix *a, const sparse_matrix *b);
+void           sparse_free       (sparse_matrix *a);
+
+double sparse_get      (const sparse_matrix *a, size_t i, size_t j);
+void   sparse_to_dense (const sparse_matrix *a, double *data, size_t tda);
+void   sparse_diagonal (const sparse_matrix *a, double *d);
+
+void   sparse_matvec (const sparse_matrix *a, double alpha, const double *x, size_t incx,
+                      double beta, double *y, size_t incy);
+void   sparse_set_threads (int n);
+
+sparse_ilu0 *sparse_ilu0_new   (const sparse_matrix *a);
+void         sparse_ilu0_free  (sparse_ilu0 *f);
+void         sparse_ilu0_solve (const sparse_ilu0 *f, double *x);
+]]
+
+local CSR, CSC = 0, 1
+local format_names = {[CSR] = 'csr', [CSC] = 'csc'}
+
+local sparse_matrix = ffi.typeof('sparse_matrix')
+local sparse_coo = ffi.typeof('sparse_coo')
+local gsl_matrix = ffi.typeof('gsl_matrix')
+local double_array = ffi.typeof('double[?]')
+
+local function is_sparse(x)
+    return ffi.istype(sparse_matrix, x)
+end
+
+-- Take ownership of a matrix returned by the C functions.
+local function sparse_gc(a)
+    if a == nil then error('not enough memory', 3) end
+    return ffi.gc(a, C.sparse_free)
+end
+
+local function sparse_dim(a)
+    return tonumber(a.size1), tonumber(a.size2)
+end
+
+local function sparse_nnz(a)
+    return tonumber(a.nz)
+end
+
+local function sparse_storage(a)
+    return format_names[a.sptype]
+end
+
+local function sparse_get(a, i, j)
+    local n1, n2 = sparse_dim(a)
+    if not (is_integer(i) and is_integer(j) and i >= 1 and i <= n1 and j >= 1 and j <= n2) then
+        error('matrix index out of bounds', 2)
+    end
+    return C.sparse_get(a, i - 1, j - 1)
+end
+
+local function sparse_todense(a)
+    local n1, n2 = sparse_dim(a)
+    local m = matrix.alloc(n1, n2)
+    C.sparse_to_dense(a, m.data, m.tda)
+    return m
+end
+
+local function sparse_tocsr(a)
+    return sparse_gc(C.sparse_convert(a, CSR))
+end
+
+local function sparse_tocsc(a)
+    return sparse_gc(C.sparse_convert(a, CSC))
+end
+
+local function sparse_transpose(a)
+    return sparse_gc(C.sparse_transpose(a))
+end
+
+-- Return the diagonal as a column matrix.
+local function sparse_diag(a)
+    local n1, n2 = sparse_dim(a)
+    local d = matrix.alloc(min(n1, n2), 1)
+    C.sparse_diagonal(a, d.data)
+    return d
+end
+
+-- Store in "y" the product of the matrix by the dense real matrix "x",
+-- one column at a time.
+local function sparse_mul_dense(a, x, y)
+    local n1, n2 = sparse_dim(a)
+    if not ffi.istype(gsl_matrix, x) then
+        error('expected real matrix', 3)
+    end
+    local x1, x2 = tonumber(x.size1), tonumber(x.size2)
+    if x1 ~= n2 then error('matrix dimensions does not match', 3) end
+    if y then
+        if not ffi.istype(gsl_matrix, y) or tonumber(y.size1) ~= n1 or tonumber(y.size2) ~= x2 then
+            error('matrix dimensions does not match', 3)
+        end
+    else
+        y = matrix.alloc(n1, x2)
+    end
+    for j = 0, x2 - 1 do
+        C.sparse_matvec(a, 1, x.data + j, x.tda, 0, y.data + j, y.tda)
+    end
+    return y
+end
+
+local function sparse_mul(a, x, y)
+    return sparse_mul_dense(a, x, y)
+end
+
+local function sparse_scale(a, s)
+    local b = sparse_gc(C.sparse_convert(a, a.sptype))
+    for k = 0, tonumber(b.nz) - 1 do b.data[k] = s * b.data[k] end
+    return b
+end
+
+-- The product of two sparse matrices is computed in CSR form.
+local function sparse_matmul(a, b)
+    if a.size2 ~= b.size1 then error('matrix dimensions does not match', 3) end
+    local ar = a.sptype == CSR and a or sparse_tocsr(a)
+    local br = b.sptype == CSR and b or sparse_tocsr(b)
+    return sparse_gc(C.sparse_matmul(ar, br))
+end
+
+local function sparse_mul_op(a, b)
+    if is_real(a) then
+        return sparse_scale(b, a)
+    elseif is_real(b) then
+        return sparse_scale(a, b)
+    elseif not is_sparse(a) then
+        error('cannot multiply a dense matrix by a sparse matrix', 2)
+    elseif is_sparse(b) then
+        return sparse_matmul(a, b)
+    else
+        return sparse_mul_dense(a, b)
+    end
+end
+
+local function sparse_tostring(a)
+    local n1, n2 = sparse_dim(a)
+    return format('<sparse matrix %ix%i, %i nonzeros, %s>', n1, n2, sparse_nnz(a), sparse_storage(a))
+end
+
+local sparse_methods = {
+    dim       = sparse_dim,
+    nnz       = sparse_nnz,
+    storage   = sparse_storage,
+    get       = sparse_get,
+    diag      = sparse_diag,
+    mul       = sparse_mul,
+    todense   = sparse_todense,
+    tocsr     = sparse_tocsr,
+    tocsc     = sparse_tocsc,
+    transpose = sparse_transpose,
+}
+
+ffi.metatype(sparse_matrix, {
+    __index    = sparse_methods,
+    __mul      = sparse_mul_op,
+    __tostring = sparse_tostring,
+})
+
+local function coo_add(c, i, j, x)
+    if not (is_integer(i) and is_integer(j) and i >= 1 and i <= c.size1 and j >= 1 and j <= c.size2) then
+        error('matrix index out of bounds', 2)
+    end
+    if C.sparse_coo_add(c, i - 1, j - 1, x) ~= 0 then
+        error('not enough memory', 2)
+    end
+end
+
+local function coo_compress(c, fmt)
+    return sparse_gc(C.sparse_from_coo(c, fmt))
+end
+
+ffi.metatype(sparse_coo, {
+    __index = {
+        add   = coo_add,
+        nnz   = function(c) return tonumber(c.nz) end,
+        tocsr = function(c) return coo_compress(c, CSR) end,
+        tocsc = function(c) return coo_compress(c, CSC) end,
+    },
+})
+
+local sparse = {}
+
+-- Return an empty list of triplets for a matrix of the given size. The
+-- elements added more than once are summed when the matrix is
+-- compressed.
+function sparse.coo(n1, n2)
+    if not (is_integer(n1) and is_integer(n2) and n1 >= 0 and n2 >= 0) then
+        error('invalid matrix dimensions', 2)
+    end
+    local c = C.sparse_coo_new(n1, n2)
+    if c == nil then error('not enough memory', 2) end
+    return ffi.gc(c, C.sparse_coo_free)
+end
+
+-- Return the sparse matrix with the non-zero elements of the dense
+-- real matrix "m", in CSR form unless "fmt" is 'csc'.
+function sparse.from_dense(m, fmt)
+    if not ffi.istype(gsl_matrix, m) then error('expected real matrix', 2) end
+    local a = C.sparse_from_dense(m.data, m.tda, m.size1, m.size2, fmt == 'csc' and CSC or CSR)
+    return sparse_gc(a)
+end
+
+-- Set the number of threads used by the products of big CSR matrices,
+-- zero to use one for each processor.
+function sparse.threads(n)
+    check.integer(n)
+    C.sparse_set_threads(n)
+end
+
+sparse.is_sparse = is_sparse
+
+-- Iterative solvers. The vectors are plain arrays of doubles and the
+-- preconditioner is a function "apply(r, z)" that stores in z the
+-- solution of M z = r.
+
+local function dot(n, x, y)
+    local s = 0
+    for i = 0, n - 1 do s = s + x[i] * y[i] end
+    return s
+end
+
+local function norm(n, x)
+    return sqrt(dot(n, x, x))
+end
+
+local function copy(n, x, y)
+    ffi.copy(y, x, n * ffi.sizeof('double'))
+end
+
+local function matvec(a, x, y)
+    C.sparse_matvec(a, 1, x, 1, 0, y, 1)
+end
+
+local function precond_none(a, n)
+    return function(r, z) copy(n, r, z) end
+end
+
+local function precond_jacobi(a, n)
+    local dinv = double_array(n)
+    C.sparse_diagonal(a, dinv)
+    for i = 0, n - 1 do
+        if dinv[i] == 0 then error('zero diagonal element in Jacobi preconditioner', 4) end
+        dinv[i] = 1 / dinv[i]
+    end
+    return function(r, z)
+        for i = 0, n - 1 do z[i] = dinv[i] * r[i] end
+    end
+end
+
+local function precond_ilu0(a, n)
+    local f = C.sparse_ilu0_new(a)
+    if f == nil then
+        error('ILU(0) factorization failed: missing or zero diagonal element', 4)
+    end
+    f = ffi.gc(f, C.sparse_ilu0_free)
+    return function(r, z)
+        copy(n, r, z)
+        C.sparse_ilu0_solve(f, z)
+    end
+end
+
+local preconditioners = {
+    none   = precond_none,
+    jacobi = precond_jacobi,
+    ilu0   = precond_ilu0,
+}
+
+-- Check the arguments common to the solvers and return the CSR matrix,
+-- the right-hand side and the solution as arrays, the options and the
+-- preconditioner. The solution is a new column matrix initialized with
+-- the option "x0" if given.
+local function solver_setup(a, b, opt)
+    if not is_sparse(a) then error('expected sparse matrix', 3) end
+    local n, n2 = sparse_dim(a)
+    if n ~= n2 then error('the matrix is not square', 3) end
+    if not ffi.istype(gsl_matrix, b) or tonumber(b.size1) ~= n or tonumber(b.size2) ~= 1 then
+        error('matrix dimensions does not match', 3)
+    end
+    opt = opt or {}
+    local ar = a.sptype == CSR and a or sparse_tocsr(a)
+    local bv = double_array(n)
+    for i = 0, n - 1 do bv[i] = b.data[i * b.tda] end
+    local x = matrix.new(n, 1)
+    if opt.x0 then x:set(opt.x0) end
+    local precond = preconditioners[opt.precond or 'none']
+    if not precond then error('invalid preconditioner: ' .. tostring(opt.precond), 3) end
+    local info = {tol = opt.tol or 1e-8, maxiter = opt.maxiter or 10 * n}
+    return ar, n, bv, x, precond(ar, n), info
+end
+
+local function solver_result(x, info, iter, res)
+    info.iterations, info.residual, info.converged = iter, res, res <= info.tol
+    info.tol, info.maxiter = nil, nil
+    return x, info
+end
+
+-- Conjugate gradient for symmetric positive definite matrices.
+function sparse.cg(a, b, opt)
+    local a, n, bv, xm, precond, info = solver_setup(a, b, opt)
+    local x = xm.data
+    local r, z, p, q = double_array(n), double_array(n), double_array(n), double_array(n)
+    local bnorm = norm(n, bv)
+    if bnorm == 0 then bnorm = 1 end
+
+    matvec(a, x, q)
+    for i = 0, n - 1 do r[i] = bv[i] - q[i] end
+    local res = norm(n, r) / bnorm
+    if res <= info.tol then return solver_result(xm, info, 0, res) end
+
+    precond(r, z)
+    copy(n, z, p)
+    local rz = dot(n, r, z)
+    for iter = 1, info.maxiter do
+        matvec(a, p, q)
+        local alpha = rz / dot(n, p, q)
+        for i = 0, n - 1 do
+            x[i] = x[i] + alpha * p[i]
+            r[i] = r[i] - alpha * q[i]
+        end
+        res = norm(n, r) / bnorm
+        if res <= info.tol or iter == info.maxiter then
+            return solver_result(xm, info, iter, res)
+        end
+        precond(r, z)
+        local rz_new = dot(n, r, z)
+        local beta = rz_new / rz
+        for i = 0, n - 1 do p[i] = z[i] + beta * p[i] end
+        rz = rz_new
+    end
+    return solver_result(xm, info, 0, res)
+end
+
+-- Stabilized biconjugate gradient for general matrices, with right
+-- preconditioning.
+function sparse.bicgstab(a, b, opt)
+    local a, n, bv, xm, precond, info = solver_setup(a, b, opt)
+    local x = xm.data
+    local r, rhat, p, v = double_array(n), double_array(n), double_array(n), double_array(n)
+    local s, t, phat, shat = double_array(n), double_array(n), double_array(n), double_array(n)
+    local bnorm = norm(n, bv)
+    if bnorm == 0 then bnorm = 1 end
+
+    matvec(a, x, v)
+    for i = 0, n - 1 do r[i] = bv[i] - v[i]; v[i] = 0 end
+    copy(n, r, rhat)
+    local res = norm(n, r) / bnorm
+    if res <= info.tol then return solver_result(xm, info, 0, res) end
+
+    local rho, alpha, omega = 1, 1, 1
+    for iter = 1, info.maxiter do
+        local rho_new = dot(n, rhat, r)
+        if rho_new == 0 then return solver_result(xm, info, iter, res) end
+        local beta = (rho_new / rho) * (alpha / omega)
+        for i = 0, n - 1 do p[i] = r[i] + beta * (p[i] - omega * v[i]) end
+        precond(p, phat)
+        matvec(a, phat, v)
+        alpha = rho_new / dot(n, rhat, v)
+        for i = 0, n - 1 do s[i] = r[i] - alpha * v[i] end
+        res = norm(n, s) / bnorm
+        if res <= info.tol then
+            for i = 0, n - 1 do x[i] = x[i] + alpha * phat[i] end
+            return solver_result(xm, info, iter, res)
+        end
+        precond(s, shat)
+        matvec(a, shat, t)
+        local tt = dot(n, t, t)
+        omega = tt > 0 and dot(n, t, s) / tt or 0
+        for i = 0, n - 1 do
+            x[i] = x[i] + alpha * phat[i] + omega * shat[i]
+            r[i] = s[i] - omega * t[i]
+        end
+        res = norm(n, r) / bnorm
+        if res <= info.tol or omega == 0 or iter == info.maxiter then
+            return solver_result(xm, info, iter, res)
+        end
+        rho = rho_new
+    end
+    return solver_result(xm, info, 0, res)
+end
+
+-- Restarted GMRES for general matrices, with right preconditioning. The
+-- Krylov basis of each cycle, of "restart" vectors, is orthogonalized
+-- with the modified Gram-Schmidt method and the least squares problem is
+-- updated with Givens rotations.
+function sparse.gmres(a, b, opt)
+    local a, n, bv, xm, precond, info = solver_setup(a, b, opt)
+    local x = xm.data
+    local m = min((opt and opt.restart) or 30, n)
+    -- The basis is allocated as a matrix since it can exceed the memory
+    -- available to the FFI allocations. The matrix is referenced up to
+    -- the end so that it is not collected while its data is used.
+    local basis = matrix.alloc(m + 1, n)
+    local V = basis.data
+    local H = double_array((m + 1) * m)
+    local cs, sn, g, y = double_array(m), double_array(m), double_array(m + 1), double_array(m)
+    local w, z = double_array(n), double_array(n)
+    local bnorm = norm(n, bv)
+    if bnorm == 0 then bnorm = 1 end
+
+    local iter, res = 0, 0
+    while true do
+        matvec(a, x, w)
+        for i = 0, n - 1 do w[i] = bv[i] - w[i] end
+        local beta = norm(n, w)
+        res = beta / bnorm
+        if res <= info.tol or iter >= info.maxiter then break end
+
+        for i = 0, n - 1 do V[i] = w[i] / beta end
+        for i = 1, m do g[i] = 0 end
+        g[0] = beta
+
+        local k = 0
+        for j = 0, m - 1 do
+            local vj = V + j * n
+            precond(vj, z)
+            matvec(a, z, w)
+            for i = 0, j do
+                local vi = V + i * n
+                local h = dot(n, w, vi)
+                H[i * m + j] = h
+                for l = 0, n - 1 do w[l] = w[l] - h * vi[l] end
+            end
+            local hnext = norm(n, w)
+            if hnext > 0 then
+                local vnext = V + (j + 1) * n
+                for l = 0, n - 1 do vnext[l] = w[l] / hnext end
+            end
+
+            for i = 0, j - 1 do
+                local h1, h2 = H[i * m + j], H[(i + 1) * m + j]
+                H[i * m + j]       =  cs[i] * h1 + sn[i] * h2
+                H[(i + 1) * m + j] = -sn[i] * h1 + cs[i] * h2
+            end
+            local hjj = H[j * m + j]
+            local d = sqrt(hjj * hjj + hnext * hnext)
+            cs[j], sn[j] = hjj / d, hnext / d
+            H[j * m + j] = d
+            g[j + 1] = -sn[j] * g[j]
+            g[j] = cs[j] * g[j]
+
+            iter, k = iter + 1, j + 1
+            res = abs(g[j + 1]) / bnorm
+            if res <= info.tol or iter >= info.maxiter or hnext == 0 then break end
+        end
+
+        for i = k - 1, 0, -1 do
+            local s = g[i]
+            for l = i + 1, k - 1 do s = s - H[i * m + l] * y[l] end
+            y[i] = s / H[i * m + i]
+        end
+        for l = 0, n - 1 do w[l] = 0 end
+        for i = 0, k - 1 do
+            local vi, yi = V + i * n, y[i]
+            for l = 0, n - 1 do w[l] = w[l] + yi * vi[l] end
+        end
+        precond(w, z)
+        for l = 0, n - 1 do x[l] = x[l] + z[l] end
+    end
+    basis = nil
+    return solver_result(xm, info, iter, res)
+end
+
+local register_ffi_type = debug.getregistry().__gsl_reg_ffi_type
+register_ffi_type(sparse_matrix, "sparse matrix")
+
+return sparse
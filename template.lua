@@ -3,6 +3,8 @@
 -- Adapted by Steve Donovan, based on original code of Rici Lake.
 --
 
+local bit = require 'bit'
+
 local M = {}
 
 -------------------------------------------------------------------------------
@@ -76,10 +78,15 @@ local function read_file(filename)
    return content
 end
 
+-- List of the {filename, content} of the files read while processing a
+-- template, used to validate the entries of the disk cache.
+local sources
+
 local function process(name, defs)
    local filename, errmsg = package.searchpath(name, package.path)
    if not filename then error(errmsg) end
    local template = read_file(filename)
+   if sources then sources[#sources+1] = {filename, template} end
    local codegen = preprocess(template, 'template_gen', defs)
    local code = {}
    local add = function(s) code[#code+1] = s end
@@ -95,15 +102,199 @@ local function template_error(code, filename, err)
    error('error loading ' .. filename .. ':' .. err)
 end
 
-local function load(filename, defs)
+-------------------------------------------------------------------------------
+-- Cache of the compiled templates. The chunks are stored in memory keyed
+-- by the template name and a canonical serialization of the definitions
+-- and, if a cache directory is given, on disk as LuaJIT bytecode. Since
+-- the chunk is executed at each load the objects it creates are never
+-- shared.
+
+local CACHE_LIMIT = 256
+local CACHE_MAGIC = 'gsl-shell template cache 1'
+
+local cache, cache_keys, cache_count = {}, {}, 0
+local cache_dir = os.getenv('GSL_SHELL_TEMPLATE_CACHE')
+local stats = {hits= 0, disk_hits= 0, misses= 0, uncached= 0, compile_time= 0}
+
+-- Return the serialization of "x" or nil if the value cannot be
+-- represented, like a function or a cdata object.
+local function serialize(x, visited)
+   local tp = type(x)
+   if tp == 'number' then
+      return string.format('%.17g', x)
+   elseif tp == 'string' then
+      return string.format('%q', x)
+   elseif tp == 'boolean' then
+      return tostring(x)
+   elseif tp == 'table' then
+      if visited[x] then return nil end
+      visited[x] = true
+      local ls = {}
+      for k, v in pairs(x) do
+         local ks, vs = serialize(k, visited), serialize(v, visited)
+         if not ks or not vs then return nil end
+         ls[#ls+1] = ks .. '=' .. vs
+      end
+      visited[x] = nil
+      table.sort(ls)
+      return '{' .. table.concat(ls, ',') .. '}'
+   end
+end
+
+local function hash(s)
+   local h = 5381
+   for i = 1, #s do h = bit.tobit(h * 33 + string.byte(s, i)) end
+   return bit.tohex(h)
+end
+
+local function cache_store(key, f)
+   if cache_count >= CACHE_LIMIT then
+      local old = table.remove(cache_keys, 1)
+      cache[old] = nil
+      cache_count = cache_count - 1
+   end
+   cache[key] = f
+   cache_keys[#cache_keys+1] = key
+   cache_count = cache_count + 1
+end
+
+local function cache_filename(name, key)
+   local base = string.gsub(name, '[^%w_-]', '_')
+   return string.format('%s/%s-%s.ljbc', cache_dir, base, hash(key))
+end
+
+-- The cache files are a sequence of fields, each written as its length
+-- followed by a newline and the content: the magic string, the LuaJIT
+-- version, the key, the number of source files, the name and hash of
+-- each file and finally the bytecode.
+local function disk_read(name, key)
+   local f = io.open(cache_filename(name, key), 'rb')
+   if not f then return nil end
+   local content = f:read('*a')
+   f:close()
+
+   local pos = 1
+   local function field()
+      local nl = string.find(content, '\n', pos, true)
+      local len = nl and tonumber(string.sub(content, pos, nl - 1))
+      if not len or nl + len > #content then return nil end
+      pos = nl + 1 + len
+      return string.sub(content, nl + 1, nl + len)
+   end
+
+   if field() ~= CACHE_MAGIC or field() ~= jit.version or field() ~= key then
+      return nil
+   end
+   local n = tonumber(field())
+   if not n then return nil end
+   for i = 1, n do
+      local filename, h = field(), field()
+      local src = filename and io.open(filename)
+      if not src then return nil end
+      local template = src:read('*a')
+      src:close()
+      if hash(template) ~= h then return nil end
+   end
+   -- a truncated or damaged file is not loaded, the bytecode is not
+   -- checked by LuaJIT
+   local bc = field()
+   if not bc or pos ~= #content + 1 then return nil end
+   return loadstring(bc, name)
+end
+
+-- The file is written with a temporary name and then renamed so that
+-- a concurrent or interrupted write never leaves a partial file.
+local function disk_write(name, key, f, files)
+   local ok, bc = pcall(string.dump, f)
+   if not ok then return end
+   local filename = cache_filename(name, key)
+   local tmpname = string.format('%s.%s.tmp', filename, hash(tostring({}) .. os.time() .. os.clock()))
+   local out = io.open(tmpname, 'wb')
+   if not out then return end
+   local written = true
+   local function field(s)
+      written = written and out:write(#s, '\n', s) and true
+   end
+   field(CACHE_MAGIC)
+   field(jit.version)
+   field(key)
+   field(tostring(#files))
+   for _, p in ipairs(files) do
+      field(p[1])
+      field(hash(p[2]))
+   end
+   field(bc)
+   written = out:close() and written
+   if not (written and os.rename(tmpname, filename)) then
+      os.remove(tmpname)
+   end
+end
+
+local function compile(filename, defs)
    local code = process(filename, defs)
    local f, err = loadstring(code, filename)
    if not f then template_error(code, filename, err) end
+   return f
+end
+
+local function load(filename, defs)
+   local sdefs = not defs._self and serialize(defs, {})
+   if not sdefs then
+      stats.uncached = stats.uncached + 1
+      return compile(filename, defs)()
+   end
+
+   local key = filename .. ':' .. sdefs
+   local f = cache[key]
+   if f then
+      stats.hits = stats.hits + 1
+      return f()
+   end
+
+   local t0 = os.clock()
+   f = cache_dir and disk_read(filename, key)
+   if f then
+      stats.disk_hits = stats.disk_hits + 1
+   else
+      stats.misses = stats.misses + 1
+      if cache_dir then sources = {} end
+      local ok, r = pcall(compile, filename, defs)
+      local files = sources
+      sources = nil
+      if not ok then error(r, 0) end
+      f = r
+      if cache_dir then disk_write(filename, key, f, files) end
+   end
+   stats.compile_time = stats.compile_time + (os.clock() - t0)
+   cache_store(key, f)
    return f()
 end
 
+-- Return a table with the number of loads served from memory, from the
+-- disk cache, compiled from the template and not cacheable, and the
+-- time in seconds spent to prepare the code.
+local function cache_stats()
+   local t = {}
+   for k, v in pairs(stats) do t[k] = v end
+   return t
+end
+
+local function cache_clear()
+   cache, cache_keys, cache_count = {}, {}, 0
+end
+
+-- Set the directory of the disk cache, false to disable it, and return
+-- the previous one.
+local function set_cache_dir(dir)
+   local old = cache_dir
+   cache_dir = dir or nil
+   return old
+end
+
 M.process = process
 M.load = load
+M.cache_stats = cache_stats
+M.cache_clear = cache_clear
+M.cache_dir = set_cache_dir
 
 return M
-
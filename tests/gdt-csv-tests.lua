@@ -0,0 +1,81 @@
+-- Test of the native CSV reader against the reader written in Lua.
+
+local function write_file(content)
+   local filename = os.tmpname()
+   local f = assert(io.open(filename, 'w'))
+   f:write(content)
+   f:close()
+   return filename
+end
+
+local function same_table(a, b)
+   local r, c = a:dim()
+   local rb, cb = b:dim()
+   assert(r == rb and c == cb, 'different table sizes')
+   for j = 1, c do
+      assert(a:header(j) == b:header(j), 'different header ' .. j)
+      for i = 1, r do
+         assert(a:get(i, j) == b:get(i, j), string.format('different value at (%d, %d)', i, j))
+      end
+   end
+end
+
+local cases = {
+   -- headers with numbers, strings and missing values
+   'name,x,y\nfoo,1,2.5\nbar, 3 ,\n"baz, qux",-4e3,0x10\n',
+   -- no headers as the first line has numbers
+   '1,2,3\n4,5,6\n',
+   -- all strings with the first line repeated in the columns
+   'a,b\na,c\nd,b\n',
+   -- quoted fields with doubled quotes and text after the closing quote
+   'h1,h2\n"say ""hi""",x\n"a"b,2\n',
+   -- rows of different length and CRLF line endings
+   'a,b,c\r\n1,2\r\n3,4,5,6\r\n',
+   -- no newline at the end of the file
+   'a,b\n1,2',
+}
+
+for k, content in ipairs(cases) do
+   local filename = write_file(content)
+   for _, layout in ipairs {'row', 'column'} do
+      local t_native = gdt.read_csv(filename, {layout= layout})
+      local t_lua = gdt.read_csv(filename, {native= false})
+      same_table(t_native, t_lua)
+   end
+   -- the Lua reader keeps the carriage returns if the spaces are not
+   -- stripped
+   if not content:find('\r') then
+      local t_strip = gdt.read_csv(filename, {strip_spaces= false})
+      local t_strip_lua = gdt.read_csv(filename, {strip_spaces= false, native= false})
+      same_table(t_strip, t_strip_lua)
+   end
+   os.remove(filename)
+end
+
+-- the rows are read the same way when they are divided among threads
+do
+   local lines = {'id,name,value'}
+   for i = 1, 5000 do
+      lines[#lines+1] = string.format('%d,"item %d",%g', i, i % 17, i / 7)
+   end
+   local filename = write_file(table.concat(lines, '\n') .. '\n')
+   same_table(gdt.read_csv(filename, {threads= 4}), gdt.read_csv(filename, {native= false}))
+   os.remove(filename)
+end
+
+-- the native reader skips the empty lines and an empty file gives an
+-- empty table
+do
+   local filename = write_file('\na,b\n\n1,2\n\n3,4\n')
+   local t = gdt.read_csv(filename)
+   local r, c = t:dim()
+   assert(r == 2 and c == 2 and t:get(2, 2) == 4)
+   os.remove(filename)
+
+   filename = write_file('')
+   local r, c = gdt.read_csv(filename):dim()
+   assert(r == 0 and c == 0)
+   os.remove(filename)
+end
+
+print("Test complete.")
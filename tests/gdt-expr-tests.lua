@@ -0,0 +1,90 @@
+-- Test of the compiled gdt expressions: the results are compared with
+-- the ones of expr_print.eval for random expressions and for expressions
+-- with many constants or a deep nesting.
+
+local gdt_expr = require 'gdt-expr'
+local expr_print = require 'expr-print'
+
+local N = 40
+local t = gdt.new(N, 3)
+t:set_header(1, 'x')
+t:set_header(2, 'y')
+t:set_header(3, 'z')
+for i = 1, N do
+   t:set(i, 1, i / 8)
+   t:set(i, 2, i % 7 - 3)
+   -- the column z has undefined values
+   if i % 5 ~= 0 then t:set(i, 3, 2 - i / 16) end
+end
+
+local function same(a, b)
+   return a == b or (not (a <= math.huge) and not (b <= math.huge))
+end
+
+-- the rows are evaluated many times so that the loop is compiled by the
+-- JIT compiler
+local function check(e, name, passes)
+   local f = gdt_expr.compile(t, e)
+   for pass = 1, passes or 1 do
+      for i = 1, N do
+         local a, b = f(i), expr_print.eval(e, gdt_expr.table_scope, t, i)
+         assert((a == nil and b == nil) or (a and b and same(a, b)), name .. ': wrong value at row ' .. i)
+      end
+   end
+end
+
+-- the division and the power are left out of the random expressions
+-- since their result depends on the sign of zero, that the compiled
+-- traces may not preserve
+local operators = {'+', '-', '*', '=', '!=', '>', '<', '>=', '<=', 'and', 'or'}
+local leaves = {'x', 'y', 'z', 2, 0.5, -3}
+
+local function random_expr(depth)
+   local r = math.random()
+   if depth == 0 or r < 0.2 then
+      return leaves[math.random(#leaves)]
+   elseif r < 0.3 then
+      return {random_expr(depth - 1)}
+   elseif r < 0.35 then
+      return {func = 'exp', arg = random_expr(depth - 1)}
+   else
+      local op = operators[math.random(#operators)]
+      return {operator = op, random_expr(depth - 1), random_expr(depth - 1)}
+   end
+end
+
+math.randomseed(7)
+for k = 1, 300 do
+   check(random_expr(6), 'random ' .. k)
+end
+
+-- precedence and associativity of the division and of the power
+local x, y, z = 'x', 'y', 'z'
+local function op(o, a, b) return {operator = o, a, b} end
+check(op('^', op('^', x, 2), z), 'power left')
+check(op('^', x, op('^', 0.5, x)), 'power right')
+check(op('^', {x}, 2), 'power of negative')
+check({op('^', x, 2)}, 'negative power')
+check(op('^', 2, {x}), 'power with negative exponent')
+check(op('/', op('/', x, 2), z), 'division left')
+check(op('/', x, op('*', 2, z)), 'division right')
+check(op('-', x, op('-', y, z)), 'subtraction right')
+check(op('*', op('+', x, y), {op('-', z, 2)}), 'sum product', 100)
+check({{x}}, 'double negation')
+check(op('^', op('<', x, 2), op('+', x, 1)), 'power of comparison')
+
+-- more constants than the upvalues of a function and more terms than
+-- its local variables
+local e = 'x'
+for k = 1, 300 do e = {operator = '+', e, {operator = '*', k, 'y'}} end
+check(e, 'constants')
+
+-- an expression too deeply nested for the Lua parser is evaluated
+-- without compiling it
+local d = 'z'
+for k = 1, 500 do d = {operator = '-', 1, {d}} end
+check(d, 'nested')
+
+assert(not pcall(gdt_expr.compile, t, {operator = '+', 'x', 'w'}), 'invalid column not detected')
+
+print("Test complete.")
@@ -0,0 +1,102 @@
+-- Test of the integration routines: the vector interface of QAG and
+-- QNG gives the same results as the scalar one and num.integ_many the
+-- same integrals as separate calls of num.integ.
+
+local sin, cos, exp, sqrt, abs = math.sin, math.cos, math.exp, math.sqrt, math.abs
+
+-- integrands with their integral on [0, 3]
+local functions = {
+   {f= function(x) return sin(x) * exp(-x) end, I= 0.5 * (1 - exp(-3) * (sin(3) + cos(3)))},
+   {f= function(x) return sqrt(x) end, I= 2 * sqrt(3)},
+   {f= function(x) return 1 / (1 + 25*x*x) - 0.5 end, I= math.atan(15) / 5 - 1.5},
+   {f= function(x) return cos(12*x) end, I= sin(36) / 12},
+}
+
+local function integrators(method, order)
+   local q = num.quad_prepare {method= method, order= order}
+   local qv = num.quad_prepare {method= method, order= order, vector= true}
+   return q, qv
+end
+
+-- the vector interface gives the same results, errors and number of
+-- evaluations and the error estimate bounds the actual error
+for _, spec in ipairs {{'qag', 15}, {'qag', 21}, {'qag', 31}, {'qag', 61}, {'qng', 21}} do
+   local method, order = spec[1], spec[2]
+   local q, qv = integrators(method, order)
+   for i, fn in ipairs(functions) do
+      local name = string.format('%s %d function %d', method, order, i)
+      local f, ns, nv = fn.f, 0, 0
+      local fs = function(x) ns = ns + 1; return f(x) end
+      local fv = function(xs, n, ys)
+         nv = nv + n
+         for k = 0, n - 1 do ys[k] = f(xs[k]) end
+      end
+      for _, eps in ipairs {1e-6, 1e-10} do
+         local ok, r, e = pcall(q, fs, 0, 3, eps, eps)
+         local okv, rv, ev = pcall(qv, fv, 0, 3, eps, eps)
+         assert(ok == okv and ns == nv, name .. ': scalar and vector evaluations differ')
+         if ok then
+            assert(r == rv and e == ev, name .. ': scalar and vector results differ')
+            assert(abs(r - fn.I) <= e, name .. ': error underestimated')
+         end
+      end
+   end
+end
+
+-- the integrands x^j cos(x) for j = 0 to M-1
+local M = 4
+
+local function moments(xs, n, ys)
+   for i = 0, n - 1 do
+      local x = xs[i]
+      local y = cos(x)
+      for j = 0, M - 1 do
+         ys[j*n + i] = y
+         y = y * x
+      end
+   end
+end
+
+local function moment(j)
+   return function(x) return x^j * cos(x) end
+end
+
+local eps = 1e-10
+
+local function check_many(a, b)
+   local r, e = num.integ_many(moments, M, a, b, eps, eps)
+   local L = select(2, r:dim())
+   for k = 1, L do
+      local ak = type(a) == 'number' and a or a[k]
+      local bk = type(b) == 'number' and b or b[k]
+      for j = 0, M - 1 do
+         local ref = num.integ(moment(j), ak, bk, eps, eps)
+         local tol = 10 * eps * math.max(1, abs(ref))
+         local name = string.format('integral %d on [%g, %g]', j, ak, bk)
+         assert(abs(r:get(j+1, k) - ref) <= tol, name .. ': wrong result')
+         assert(e:get(j+1, k) <= math.max(eps, eps * abs(ref)), name .. ': tolerance not reached')
+      end
+   end
+   return r
+end
+
+check_many(0, 5)
+check_many(0, matrix.new(10, 1, |i| i))
+
+-- overlapping and reversed intervals, sharing some limits, and an
+-- empty one
+local a = matrix.vec {0, 1, 4, 2.5, 3, -1, 2}
+local b = matrix.vec {3, 4, 1, 0.5, 3, 2, 5}
+local r = check_many(a, b)
+for j = 1, M do assert(r:get(j, 5) == 0) end
+
+-- reversing all the intervals changes the sign of the results
+local rr = num.integ_many(moments, M, b, a, eps, eps)
+for j = 1, M do
+   for k = 1, #a do assert(rr:get(j, k) == -r:get(j, k)) end
+end
+
+assert(not pcall(num.integ_many, moments, M, matrix.vec {0, 1}, matrix.vec {1, 2, 3}))
+assert(not pcall(num.integ_many, moments, 0, 0, 1))
+
+print("Test complete.")
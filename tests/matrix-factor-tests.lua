@@ -0,0 +1,106 @@
+-- Test of the factorization objects: the solutions, determinants and
+-- inverses are compared with known values.
+
+local eps = 1e-10
+
+local function close(a, b, tol)
+   return (a - b):norm() <= (tol or eps) * (1 + b:norm())
+end
+
+-- a diagonally dominant matrix, well conditioned
+local function test_matrix(n1, n2)
+   return matrix.new(n1, n2, |i, j| i == j and n2 + 2 or 1 / (i + 2*j))
+end
+
+local n = 6
+local A = test_matrix(n, n)
+local x = matrix.new(n, 2, |i, j| j == 1 and i or 1 - i*i / 10)
+local b = A * x
+local b1 = matrix.new(n, 1, |i| b:get(i, 1))
+local x1 = matrix.new(n, 1, |i| x:get(i, 1))
+local unit = matrix.unit(n)
+
+local S = A:copy()
+for i = 1, n do
+   for j = 1, n do S:set(i, j, A:get(i, j) + A:get(j, i)) end
+end
+local bs = S * x
+
+local cases = {
+   {name= 'lu',       f= matrix.factor_lu(A),       A= A, b= b},
+   {name= 'cholesky', f= matrix.factor_cholesky(S), A= S, b= bs},
+   {name= 'qr',       f= matrix.factor_qr(A),       A= A, b= b},
+   {name= 'svd',      f= matrix.factor_svd(A),      A= A, b= b},
+}
+
+for _, c in ipairs(cases) do
+   local f = c.f
+   -- solve a column and many columns, storing the result in a given
+   -- matrix
+   local bc = matrix.new(n, 1, |i| c.b:get(i, 1))
+   assert(close(f:solve(bc), x1), c.name .. ': wrong solve')
+   assert(close(f:solve_many(c.b), x), c.name .. ': wrong solve_many')
+   local r = matrix.new(n, 2)
+   assert(rawequal(f:solve_many(c.b, r), r) and close(r, x), c.name .. ': wrong solve_many in place')
+
+   -- the right-hand side is not modified
+   assert(close(bc, c.A * x1), c.name .. ': right-hand side modified')
+
+   assert(close(c.A * f:inv(), unit), c.name .. ': wrong inverse')
+   local d, dref = f:det(), matrix.det(c.A)
+   assert(math.abs(d - dref) <= eps * math.abs(dref), c.name .. ': wrong determinant')
+
+   -- the factorization keeps working after the garbage collection
+   collectgarbage()
+   assert(close(f:solve(bc), x1), c.name .. ': wrong solve after collect')
+
+   assert(not pcall(f.solve, f, matrix.new(n + 1, 1)), c.name .. ': dimensions not checked')
+end
+
+-- the sign of the determinant depends on the permutations and
+-- reflections
+local P = matrix.new(3, 3, |i, j| (i % 3) + 1 == j and 1 or 0)
+for _, factor in ipairs {matrix.factor_lu, matrix.factor_qr, matrix.factor_svd} do
+   assert(math.abs(factor(P):det() - 1) < eps)
+   assert(math.abs(factor(2 * matrix.unit(3)):det() - 8) < eps)
+end
+
+-- least squares solution of an overdetermined system: the residual is
+-- orthogonal to the columns of the matrix
+local m = 9
+local R = test_matrix(m, n)
+local br = matrix.new(m, 1, |i| math.sin(i))
+for _, factor in ipairs {matrix.factor_qr, matrix.factor_svd} do
+   local f = factor(R)
+   local xr = f:solve(br)
+   assert(close(R:transpose() * (R * xr - br), matrix.new(n, 1)), 'residual not orthogonal')
+   -- the pseudo-inverse gives the same solution
+   assert(close(f:inv() * br, xr))
+end
+assert(not pcall(matrix.factor_qr, matrix.new(n, m)))
+
+-- SVD of a rank deficient matrix: the zero singular values are
+-- discarded
+local D = matrix.new(4, 3, |i, j| i == j and (i == 2 and 0 or i) or 0)
+local fd = matrix.factor_svd(D)
+local sv = fd:values()
+assert(close(sv, matrix.new(3, 1, |i| ({3, 1, 0})[i])))
+local xd = fd:solve(matrix.new(4, 1, |i| 1))
+assert(close(xd, matrix.new(3, 1, |i| i == 2 and 0 or 1 / i)))
+
+-- complex LU factorization
+local C = matrix.cnew(3, 3, |i, j| i == j and 4 + 1i or complex.new(1 / (i + j), j - i))
+local xc = matrix.cnew(3, 1, |i| complex.new(i, -i))
+local fc = matrix.factor_lu(C)
+assert(close(fc:solve(C * xc), xc))
+assert(close(C * fc:inv(), matrix.cnew(3, 3, |i, j| i == j and 1 or 0)))
+local dc, dcref = fc:det(), matrix.det(C)
+assert(complex.abs(dc - dcref) <= eps * complex.abs(dcref))
+-- a real factorization does not take a complex right-hand side
+assert(not pcall(matrix.factor_lu(A).solve, matrix.factor_lu(A), matrix.cnew(n, 1)))
+
+-- the Cholesky factorization fails if the matrix is not positive
+-- definite
+assert(not pcall(matrix.factor_cholesky, -1 * S))
+
+print("Test complete.")
@@ -0,0 +1,117 @@
+-- Test of the matrix pool: the storage of the released matrices is
+-- reused, the views keep the storage of a released matrix alive and the
+-- memory kept by the pool follows its limit.
+
+local ffi = require 'ffi'
+
+local function address(m)
+   return tonumber(ffi.cast('intptr_t', m.data))
+end
+
+-- the counters of the pool change only because of the matrices of the
+-- test
+collectgarbage('stop')
+
+local n1, n2 = 37, 53
+local bytes = n1 * n2 * ffi.sizeof('double')
+
+-- the storage of a released matrix is used by the next matrix of the
+-- same size
+local a = matrix.new(n1, n2)
+local s0 = matrix.pool_stats()
+local addr = address(a)
+matrix.release(a)
+local s1 = matrix.pool_stats()
+assert(s1.bytes_in_use <= s0.bytes_in_use - bytes and s1.cached_bytes >= s0.cached_bytes + bytes)
+local b = matrix.new(n1, n2, |i, j| i + j)
+local s2 = matrix.pool_stats()
+assert(address(b) == addr, 'storage not reused')
+assert(s2.hits == s1.hits + 1 and s2.requests == s1.requests + 1)
+assert(s2.bytes_in_use == s0.bytes_in_use)
+assert(s2.peak_bytes >= s2.bytes_in_use)
+
+-- a released matrix is empty, any access raises an error and it can be
+-- released again
+assert(a:dim() == 0 and #a == 0)
+assert(not pcall(a.get, a, 1, 1))
+assert(not pcall(a.set, a, 1, 1, 0))
+matrix.release(a)
+
+-- the views keep the storage alive: it is given back to the pool when
+-- the matrix and all its views are released
+local s3 = matrix.pool_stats()
+local row, sl = b:row(2), b:slice(3, 4, 5, 6)
+matrix.release(b)
+assert(matrix.pool_stats().bytes_in_use == s3.bytes_in_use, 'storage released with live views')
+assert(row:get(1, 7) == 2 + 7 and sl:get(5, 6) == 7 + 9)
+row:set(1, 1, -1)
+assert(row:get(1, 1) == -1)
+matrix.release(row)
+assert(sl:get(1, 1) == 3 + 4)
+assert(matrix.pool_stats().bytes_in_use == s3.bytes_in_use)
+matrix.release(sl)
+assert(matrix.pool_stats().bytes_in_use <= s3.bytes_in_use - bytes)
+
+-- the matrices collected by the garbage collector give back their
+-- storage too
+local s4 = matrix.pool_stats()
+do local c = matrix.new(n1, n2) end
+collectgarbage()
+collectgarbage('stop')
+assert(matrix.pool_stats().bytes_in_use <= s4.bytes_in_use)
+
+-- with a zero limit the pool keeps no memory, the storage of a released
+-- matrix is not reused and trim empties the pool
+matrix.pool_limit(0)
+local s5 = matrix.pool_stats()
+assert(s5.cached_bytes == 0 and s5.cached_limit == 0)
+local c = matrix.new(n1, n2)
+matrix.release(c)
+assert(matrix.pool_stats().cached_bytes == 0)
+local s6 = matrix.pool_stats()
+local d = matrix.new(n1, n2)
+assert(matrix.pool_stats().hits == s6.hits)
+matrix.release(d)
+
+matrix.pool_limit(256 * 2^20)
+local e, f = matrix.new(n1, n2), matrix.new(2 * n1, n2)
+matrix.release(e)
+matrix.release(f)
+assert(matrix.pool_stats().cached_bytes >= 3 * bytes)
+matrix.pool_trim()
+local s7 = matrix.pool_stats()
+assert(s7.cached_bytes == 0 and s7.cached_limit == 256 * 2^20)
+local g = matrix.new(n1, n2)
+assert(matrix.pool_stats().hits == s7.hits)
+
+-- a lower limit empties the pool if it keeps more memory
+matrix.release(g)
+assert(matrix.pool_stats().cached_bytes >= bytes)
+matrix.pool_limit(bytes / 2)
+assert(matrix.pool_stats().cached_bytes == 0)
+matrix.pool_limit(256 * 2^20)
+
+-- the peak can be set to the current use
+matrix.pool_reset_peak()
+local s8 = matrix.pool_stats()
+assert(s8.peak_bytes == s8.bytes_in_use)
+
+-- the matrices registered in a scope are released when it exits, also
+-- with an error, and the other ones are not
+local kept
+local r = matrix.scope(function(tmp, x)
+   local t = tmp(x * 2)
+   kept = matrix.new(n1, n2, |i, j| t:get(i, j))
+   return kept
+end, matrix.new(n1, n2, |i, j| i * j))
+assert(rawequal(r, kept) and kept:get(2, 3) == 12)
+local t
+assert(not pcall(matrix.scope, function(tmp)
+   t = tmp(matrix.new(n1, n2))
+   error('failed')
+end))
+assert(t:dim() == 0)
+
+collectgarbage('restart')
+
+print("Test complete.")
@@ -0,0 +1,109 @@
+-- Test of the native sort, argsort and order statistics of matrices,
+-- with NaN values mixed with the numbers.
+
+local ffi = require 'ffi'
+
+-- the constant expression 0/0 is folded to an integer by LuaJIT when it
+-- is built with -ffast-math, and its compiled traces then give x ~= x
+-- as false for NaN. The NaN are made and detected by their bits so that
+-- the test does not depend on the build flags.
+local nan = math.huge - math.huge
+
+local bits = ffi.new('union { double d; uint64_t u; }')
+
+local function is_nan(x)
+   bits.d = x
+   return bits.u % 0x8000000000000000ULL > 0x7ff0000000000000ULL
+end
+
+assert(is_nan(nan) and not is_nan(math.huge) and not is_nan(-math.huge) and not is_nan(1))
+
+-- a column of n numbers, with ties, and a NaN every "nan_every" elements
+local function sample(n, nan_every)
+   local vs = {}
+   local x = 12345
+   for i = 1, n do
+      x = (x * 1103515245 + 12345) % 2147483648
+      vs[i] = (i % nan_every == 0) and nan or (x % 97) - 48
+   end
+   return vs
+end
+
+local function sorted_numbers(vs)
+   local t = {}
+   for _, v in ipairs(vs) do
+      if not is_nan(v) then t[#t+1] = v end
+   end
+   table.sort(t)
+   return t
+end
+
+local function check_sorted(m, j, vs)
+   local ref = sorted_numbers(vs)
+   local n = #vs
+   for i = 1, n do
+      local x = m:get(i, j)
+      if i <= #ref then
+         assert(x == ref[i], string.format('sort: wrong element %d', i))
+      else
+         assert(is_nan(x), string.format('sort: NaN expected at %d', i))
+      end
+   end
+end
+
+for _, n in ipairs {1, 7, 16, 17, 100, 1000} do
+   for _, nan_every in ipairs {2, 5, 1000000} do
+      local vs = sample(n, nan_every)
+
+      -- single column
+      local m = matrix.new(n, 1, |i| vs[i])
+      m:sort()
+      check_sorted(m, 1, vs)
+
+      -- the columns of a matrix are sorted separately using the stride
+      local m2 = matrix.new(n, 2, |i, j| j == 1 and vs[i] or -vs[i])
+      m2:sort()
+      check_sorted(m2, 1, vs)
+      local neg = {}
+      for i = 1, n do neg[i] = -vs[i] end
+      check_sorted(m2, 2, neg)
+
+      -- argsort gives the numbers in order, with equal elements in
+      -- the order of their indexes, followed by the NaN in the order of
+      -- their indexes
+      local p = matrix.new(n, 1, |i| vs[i]):argsort()
+      local ref = sorted_numbers(vs)
+      for i = 2, n do
+         local a, b = p:get(i - 1, 1), p:get(i, 1)
+         local va, vb = vs[a], vs[b]
+         if is_nan(va) then
+            assert(is_nan(vb) and a < b, 'argsort: wrong order of NaN')
+         elseif not is_nan(vb) then
+            assert(va < vb or (va == vb and a < b), 'argsort: wrong order')
+         end
+      end
+      for i = 1, #ref do assert(vs[p:get(i, 1)] == ref[i]) end
+
+      -- order statistics ignore the NaN values when there are enough
+      -- numbers
+      local q = matrix.new(n, 1, |i| vs[i])
+      if #ref > 0 then
+         assert(matrix.quantile(q, 0) == ref[1], 'quantile(0) should be the minimum')
+         assert(matrix.nth_element(q, 1) == ref[1])
+         assert(matrix.nth_element(q, #ref) == ref[#ref])
+         local k = math.floor((#ref + 1) / 2)
+         assert(matrix.nth_element(q, k) == ref[k])
+      end
+      if #ref == n then
+         local index = 0.3 * (n - 1)
+         local lhs = math.floor(index)
+         local delta = index - lhs
+         local x = ref[lhs + 1]
+         if delta > 0 then x = (1 - delta) * x + delta * ref[lhs + 2] end
+         assert(math.abs(matrix.quantile(q, 0.3) - x) < 1e-12, 'wrong quantile')
+         assert(matrix.quantile(q, 1) == ref[n])
+      end
+   end
+end
+
+print("Test complete.")
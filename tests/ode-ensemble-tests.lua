@@ -0,0 +1,83 @@
+-- Test of the ODE ensembles: the trajectories integrated by the calling
+-- state and by the workers are the same and agree with the ones of
+-- separate num.ode solvers.
+
+local abs, exp, max = math.abs, math.exp, math.max
+
+local vdp_src = 'return function(t, x, v) return v, -x - 0.1 * v * (x*x - 1) end'
+local vdp = loadstring(vdp_src)()
+
+local K, eps = 37, 1e-9
+local y0 = matrix.new(K, 2, |l, i| i == 1 and 1 or l / K)
+
+local function max_diff(a, b)
+   local d = 0
+   for l = 1, K do
+      for i = 1, 2 do d = max(d, abs(a:get(l, i) - b:get(l, i))) end
+   end
+   return d
+end
+
+-- each trajectory integrated by its own solver, stopping at the same
+-- times as the ensemble
+local ref = matrix.new(K, 2)
+for l = 1, K do
+   local s = num.ode {N= 2, eps_abs= eps}
+   s:init(0, 0.01, vdp, y0:get(l, 1), y0:get(l, 2))
+   for _, t1 in ipairs {5, 10} do
+      while s.t < t1 do s:step(t1) end
+   end
+   ref:set(l, 1, s.y[1])
+   ref:set(l, 2, s.y[2])
+end
+
+local function ensemble(workers, f, batch)
+   local e = num.ode_ensemble {N= 2, K= K, eps_abs= eps, workers= workers, batch= batch}
+   e:init(0, 0.01, f, y0)
+   e:evolve(5)
+   e:evolve(10)
+   for l = 1, K do assert(e.t[l] == 10) end
+   return e, e:solution()
+end
+
+-- the ensemble steps are chosen as the ones of num.ode but the last
+-- step before each stop is handled differently so the solutions agree
+-- within the integration error
+local _, serial = ensemble(1, vdp)
+assert(max_diff(serial, ref) < 1e-7, 'ensemble and num.ode differ')
+
+-- a function given as a string is compiled also without workers and
+-- the workers compute exactly the same trajectories, also with a batch
+-- size that does not divide the number of trajectories
+local _, y = ensemble(1, vdp_src)
+assert(max_diff(y, serial) == 0, 'wrong ensemble with a string function')
+for _, w in ipairs {2, 3} do
+   for _, batch in ipairs {1, 5, K} do
+      local _, y = ensemble(w, vdp_src, batch)
+      assert(max_diff(y, serial) == 0, string.format('wrong ensemble with %d workers', w))
+   end
+end
+
+-- init with the same code keeps the pool of workers, with a new code
+-- the pool is created again
+local e = ensemble(2, vdp_src)
+local pool = e.pool
+e:init(0, 0.01, vdp_src, y0)
+assert(rawequal(e.pool, pool), 'pool created again with the same code')
+e:init(0, 0.01, 'return function(t, x, v) return -x, -2*v end', y0)
+assert(not rawequal(e.pool, pool), 'pool not created again with a new code')
+e:evolve(2)
+local y = e:solution()
+for l = 1, K do
+   local x0, v0 = y0:get(l, 1), y0:get(l, 2)
+   assert(abs(y:get(l, 1) - x0 * exp(-2)) < 1e-7 and abs(y:get(l, 2) - v0 * exp(-4)) < 1e-7,
+          'the workers do not use the new code')
+end
+
+-- the workers need the function as Lua code
+local e = num.ode_ensemble {N= 2, K= K, eps_abs= eps, workers= 2}
+assert(not pcall(e.init, e, 0, 0.01, vdp, y0))
+assert(not pcall(e.evolve, e, 1))
+assert(not pcall(e.init, e, 0, 0.01, vdp_src, matrix.new(K, 3)))
+
+print("Test complete.")
@@ -0,0 +1,87 @@
+-- Test of the dense output of the ODE solvers: the values given by
+-- sample() are compared with the ones of evolve() and with the exact
+-- solution of the harmonic oscillator.
+
+local cos, sin, abs, max = math.cos, math.sin, math.abs, math.max
+
+local nf = 0
+local function f(t, x, v)
+   nf = nf + 1
+   return v, -x
+end
+
+local function new_solver(method, tol)
+   local s = num.ode {N= 2, eps_abs= tol, eps_rel= tol, method= method}
+   s:init(0, 0.01, f, 1, 0)
+   return s
+end
+
+local t1, dt = 20, 0.01
+
+for _, method in ipairs {'rkf45', 'rk8pd', 'rosenbrock'} do
+   for _, tol in ipairs {1e-6, 1e-10} do
+      local name = string.format('%s %g', method, tol)
+
+      -- the solution is sampled at the times given by evolve
+      nf = 0
+      local tev, xs, vs = {}, {}, {}
+      local s = new_solver(method, tol)
+      for t, x, v in s:evolve(t1, dt) do
+         tev[#tev+1], xs[#xs+1], vs[#vs+1] = t, x, v
+      end
+      local nf_evolve = nf
+      local n = #tev
+      local ts = matrix.new(n, 1, |i| tev[i])
+      local tn = ts[n]
+
+      nf = 0
+      s = new_solver(method, tol)
+      local y = s:sample(ts)
+      assert(nf < nf_evolve, name .. ': sample should take fewer steps than evolve')
+      assert(s.t == tn, name .. ': sample should stop at the last time')
+
+      -- the interpolation error is of the order of the integration
+      -- error, given by the one at the last step
+      local e_end = abs(s.y[1] - cos(tn))
+      local bound = 5 * e_end + 10 * tol
+      for i = 1, n do
+         local t = ts[i]
+         local x, v = y:get(i, 1), y:get(i, 2)
+         assert(abs(x - cos(t)) <= bound and abs(v + sin(t)) <= bound, name .. ': wrong sample value')
+         assert(abs(x - xs[i]) <= bound and abs(v - vs[i]) <= bound, name .. ': sample and evolve differ')
+      end
+      assert(y:get(1, 1) == 1 and y:get(1, 2) == 0, name .. ': wrong value at the initial time')
+
+      -- the values given to the callback and stored in a given matrix are
+      -- the same
+      s = new_solver(method, tol)
+      local k = 0
+      s:sample(ts, function(t, x, v)
+         k = k + 1
+         assert(t == ts[k] and x == y:get(k, 1) and v == y:get(k, 2), name .. ': wrong callback value')
+      end)
+      assert(k == n)
+
+      s = new_solver(method, tol)
+      local out = matrix.new(n, 2)
+      assert(rawequal(s:sample(ts, out), out))
+      for i = 1, n do assert(out:get(i, 1) == y:get(i, 1)) end
+
+      -- the integration can continue after sample, also with repeated
+      -- sampling times
+      local ts2 = matrix.new(4, 1, |i| tn + ({0, 0.5, 0.5, 2})[i])
+      local y2 = s:sample(ts2)
+      assert(y2:get(2, 1) == y2:get(3, 1))
+      for i = 1, 4 do assert(abs(y2:get(i, 1) - cos(ts2[i])) <= 2 * bound) end
+
+      assert(not pcall(s.sample, s, matrix.new(2, 1, |i| tn + 3 - i)), name .. ': decreasing times not detected')
+      assert(not pcall(s.sample, s, ts, matrix.new(n, 3)), name .. ': output dimensions not checked')
+   end
+end
+
+-- the bdf method has no dense output
+local s = num.ode {N= 2, eps_abs= 1e-6, method= 'bdf'}
+s:init(0, 0.01, f, 1, 0)
+assert(not pcall(function() return s:sample(matrix.new(2, 1, |i| i)) end))
+
+print("Test complete.")
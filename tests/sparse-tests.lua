@@ -0,0 +1,86 @@
+-- Test of the sparse matrices and of the iterative solvers: the
+-- solutions are compared with the one of a dense solve.
+
+local sparse = matrix.sparse
+
+local function max_diff(a, b)
+   local n1, n2 = a:dim()
+   local d = 0
+   for i = 1, n1 do
+      for j = 1, n2 do d = math.max(d, math.abs(a:get(i, j) - b:get(i, j))) end
+   end
+   return d
+end
+
+-- discrete Laplacian on a m x m grid, with an optional convection term
+-- that makes it non-symmetric
+local function laplacian(m, convection)
+   local n = m * m
+   local c = sparse.coo(n, n)
+   for i = 1, m do
+      for j = 1, m do
+         local k = (i - 1) * m + j
+         c:add(k, k, 4)
+         if i > 1 then c:add(k, k - m, -1 - convection) end
+         if i < m then c:add(k, k + m, -1 + convection) end
+         if j > 1 then c:add(k, k - 1, -1) end
+         if j < m then c:add(k, k + 1, -1) end
+      end
+   end
+   return c
+end
+
+-- the products agree with the dense ones
+do
+   local c = laplacian(5, 0.3)
+   c:add(7, 7, 0.5)
+   local a = c:tocsr()
+   local d = a:todense()
+   local x = matrix.new(25, 3, |i, j| math.sin(i * j))
+   assert(max_diff(a * x, d * x) < 1e-12)
+   assert(max_diff(c:tocsc() * x, d * x) < 1e-12)
+   assert(max_diff(a:transpose():todense(), matrix.transpose(d)) == 0)
+   assert(max_diff((a * a:tocsc()):todense(), d * d) < 1e-12)
+   assert(max_diff(sparse.from_dense(d):todense(), d) == 0)
+   -- the elements added more than once are summed
+   assert(a:get(7, 7) == 4.5 and math.abs(a:get(7, 2) + 1.3) < 1e-15 and a:get(7, 3) == 0)
+end
+
+local m = 12
+local n = m * m
+local b = matrix.new(n, 1, |i| math.sin(i))
+
+local systems = {
+   {name= 'symmetric', a= laplacian(m, 0):tocsr(), solvers= {'cg', 'bicgstab', 'gmres'}},
+   {name= 'non-symmetric', a= laplacian(m, 0.4):tocsr(), solvers= {'bicgstab', 'gmres'}},
+   {name= 'csc', a= laplacian(m, 0.4):tocsc(), solvers= {'bicgstab', 'gmres'}},
+}
+
+for _, s in ipairs(systems) do
+   local x_dense = matrix.solve(s.a:todense(), b)
+   for _, solver in ipairs(s.solvers) do
+      for _, precond in ipairs {'none', 'jacobi', 'ilu0'} do
+         local x, info = sparse[solver](s.a, b, {precond= precond, tol= 1e-10})
+         local name = string.format('%s %s %s', s.name, solver, precond)
+         assert(info.converged and info.residual <= 1e-10, name .. ': not converged')
+         assert(max_diff(x, x_dense) < 1e-7, name .. ': wrong solution')
+      end
+   end
+
+   -- the initial guess of the solution is used
+   local x, info = sparse.gmres(s.a, b, {x0= x_dense, tol= 1e-8})
+   assert(info.converged and info.iterations <= 1)
+
+   -- a restarted GMRES converges to the same solution
+   local x = sparse.gmres(s.a, b, {restart= 5, tol= 1e-10, maxiter= 10 * n})
+   assert(max_diff(x, x_dense) < 1e-7, s.name .. ': wrong restarted GMRES solution')
+end
+
+-- the solver stops at the maximum number of iterations
+local _, info = sparse.cg(laplacian(m, 0):tocsr(), b, {maxiter= 2})
+assert(not info.converged and info.iterations == 2)
+
+assert(not pcall(sparse.cg, laplacian(m, 0):tocsr(), matrix.new(n + 1, 1)))
+assert(not pcall(sparse.cg, laplacian(m, 0):tocsr(), b, {precond= 'unknown'}))
+
+print("Test complete.")
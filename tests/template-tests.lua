@@ -0,0 +1,137 @@
+-- Test of the cache of the compiled templates: the loads served from
+-- memory or from the disk cache give new objects and a changed template
+-- file, or a damaged cache file, are compiled again.
+
+local template = require 'template'
+
+local function write_file(filename, content)
+   local f = assert(io.open(filename, 'wb'))
+   f:write(content)
+   f:close()
+end
+
+local function read_file(filename)
+   local f = assert(io.open(filename, 'rb'))
+   local content = f:read('*a')
+   f:close()
+   return content
+end
+
+local function list_dir(dir)
+   local p = io.popen('ls ' .. dir)
+   local ls = {}
+   for name in p:lines() do ls[#ls+1] = name end
+   p:close()
+   return ls
+end
+
+-- the templates are in a temporary directory, with the cache files
+local dir = os.tmpname()
+os.remove(dir)
+assert(os.execute('mkdir ' .. dir) == 0)
+local path = package.path
+package.path = dir .. '/?.lua.in;' .. path
+
+write_file(dir .. '/ttest.lua.in', [[
+local obj = {value= $(x)}
+$(include 'ttestinc')
+return obj
+]])
+write_file(dir .. '/ttestinc.lua.in', 'obj.inc = 1\n')
+
+local function count(name)
+   return template.cache_stats()[name]
+end
+
+local old_dir = template.cache_dir(false)
+template.cache_clear()
+
+-- the first load compiles the template, the next ones with the same
+-- definitions are served from memory and give new objects
+local misses, hits = count('misses'), count('hits')
+local a = template.load('ttest', {x= 1})
+local b = template.load('ttest', {x= 1})
+assert(count('misses') == misses + 1 and count('hits') == hits + 1)
+assert(a.value == 1 and b.value == 1 and a.inc == 1)
+assert(a ~= b)
+a.value = 2
+assert(b.value == 1 and template.load('ttest', {x= 1}).value == 1)
+
+-- the definitions are a part of the key, in any order
+local c = template.load('ttest', {x= 3})
+assert(c.value == 3 and count('misses') == misses + 2)
+template.load('ttest', {x= 1, y= {1, 2}})
+template.load('ttest', {y= {1, 2}, x= 1})
+assert(count('misses') == misses + 3)
+
+-- the definitions that cannot be serialized are not cached
+local uncached = count('uncached')
+template.load('ttest', {x= 1, f= print})
+assert(count('uncached') == uncached + 1)
+
+-- the disk cache gives the same objects after the memory cache is
+-- cleared and no temporary file is left
+template.cache_dir(dir)
+template.cache_clear()
+misses = count('misses')
+assert(template.load('ttest', {x= 4}).value == 4)
+assert(count('misses') == misses + 1)
+local cached
+for _, name in ipairs(list_dir(dir)) do
+   assert(not name:find('%.tmp$'), 'temporary cache file left')
+   if name:find('%.ljbc$') then
+      assert(not cached)
+      cached = dir .. '/' .. name
+   end
+end
+assert(cached, 'cache file not written')
+
+template.cache_clear()
+local disk_hits = count('disk_hits')
+local d1 = template.load('ttest', {x= 4})
+template.cache_clear()
+local d2 = template.load('ttest', {x= 4})
+assert(count('disk_hits') == disk_hits + 2 and count('misses') == misses + 1)
+assert(d1.value == 4 and d1.inc == 1 and d1 ~= d2)
+
+-- a truncated cache file is compiled again and written again
+local content = read_file(cached)
+for _, len in ipairs {#content - 1, math.floor(#content / 2), 3, 0} do
+   write_file(cached, content:sub(1, len))
+   template.cache_clear()
+   misses = count('misses')
+   assert(template.load('ttest', {x= 4}).value == 4)
+   assert(count('misses') == misses + 1, 'truncated cache file loaded')
+   assert(read_file(cached) == content)
+end
+
+-- so is a cache file with some extra content
+write_file(cached, content .. 'x')
+template.cache_clear()
+misses = count('misses')
+template.load('ttest', {x= 4})
+assert(count('misses') == misses + 1)
+
+-- a change of the template or of the included file invalidates the
+-- disk cache
+write_file(dir .. '/ttest.lua.in', [[
+local obj = {value= $(x) + 10}
+$(include 'ttestinc')
+return obj
+]])
+template.cache_clear()
+misses = count('misses')
+assert(template.load('ttest', {x= 4}).value == 14)
+assert(count('misses') == misses + 1)
+
+write_file(dir .. '/ttestinc.lua.in', 'obj.inc = 2\n')
+template.cache_clear()
+assert(template.load('ttest', {x= 4}).inc == 2)
+assert(count('misses') == misses + 2)
+
+template.cache_dir(old_dir)
+template.cache_clear()
+package.path = path
+os.execute('rm -r ' .. dir)
+
+print("Test complete.")